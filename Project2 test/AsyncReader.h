@@ -0,0 +1,483 @@
+#pragma once
+/*
+    Program: AsyncReader - read a file in large blocks with many reads in flight
+
+    Description:
+      - readBlocks() hands a file to a consumer as a sequence of blocks, in
+        order, while up to ReadOptions::depth further block reads are
+        already queued, so the device sees a deep queue instead of one
+        blocking read at a time and parsing overlaps the I/O.
+      - On Linux the reads go through io_uring (raw system calls, no
+        liburing needed); where io_uring is missing or refused (old kernel,
+        seccomp), and on other systems, a few threads issue positioned
+        reads (pread / ReadFile with an offset) into the same buffer ring.
+      - Buffers are aligned to kAlign, so ReadOptions::direct can bypass the
+        page cache (O_DIRECT) for loads larger than memory; it is off by
+        default because repeated loads then re-read the disk.
+      - Files of one block are read with a single call and no ring, so
+        many small files cost no more than before.
+*/
+
+#include <algorithm>  // min
+#include <condition_variable>
+#include <cstddef>    // size_t
+#include <cstdint>
+#include <cstring>    // memset
+#include <memory>     // unique_ptr
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>  // iovec
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define ASYNCREADER_URING 1
+#endif
+#endif
+#endif
+#endif
+
+/*
+  How readBlocks() reads.
+*/
+struct ReadOptions {
+    unsigned depth;    // block reads kept in flight
+    size_t   block;    // bytes per read; a multiple of asyncreader::kAlign
+    bool     uring;    // use io_uring where available
+    bool     direct;   // bypass the page cache (Linux O_DIRECT)
+
+    ReadOptions() : depth(8), block(1 << 20), uring(true), direct(false) {}
+};
+
+namespace asyncreader {
+
+const size_t kAlign = 4096;          // buffer and O_DIRECT alignment
+const unsigned kMaxThreads = 4;      // pread fallback workers
+const unsigned kMaxDepth = 256;
+
+/*
+  An open file, read by offset from any thread.
+*/
+class File {
+public:
+    File() : _size(0) {
+#if defined(_WIN32)
+        _h = INVALID_HANDLE_VALUE;
+#else
+        _fd = _plain = -1;
+#endif
+    }
+    ~File() { close(); }
+
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
+    /*
+      Pre : none
+      Post: returns true with size() set; direct is honoured where the
+            system and file system allow it, else ignored.
+    */
+    bool open(const std::string& path, bool direct) {
+        close();
+#if defined(_WIN32)
+        (void)direct;
+        _h = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (_h == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER sz;
+        if (!GetFileSizeEx(_h, &sz)) { close(); return false; }
+        _size = (uint64_t)sz.QuadPart;
+#else
+        _plain = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (_plain < 0) return false;
+        struct stat st;
+        if (fstat(_plain, &st) != 0 || !S_ISREG(st.st_mode)) { close(); return false; }
+        _size = (uint64_t)st.st_size;
+        _fd = _plain;
+#if defined(O_DIRECT)
+        if (direct) { const int d = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT); if (d >= 0) _fd = d; }
+#else
+        (void)direct;
+#endif
+#endif
+        return true;
+    }
+
+    void close() {
+#if defined(_WIN32)
+        if (_h != INVALID_HANDLE_VALUE) CloseHandle(_h);
+        _h = INVALID_HANDLE_VALUE;
+#else
+        if (_fd >= 0 && _fd != _plain) ::close(_fd);
+        if (_plain >= 0) ::close(_plain);
+        _fd = _plain = -1;
+#endif
+        _size = 0;
+    }
+
+    uint64_t size() const { return _size; }
+#if !defined(_WIN32)
+    int fd() const { return _fd; }
+    bool direct() const { return _fd != _plain; }
+#endif
+
+    /*
+      Pre : buf holds n bytes; for a direct file buf, off and n are aligned
+      Post: returns the bytes read at off (fewer only at end of file), or
+            -1 on error. plain = read through the page cache regardless
+            (for the unaligned tail of a short direct read).
+    */
+    long long readAt(char* buf, size_t n, uint64_t off, bool plain = false) const {
+        size_t got = 0;
+        while (got < n) {
+#if defined(_WIN32)
+            (void)plain;
+            OVERLAPPED ov = OVERLAPPED();
+            ov.Offset = (DWORD)(off + got);
+            ov.OffsetHigh = (DWORD)((off + got) >> 32);
+            DWORD r = 0;
+            const DWORD want = (DWORD)std::min<size_t>(n - got, (size_t)1 << 30);
+            if (!ReadFile(_h, buf + got, want, &r, &ov)) {
+                if (GetLastError() == ERROR_HANDLE_EOF) break;
+                return -1;
+            }
+#else
+            const ssize_t r = ::pread(plain ? _plain : _fd, buf + got, n - got, (off_t)(off + got));
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EINVAL && !plain && _fd != _plain) { plain = true; continue; }   // unaligned for O_DIRECT
+                return -1;
+            }
+#endif
+            if (r == 0) break;
+            got += (size_t)r;
+        }
+        return (long long)got;
+    }
+
+private:
+#if defined(_WIN32)
+    HANDLE   _h;
+#else
+    int      _fd;      // read descriptor (O_DIRECT if requested and allowed)
+    int      _plain;   // same file through the page cache
+#endif
+    uint64_t _size;
+};
+
+/*
+  count * block bytes starting on a kAlign boundary, not zero-filled.
+*/
+class Buffers {
+public:
+    Buffers(size_t count, size_t block) : _raw(new char[count * block + kAlign]), _block(block) {
+        const uintptr_t p = reinterpret_cast<uintptr_t>(_raw.get());
+        _base = _raw.get() + (kAlign - p % kAlign) % kAlign;
+    }
+    char* operator[](size_t i) const { return _base + i * _block; }
+
+private:
+    std::unique_ptr<char[]> _raw;
+    char*                   _base;
+    size_t                  _block;
+};
+
+#if defined(ASYNCREADER_URING)
+/*
+  A minimal io_uring: one submission and one completion ring, used by a
+  single thread.
+*/
+class Uring {
+public:
+    Uring() : _fd(-1), _sq(nullptr), _cq(nullptr), _sqes(nullptr), _sqSize(0), _cqSize(0), _sqesSize(0), _queued(0) {}
+    ~Uring() { close(); }
+
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+    /*
+      Pre : none
+      Post: returns true with a ring of at least entries slots; false if
+            the kernel does not offer io_uring to this process.
+    */
+    bool open(unsigned entries) {
+        io_uring_params p;
+        memset(&p, 0, sizeof p);
+        _fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+        if (_fd < 0) return false;
+        _sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        _cqSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) _sqSize = _cqSize = std::max(_sqSize, _cqSize);
+        _sq = map(_sqSize, IORING_OFF_SQ_RING);
+        _cq = single ? _sq : map(_cqSize, IORING_OFF_CQ_RING);
+        _sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+        _sqes = static_cast<io_uring_sqe*>(map(_sqesSize, IORING_OFF_SQES));
+        if (!_sq || !_cq || !_sqes) { close(); return false; }
+        char* sq = static_cast<char*>(_sq);
+        char* cq = static_cast<char*>(_cq);
+        _sqHead = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        _sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        _sqMask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        _sqEntries = p.sq_entries;
+        _sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        _cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        _cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        _cqMask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        _cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        return true;
+    }
+
+    void close() {
+        if (_sqes) munmap(_sqes, _sqesSize);
+        if (_cq && _cq != _sq) munmap(_cq, _cqSize);
+        if (_sq) munmap(_sq, _sqSize);
+        if (_fd >= 0) ::close(_fd);
+        _fd = -1; _sq = _cq = nullptr; _sqes = nullptr; _queued = 0;
+    }
+
+    /*
+      Pre : open(); iov stays valid until the read completes
+      Post: a read of iov at off queued (sent by the next enter()); false
+            if the submission ring is full.
+    */
+    bool queueRead(int fd, const iovec* iov, uint64_t off, uint64_t tag) {
+        const unsigned tail = *_sqTail;   // only this thread writes the tail
+        if (tail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _sqEntries) return false;
+        const unsigned i = tail & _sqMask;
+        io_uring_sqe& e = _sqes[i];
+        memset(&e, 0, sizeof e);
+        e.opcode = IORING_OP_READV;   // READV: available since io_uring itself (5.1)
+        e.fd = fd;
+        e.addr = (uint64_t)(uintptr_t)iov;
+        e.len = 1;
+        e.off = off;
+        e.user_data = tag;
+        _sqArray[i] = i;
+        __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++_queued;
+        return true;
+    }
+
+    /*
+      Pre : open()
+      Post: queued reads submitted; with wait, returns once at least one
+            completion is available. Returns false on a system call error.
+    */
+    bool enter(bool wait) {
+        while (true) {
+            const long r = syscall(__NR_io_uring_enter, _fd, _queued, wait ? 1u : 0u, wait ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+            if (r >= 0) { _queued -= std::min<unsigned>(_queued, (unsigned)r); if (!wait || _queued == 0) return true; continue; }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) return false;
+        }
+    }
+
+    /*
+      Pre : open()
+      Post: returns true with one completion's tag and result (bytes or
+            -errno) taken off the completion ring; false if none is ready.
+    */
+    bool reap(uint64_t& tag, int& res) {
+        const unsigned head = *_cqHead;
+        if (head == __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE)) return false;
+        const io_uring_cqe& c = _cqes[head & _cqMask];
+        tag = c.user_data;
+        res = c.res;
+        __atomic_store_n(_cqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+private:
+    void* map(size_t n, uint64_t offset) {
+        void* p = mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, (off_t)offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    int           _fd;
+    void*         _sq;
+    void*         _cq;
+    io_uring_sqe* _sqes;
+    size_t        _sqSize, _cqSize, _sqesSize;
+    unsigned*     _sqHead;
+    unsigned*     _sqTail;
+    unsigned*     _sqArray;
+    unsigned      _sqMask, _sqEntries;
+    unsigned*     _cqHead;
+    unsigned*     _cqTail;
+    unsigned      _cqMask;
+    io_uring_cqe* _cqes;
+    unsigned      _queued;    // queued but not yet submitted
+};
+
+/*
+  Pre : file open with blocks > 1 block reads of opt.block each
+  Post: returns 1 with every block consumed in order, 0 if io_uring is not
+        available (nothing consumed), or -1 on a read error (blocks before
+        it consumed). Every read is complete before it returns or throws.
+*/
+template <class Consume>
+inline int uringBlocks(const File& file, const ReadOptions& opt, uint64_t blocks, unsigned depth, Buffers& buf, Consume& consume) {
+    Uring ring;
+    if (!ring.open(depth)) return 0;
+    struct Slot { iovec iov; int res; bool done; };
+    std::vector<Slot> slots(depth);
+    unsigned inFlight = 0;
+    auto issue = [&](uint64_t b) {
+        Slot& s = slots[b % depth];
+        const uint64_t off = b * opt.block;
+        s.iov.iov_base = buf[b % depth];
+        // a direct read keeps its full aligned length; the kernel stops at end of file
+        s.iov.iov_len = file.direct() ? opt.block : (size_t)std::min<uint64_t>(opt.block, file.size() - off);
+        s.done = false;
+        ring.queueRead(file.fd(), &s.iov, off, b);
+        ++inFlight;
+    };
+    auto drain = [&]() {
+        uint64_t tag; int res;
+        while (inFlight > 0 && ring.enter(true))
+            while (ring.reap(tag, res)) { slots[tag % depth].res = res; slots[tag % depth].done = true; --inFlight; }
+    };
+    for (uint64_t b = 0; b < depth && b < blocks; ++b) issue(b);
+    int result = 1;
+    try {
+        for (uint64_t b = 0; b < blocks; ++b) {
+            Slot& s = slots[b % depth];
+            while (!s.done) {
+                if (!ring.enter(true)) { drain(); return -1; }
+                uint64_t tag; int res;
+                while (ring.reap(tag, res)) { slots[tag % depth].res = res; slots[tag % depth].done = true; --inFlight; }
+            }
+            const uint64_t off = b * opt.block;
+            const size_t want = (size_t)std::min<uint64_t>(opt.block, file.size() - off);
+            long long got = s.res;
+            if (got < 0) got = file.readAt(buf[b % depth], want, off);   // e.g. a file system io_uring cannot read
+            else if ((size_t)got < want) {   // short read: finish it through the page cache
+                const long long more = file.readAt(buf[b % depth] + got, want - (size_t)got, off + (uint64_t)got, true);
+                got = more < 0 ? -1 : got + more;
+            }
+            if (got < 0) { result = -1; break; }
+            if (got > 0) consume(buf[b % depth], (size_t)got);
+            if ((size_t)got < want) break;   // file shrank while being read
+            if (b + depth < blocks) issue(b + depth);
+        }
+    }
+    catch (...) { drain(); throw; }
+    drain();
+    return result;
+}
+#endif
+
+/*
+  Pre : as uringBlocks
+  Post: as uringBlocks, reading with up to kMaxThreads threads; returns
+        1 or -1.
+*/
+template <class Consume>
+inline int threadBlocks(const File& file, const ReadOptions& opt, uint64_t blocks, unsigned depth, Buffers& buf, Consume& consume) {
+    struct Slot { uint64_t block; long long got; bool ready; };
+    std::vector<Slot> slots(depth, Slot{ 0, 0, false });
+    std::mutex m;
+    std::condition_variable cv;
+    uint64_t nextRead = 0, consumed = 0;   // consumed: blocks whose slots are free again
+    bool stop = false;
+
+    auto work = [&]() {
+        while (true) {
+            uint64_t b;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&] { return stop || nextRead >= blocks || nextRead < consumed + depth; });
+                if (stop || nextRead >= blocks) return;
+                b = nextRead++;
+            }
+            const uint64_t off = b * opt.block;
+            const size_t want = (size_t)std::min<uint64_t>(opt.block, file.size() - off);
+            const long long got = file.readAt(buf[b % depth], want, off);
+            std::lock_guard<std::mutex> lock(m);
+            slots[b % depth] = Slot{ b, got, true };
+            cv.notify_all();
+        }
+    };
+    const unsigned n = std::min(depth, kMaxThreads);
+    std::vector<std::thread> pool;
+    auto finish = [&]() {
+        { std::lock_guard<std::mutex> lock(m); stop = true; }
+        cv.notify_all();
+        for (std::thread& t : pool) t.join();
+    };
+    int result = 1;
+    try {
+        for (unsigned i = 0; i < n; ++i) pool.emplace_back(work);
+        for (uint64_t b = 0; b < blocks; ++b) {
+            Slot s;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&] { return slots[b % depth].ready && slots[b % depth].block == b; });
+                s = slots[b % depth];
+            }
+            const size_t want = (size_t)std::min<uint64_t>(opt.block, file.size() - b * opt.block);
+            if (s.got < 0) { result = -1; break; }
+            if (s.got > 0) consume(buf[b % depth], (size_t)s.got);
+            if ((size_t)s.got < want) break;
+            std::lock_guard<std::mutex> lock(m);
+            slots[b % depth].ready = false;
+            consumed = b + 1;
+            cv.notify_all();
+        }
+    }
+    catch (...) { finish(); throw; }
+    finish();
+    return result;
+}
+
+} // namespace asyncreader
+
+/*
+  Pre : consume(const char* data, size_t len) takes each block in file
+        order; opt.block is a multiple of asyncreader::kAlign
+  Post: the whole file consumed; returns null, or a static message if it
+        cannot be opened or a read fails (blocks before the failure have
+        been consumed).
+*/
+template <class Consume>
+inline const char* readBlocks(const std::string& path, const ReadOptions& opt, Consume consume) {
+    using namespace asyncreader;
+    ReadOptions o = opt;
+    if (o.block < kAlign) o.block = kAlign;
+    o.block -= o.block % kAlign;
+    File file;
+    if (!file.open(path, o.direct)) return "cannot open file";
+    if (file.size() == 0) return nullptr;
+    const uint64_t blocks = (file.size() + o.block - 1) / o.block;
+    const unsigned depth = (unsigned)std::min<uint64_t>(blocks, std::max(1u, std::min(o.depth, kMaxDepth)));
+    Buffers buf(depth, o.block);
+    if (blocks == 1) {   // one read, no ring
+        const long long got = file.readAt(buf[0], (size_t)file.size(), 0);
+        if (got < 0) return "read failed";
+        if (got > 0) consume(buf[0], (size_t)got);
+        return nullptr;
+    }
+    int r = 0;
+#if defined(ASYNCREADER_URING)
+    if (o.uring) r = uringBlocks(file, o, blocks, depth, buf, consume);
+#endif
+    if (r == 0) r = threadBlocks(file, o, blocks, depth, buf, consume);
+    return r < 0 ? "read failed" : nullptr;
+}
@@ -0,0 +1,382 @@
+#pragma once
+/*
+    Program: BlockStore - lossless compressed storage of sorted doubles for StatsArray
+
+    Description:
+      - Values kept in ascending order, split into blocks of at most 512.
+      - Each block has an uncompressed header (first/last value, count, sum)
+        and a Gorilla-style XOR bit stream for the remaining values.
+      - Sum, min, max and size come from the headers alone.
+      - Rank lookups decode only the one block that holds the rank; the most
+        recently decoded block and the block prefix counts are cached by
+        const lookups (not safe for concurrent readers).
+*/
+
+#include <cassert>
+#include <cstddef>    // size_t
+#include <cstdint>    // uint64_t, uint32_t
+#include <cstring>    // memcpy
+#include <vector>
+#include <algorithm>  // upper_bound
+#ifdef _MSC_VER
+#include <intrin.h>   // _BitScanForward/_BitScanReverse
+#endif
+
+// ---------------- Bit stream helpers ----------------
+
+/*
+  Pre : x != 0
+  Post: returns number of leading zero bits of x.
+*/
+inline unsigned blockClz64(uint64_t x) {
+#if defined(_MSC_VER)
+    unsigned long i;
+#if defined(_M_X64) || defined(_M_ARM64)
+    _BitScanReverse64(&i, x); return 63u - (unsigned)i;
+#else
+    if (x >> 32) { _BitScanReverse(&i, (unsigned long)(x >> 32)); return 31u - (unsigned)i; }
+    _BitScanReverse(&i, (unsigned long)x); return 63u - (unsigned)i;
+#endif
+#else
+    return (unsigned)__builtin_clzll(x);
+#endif
+}
+
+/*
+  Pre : x != 0
+  Post: returns number of trailing zero bits of x.
+*/
+inline unsigned blockCtz64(uint64_t x) {
+#if defined(_MSC_VER)
+    unsigned long i;
+#if defined(_M_X64) || defined(_M_ARM64)
+    _BitScanForward64(&i, x); return (unsigned)i;
+#else
+    if ((uint32_t)x) { _BitScanForward(&i, (unsigned long)(uint32_t)x); return (unsigned)i; }
+    _BitScanForward(&i, (unsigned long)(x >> 32)); return 32u + (unsigned)i;
+#endif
+#else
+    return (unsigned)__builtin_ctzll(x);
+#endif
+}
+
+/*
+  MSB-first bit appender over 64-bit words.
+*/
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint64_t>& words) : _w(words), _used(64) {}
+
+    /*
+      Pre : 1 <= n <= 64; v < 2^n
+      Post: the n low bits of v appended.
+    */
+    void put(uint64_t v, unsigned n) {
+        if (_used == 64) { _w.push_back(0); _used = 0; }
+        unsigned room = 64 - _used;
+        if (n <= room) { _w.back() |= v << (room - n); _used += n; }
+        else {
+            _w.back() |= v >> (n - room);
+            _w.push_back(0); _used = n - room;
+            _w.back() |= v << (64 - _used);
+        }
+    }
+
+private:
+    std::vector<uint64_t>& _w;
+    unsigned               _used;   // bits used in _w.back(); 64 means start a new word
+};
+
+/*
+  MSB-first bit reader matching BitWriter.
+*/
+class BitReader {
+public:
+    explicit BitReader(const uint64_t* words) : _w(words), _pos(0) {}
+
+    /*
+      Pre : 1 <= n <= 64; n bits remain
+      Post: returns the next n bits.
+    */
+    uint64_t get(unsigned n) {
+        size_t k = _pos / 64; unsigned off = (unsigned)(_pos % 64); _pos += n;
+        uint64_t hi = _w[k] << off;
+        if (off + n > 64) hi |= _w[k + 1] >> (64 - off);
+        return hi >> (64 - n);
+    }
+
+private:
+    const uint64_t* _w;
+    size_t          _pos;
+};
+
+// ---------------- BlockStore ----------------
+
+/*
+  Sorted doubles in XOR-compressed blocks. Consecutive sorted values share
+  sign, exponent and leading mantissa bits, so their XOR is mostly zeros:
+    '0'                         same value as previous
+    '10' + bits                 XOR fits the previous leading/trailing window
+    '11' + 5b lead + 6b len + bits   new window
+*/
+class BlockStore {
+public:
+    static const size_t kMaxBlock = 512;
+
+    BlockStore() : _total(0), _cacheBlock(SIZE_MAX), _prefixValid(false) {}
+
+    /*
+      Pre : none
+      Post: returns number of values.
+    */
+    size_t size() const { return _total; }
+
+    /*
+      Pre : none
+      Post: returns number of blocks.
+    */
+    size_t blocks() const { return _blocks.size(); }
+
+    /*
+      Pre : none
+      Post: returns address of the block table (for display).
+    */
+    const void* address() const { return _blocks.empty() ? nullptr : static_cast<const void*>(_blocks.data()); }
+
+    /*
+      Pre : none
+      Post: returns heap bytes held by headers and compressed payloads.
+    */
+    size_t bytes() const {
+        size_t b = _blocks.capacity() * sizeof(Block) + _prefix.capacity() * sizeof(size_t);
+        for (size_t i = 0; i < _blocks.size(); ++i) b += _blocks[i].bits.capacity() * sizeof(uint64_t);
+        return b;
+    }
+
+    /*
+      Pre : a ascending with n values
+      Post: store holds exactly a[0..n), packed into full blocks.
+    */
+    void assign(const double* a, size_t n) {
+        clear();
+        for (size_t i = 0; i < n; i += kMaxBlock) {
+            size_t len = n - i; if (len > kMaxBlock) len = kMaxBlock;
+            _blocks.push_back(Block()); encode(a + i, len, _blocks.back());
+        }
+        _total = n;
+    }
+
+    /*
+      Pre : out has room for size() values
+      Post: out[0..size()) holds all values ascending.
+    */
+    void copyTo(double* out) const {
+        for (size_t b = 0; b < _blocks.size(); ++b) { decode(_blocks[b], out); out += _blocks[b].count; }
+    }
+
+    /*
+      Pre : none
+      Post: v inserted in order; a block that overflows is split in two.
+    */
+    void add(double v) {
+        if (_blocks.empty()) { _blocks.push_back(Block()); encode(&v, 1, _blocks.back()); ++_total; touch(); return; }
+        size_t b = blockFor(v); if (b == _blocks.size()) --b;
+        std::vector<double> vals(_blocks[b].count);
+        decode(_blocks[b], vals.data());
+        vals.insert(std::lower_bound(vals.begin(), vals.end(), v), v);
+        if (vals.size() <= kMaxBlock) encode(vals.data(), vals.size(), _blocks[b]);
+        else {
+            size_t half = vals.size() / 2;
+            Block right; encode(vals.data() + half, vals.size() - half, right);
+            encode(vals.data(), half, _blocks[b]);
+            _blocks.insert(_blocks.begin() + b + 1, right);
+        }
+        ++_total; touch();
+    }
+
+    /*
+      Pre : k >= 1
+      Post: removes up to k occurrences of v; returns number removed.
+    */
+    size_t remove(double v, size_t k) {
+        size_t removed = 0, b = blockFor(v);
+        std::vector<double> vals;
+        while (removed < k && b < _blocks.size() && _blocks[b].first <= v) {
+            vals.resize(_blocks[b].count); decode(_blocks[b], vals.data());
+            size_t lo = (size_t)(std::lower_bound(vals.begin(), vals.end(), v) - vals.begin()), hi = lo;
+            while (hi < vals.size() && vals[hi] == v && removed < k) { ++hi; ++removed; }
+            if (hi == lo) break;
+            vals.erase(vals.begin() + lo, vals.begin() + hi);
+            if (vals.empty()) _blocks.erase(_blocks.begin() + b);
+            else { encode(vals.data(), vals.size(), _blocks[b]); ++b; }
+        }
+        _total -= removed; if (removed) touch();
+        return removed;
+    }
+
+    /*
+      Pre : r < size()
+      Post: removes the value at rank r; returns it.
+    */
+    double removeAt(size_t r) {
+        size_t b = blockOfRank(r), off = r - (b ? _prefix[b - 1] : 0);
+        std::vector<double> vals(_blocks[b].count); decode(_blocks[b], vals.data());
+        double v = vals[off];
+        vals.erase(vals.begin() + off);
+        if (vals.empty()) _blocks.erase(_blocks.begin() + b);
+        else encode(vals.data(), vals.size(), _blocks[b]);
+        --_total; touch();
+        return v;
+    }
+
+    /*
+      Pre : none
+      Post: store emptied.
+    */
+    void clear() { _blocks.clear(); _total = 0; touch(); }
+
+    /*
+      Pre : none
+      Post: returns occurrences of v; decodes only blocks whose range holds v.
+    */
+    size_t count(double v) const {
+        size_t c = 0; std::vector<double> vals;
+        for (size_t b = blockFor(v); b < _blocks.size() && _blocks[b].first <= v; ++b) {
+            vals.resize(_blocks[b].count); decode(_blocks[b], vals.data());
+            for (size_t i = 0; i < vals.size(); ++i) c += (vals[i] == v);
+        }
+        return c;
+    }
+
+    /*
+      Pre : r < size()
+      Post: returns value at rank r; block ends come from the header.
+    */
+    double valueAtRank(size_t r) const {
+        size_t b = blockOfRank(r), off = r - (b ? _prefix[b - 1] : 0);
+        const Block& blk = _blocks[b];
+        if (off == 0) return blk.first;
+        if (off + 1 == blk.count) return blk.last;
+        if (_cacheBlock != b) { _cache.resize(blk.count); decode(blk, _cache.data()); _cacheBlock = b; }
+        return _cache[off];
+    }
+
+    /*
+      Pre : none
+      Post: returns sum of all values from the block headers.
+    */
+    long double sum() const {
+        long double s = 0.0L;
+        for (size_t b = 0; b < _blocks.size(); ++b) s += _blocks[b].sum;
+        return s;
+    }
+
+    /*
+      Pre : f(value, weight) callable
+      Post: decodes block by block and calls f(value, 1) for every value ascending.
+    */
+    template <typename F>
+    void forEach(F f) const {
+        double buf[kMaxBlock];
+        for (size_t b = 0; b < _blocks.size(); ++b) {
+            decode(_blocks[b], buf);
+            for (uint32_t i = 0; i < _blocks[b].count; ++i) f(buf[i], (size_t)1);
+        }
+    }
+
+private:
+    struct Block {
+        double                first;   // smallest value in the block
+        double                last;    // largest value in the block
+        uint32_t              count;
+        long double           sum;
+        std::vector<uint64_t> bits;    // XOR stream for values[1..count)
+    };
+
+    std::vector<Block>          _blocks;
+    size_t                      _total;
+    mutable size_t              _cacheBlock;    // block decoded into _cache (SIZE_MAX = none)
+    mutable std::vector<double> _cache;
+    mutable std::vector<size_t> _prefix;        // _prefix[b] = values in blocks 0..b
+    mutable bool                _prefixValid;
+
+    static uint64_t toBits(double x) { uint64_t u; memcpy(&u, &x, sizeof u); return u; }
+    static double fromBits(uint64_t u) { double x; memcpy(&x, &u, sizeof x); return x; }
+
+    void touch() { _cacheBlock = SIZE_MAX; _prefixValid = false; }
+
+    /*
+      Pre : none
+      Post: returns first block whose last value >= v (blocks().. if none).
+    */
+    size_t blockFor(double v) const {
+        size_t L = 0, R = _blocks.size();
+        while (L < R) { size_t M = (L + R) / 2; if (_blocks[M].last < v) L = M + 1; else R = M; }
+        return L;
+    }
+
+    /*
+      Pre : r < size()
+      Post: returns block holding rank r; _prefix is valid.
+    */
+    size_t blockOfRank(size_t r) const {
+        assert(r < _total);
+        if (!_prefixValid) {
+            _prefix.resize(_blocks.size());
+            size_t run = 0;
+            for (size_t b = 0; b < _blocks.size(); ++b) { run += _blocks[b].count; _prefix[b] = run; }
+            _prefixValid = true;
+        }
+        return (size_t)(std::upper_bound(_prefix.begin(), _prefix.end(), r) - _prefix.begin());
+    }
+
+    /*
+      Pre : a ascending; 1 <= n <= kMaxBlock
+      Post: blk holds header and XOR stream for a[0..n).
+    */
+    static void encode(const double* a, size_t n, Block& blk) {
+        assert(n >= 1 && n <= kMaxBlock);
+        blk.first = a[0]; blk.last = a[n - 1]; blk.count = (uint32_t)n;
+        blk.sum = 0.0L; for (size_t i = 0; i < n; ++i) blk.sum += a[i];
+        blk.bits.clear();
+        BitWriter w(blk.bits);
+        uint64_t prev = toBits(a[0]); unsigned pLead = 65, pTrail = 0;
+        for (size_t i = 1; i < n; ++i) {
+            uint64_t cur = toBits(a[i]), x = cur ^ prev; prev = cur;
+            if (!x) { w.put(0, 1); continue; }
+            unsigned lead = blockClz64(x), trail = blockCtz64(x);
+            if (lead > 31) lead = 31;
+            if (pLead <= 64 && lead >= pLead && trail >= pTrail) {
+                w.put(2, 2); w.put(x >> pTrail, 64 - pLead - pTrail);
+            }
+            else {
+                unsigned len = 64 - lead - trail;
+                w.put(3, 2); w.put(lead, 5); w.put(len & 63u, 6); w.put(x >> trail, len);
+                pLead = lead; pTrail = trail;
+            }
+        }
+        blk.bits.shrink_to_fit();
+    }
+
+    /*
+      Pre : out has room for blk.count values
+      Post: out[0..blk.count) holds the decoded block.
+    */
+    static void decode(const Block& blk, double* out) {
+        out[0] = blk.first;
+        if (blk.count == 1) return;
+        BitReader r(blk.bits.data());
+        uint64_t prev = toBits(blk.first); unsigned lead = 0, trail = 0;
+        for (uint32_t i = 1; i < blk.count; ++i) {
+            if (r.get(1)) {
+                if (r.get(1)) {
+                    lead = (unsigned)r.get(5);
+                    unsigned len = (unsigned)r.get(6); if (len == 0) len = 64;
+                    trail = 64 - lead - len;
+                }
+                prev ^= r.get(64 - lead - trail) << trail;
+            }
+            out[i] = fromBits(prev);
+        }
+    }
+};
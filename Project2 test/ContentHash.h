@@ -0,0 +1,126 @@
+#pragma once
+/*
+    Program: ContentHash - streaming 64-bit content hash (XXH64)
+
+    Description:
+      - Xxh64 computes the XXH64 hash of a byte stream fed in pieces of any
+        size; the result is the same as hashing the bytes in one go, and
+        matches the reference xxHash implementation (seed 0 by default).
+      - It runs at several GB/s, fast enough to hash input while it is
+        read for parsing, so result caches can be keyed by content rather
+        than by file name or time stamp.
+      - Words are read little-endian regardless of the host, so a hash
+        means the same on every machine.
+*/
+
+#include <cstddef>    // size_t
+#include <cstdint>
+#include <cstring>    // memcpy
+
+class Xxh64 {
+public:
+    explicit Xxh64(uint64_t seed = 0) { reset(seed); }
+
+    /*
+      Pre : none
+      Post: state as if nothing had been fed.
+    */
+    void reset(uint64_t seed = 0) {
+        _seed = seed;
+        _v[0] = seed + kP1 + kP2; _v[1] = seed + kP2; _v[2] = seed; _v[3] = seed - kP1;
+        _total = 0;
+        _held = 0;
+    }
+
+    /*
+      Pre : p holds n bytes (may be null when n == 0)
+      Post: the bytes are part of the hashed stream.
+    */
+    void update(const void* data, size_t n) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        _total += n;
+        if (_held + n < 32) { if (n) memcpy(_buf + _held, p, n); _held += n; return; }
+        if (_held) {   // complete the held stripe first
+            const size_t take = 32 - _held;
+            memcpy(_buf + _held, p, take);
+            stripe(_buf);
+            p += take; n -= take; _held = 0;
+        }
+        const unsigned char* const end = p + n;
+        // locals: stores through _v could alias the input bytes
+        uint64_t v0 = _v[0], v1 = _v[1], v2 = _v[2], v3 = _v[3];
+        for (; p + 32 <= end; p += 32) {
+            v0 = round(v0, read64(p)); v1 = round(v1, read64(p + 8));
+            v2 = round(v2, read64(p + 16)); v3 = round(v3, read64(p + 24));
+        }
+        _v[0] = v0; _v[1] = v1; _v[2] = v2; _v[3] = v3;
+        _held = (size_t)(end - p);
+        if (_held) memcpy(_buf, p, _held);
+    }
+
+    /*
+      Pre : none
+      Post: returns the hash of everything fed so far; more may be fed after.
+    */
+    uint64_t digest() const {
+        uint64_t h;
+        if (_total >= 32) {
+            h = rotl(_v[0], 1) + rotl(_v[1], 7) + rotl(_v[2], 12) + rotl(_v[3], 18);
+            for (int i = 0; i < 4; ++i) { h ^= round(0, _v[i]); h = h * kP1 + kP4; }
+        }
+        else h = _seed + kP5;
+        h += _total;
+        const unsigned char* p = _buf;
+        const unsigned char* const end = _buf + _held;
+        for (; p + 8 <= end; p += 8) { h ^= round(0, read64(p)); h = rotl(h, 27) * kP1 + kP4; }
+        if (p + 4 <= end) { h ^= (uint64_t)read32(p) * kP1; h = rotl(h, 23) * kP2 + kP3; p += 4; }
+        for (; p < end; ++p) { h ^= *p * kP5; h = rotl(h, 11) * kP1; }
+        h ^= h >> 33; h *= kP2;
+        h ^= h >> 29; h *= kP3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    /*
+      Pre : p holds n bytes
+      Post: returns the hash of exactly those bytes.
+    */
+    static uint64_t of(const void* p, size_t n, uint64_t seed = 0) { Xxh64 x(seed); x.update(p, n); return x.digest(); }
+
+private:
+    static const uint64_t kP1 = 11400714785074694791ULL;
+    static const uint64_t kP2 = 14029467366897019727ULL;
+    static const uint64_t kP3 = 1609587929392839161ULL;
+    static const uint64_t kP4 = 9650029242287828579ULL;
+    static const uint64_t kP5 = 2870177450012600261ULL;
+
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t round(uint64_t acc, uint64_t in) { acc += in * kP2; return rotl(acc, 31) * kP1; }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    static uint64_t read64(const unsigned char* p) {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+        return v;
+    }
+    static uint32_t read32(const unsigned char* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+#else
+    static uint64_t read64(const unsigned char* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+    static uint32_t read32(const unsigned char* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+#endif
+
+    void stripe(const unsigned char* p) {
+        _v[0] = round(_v[0], read64(p));
+        _v[1] = round(_v[1], read64(p + 8));
+        _v[2] = round(_v[2], read64(p + 16));
+        _v[3] = round(_v[3], read64(p + 24));
+    }
+
+    uint64_t      _v[4];
+    uint64_t      _seed;
+    uint64_t      _total;     // bytes fed
+    unsigned char _buf[32];   // tail shorter than one 32-byte stripe
+    size_t        _held;
+};
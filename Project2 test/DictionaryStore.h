@@ -0,0 +1,282 @@
+#pragma once
+/*
+    Program: DictionaryStore - dictionary-encoded storage for StatsArray
+
+    Description:
+      - Sorted dictionary of distinct values plus a bit-packed count array.
+      - Count width grows on demand (1..64 bits per distinct value).
+      - Rank lookups use a prefix-count table rebuilt lazily after changes;
+        the rebuild happens inside const lookups (not safe for concurrent
+        readers).
+      - Meant for low-cardinality data: memory is O(distinct), not O(n).
+*/
+
+#include <cassert>
+#include <cstddef>    // size_t
+#include <cstdint>    // uint64_t
+#include <vector>
+#include <algorithm>  // lower_bound, upper_bound
+
+// ---------------- PackedCounts ----------------
+
+/*
+  Array of unsigned counts stored at a fixed bit width in 64-bit words.
+  The width is widened (and every entry repacked) when a count no longer fits.
+*/
+class PackedCounts {
+public:
+    /*
+      Pre : none
+      Post: empty array, 1 bit per entry.
+    */
+    PackedCounts() : _n(0), _width(1) {}
+
+    /*
+      Pre : none
+      Post: returns number of entries.
+    */
+    size_t size() const { return _n; }
+
+    /*
+      Pre : none
+      Post: returns bits used per entry.
+    */
+    unsigned width() const { return _width; }
+
+    /*
+      Pre : none
+      Post: returns heap bytes held by the packed words.
+    */
+    size_t bytes() const { return _words.capacity() * sizeof(uint64_t); }
+
+    /*
+      Pre : i < size()
+      Post: returns entry i.
+    */
+    size_t get(size_t i) const {
+        assert(i < _n);
+        return (size_t)read(_words, _width, i);
+    }
+
+    /*
+      Pre : i < size()
+      Post: entry i == c; width widened first if c does not fit.
+    */
+    void set(size_t i, size_t c) {
+        assert(i < _n);
+        if (bitsFor(c) > _width) widen(bitsFor(c));
+        write(_words, _width, i, c);
+    }
+
+    /*
+      Pre : i <= size()
+      Post: c inserted at i; later entries shift up by one.
+    */
+    void insert(size_t i, size_t c) {
+        assert(i <= _n);
+        if (bitsFor(c) > _width) widen(bitsFor(c));
+        ++_n; _words.resize(wordsFor(_n, _width), 0);
+        for (size_t j = _n - 1; j > i; --j) write(_words, _width, j, read(_words, _width, j - 1));
+        write(_words, _width, i, c);
+    }
+
+    /*
+      Pre : i < size()
+      Post: entry i removed; later entries shift down by one.
+    */
+    void erase(size_t i) {
+        assert(i < _n);
+        for (size_t j = i + 1; j < _n; ++j) write(_words, _width, j - 1, read(_words, _width, j));
+        --_n; _words.resize(wordsFor(_n, _width));
+    }
+
+    /*
+      Pre : none
+      Post: size() == 0; width reset to 1 bit.
+    */
+    void clear() { _words.clear(); _n = 0; _width = 1; }
+
+private:
+    std::vector<uint64_t> _words;
+    size_t                _n;
+    unsigned              _width;
+
+    static size_t wordsFor(size_t n, unsigned w) { return (n * w + 63) / 64; }
+
+    static uint64_t mask(unsigned w) { return w >= 64 ? ~(uint64_t)0 : (((uint64_t)1 << w) - 1); }
+
+    static unsigned bitsFor(size_t c) {
+        unsigned b = 1; while (b < 64 && ((uint64_t)c >> b) != 0) ++b; return b;
+    }
+
+    static uint64_t read(const std::vector<uint64_t>& words, unsigned w, size_t i) {
+        size_t bit = i * w, k = bit / 64; unsigned off = (unsigned)(bit % 64);
+        uint64_t v = words[k] >> off;
+        if (off + w > 64) v |= words[k + 1] << (64 - off);
+        return v & mask(w);
+    }
+
+    static void write(std::vector<uint64_t>& words, unsigned w, size_t i, uint64_t c) {
+        size_t bit = i * w, k = bit / 64; unsigned off = (unsigned)(bit % 64);
+        words[k] = (words[k] & ~(mask(w) << off)) | (c << off);
+        if (off + w > 64) {
+            unsigned hi = off + w - 64;
+            words[k + 1] = (words[k + 1] & ~mask(hi)) | (c >> (64 - off));
+        }
+    }
+
+    /*
+      Pre : w > width()
+      Post: every entry repacked at w bits.
+    */
+    void widen(unsigned w) {
+        std::vector<uint64_t> nw(wordsFor(_n, w), 0);
+        for (size_t i = 0; i < _n; ++i) write(nw, w, i, read(_words, _width, i));
+        _words.swap(nw); _width = w;
+    }
+};
+
+// ---------------- DictionaryStore ----------------
+
+/*
+  Sorted distinct values with their (bit-packed) multiplicities.
+  Rank i of the flattened sorted sequence maps to the value whose
+  cumulative count first exceeds i.
+*/
+class DictionaryStore {
+public:
+    DictionaryStore() : _total(0), _prefixValid(false) {}
+
+    /*
+      Pre : none
+      Post: returns number of values counted with multiplicity.
+    */
+    size_t size() const { return _total; }
+
+    /*
+      Pre : none
+      Post: returns number of distinct values.
+    */
+    size_t distinct() const { return _values.size(); }
+
+    /*
+      Pre : i < distinct()
+      Post: returns i-th smallest distinct value.
+    */
+    double value(size_t i) const { return _values[i]; }
+
+    /*
+      Pre : i < distinct()
+      Post: returns multiplicity of the i-th distinct value.
+    */
+    size_t countAt(size_t i) const { return _counts.get(i); }
+
+    /*
+      Pre : none
+      Post: returns address of the dictionary (for display).
+    */
+    const void* address() const { return _values.empty() ? nullptr : static_cast<const void*>(_values.data()); }
+
+    /*
+      Pre : none
+      Post: returns heap bytes held by dictionary, counts and rank table.
+    */
+    size_t bytes() const {
+        return _values.capacity() * sizeof(double) + _counts.bytes() + _prefix.capacity() * sizeof(size_t);
+    }
+
+    /*
+      Pre : k >= 1
+      Post: k occurrences of v added.
+    */
+    void add(double v, size_t k = 1) {
+        assert(k >= 1);
+        size_t i = find(v);
+        if (i < _values.size() && _values[i] == v) _counts.set(i, _counts.get(i) + k);
+        else { _values.insert(_values.begin() + i, v); _counts.insert(i, k); }
+        _total += k; _prefixValid = false;
+    }
+
+    /*
+      Pre : k >= 1
+      Post: removes up to k occurrences of v; returns number removed.
+    */
+    size_t remove(double v, size_t k) {
+        assert(k >= 1);
+        size_t i = find(v);
+        if (i == _values.size() || _values[i] != v) return 0;
+        return removeFrom(i, k);
+    }
+
+    /*
+      Pre : r < size()
+      Post: removes one occurrence of the value at rank r; returns that value.
+    */
+    double removeAt(size_t r) {
+        size_t i = slotOfRank(r); double v = _values[i];
+        removeFrom(i, 1);
+        return v;
+    }
+
+    /*
+      Pre : none
+      Post: store emptied.
+    */
+    void clear() { _values.clear(); _counts.clear(); _prefix.clear(); _total = 0; _prefixValid = false; }
+
+    /*
+      Pre : none
+      Post: returns multiplicity of v (0 if absent).
+    */
+    size_t count(double v) const {
+        size_t i = find(v);
+        return (i < _values.size() && _values[i] == v) ? _counts.get(i) : 0;
+    }
+
+    /*
+      Pre : r < size()
+      Post: returns value at rank r of the sorted sequence.
+    */
+    double valueAtRank(size_t r) const { return _values[slotOfRank(r)]; }
+
+    /*
+      Pre : f(value, count) callable
+      Post: calls f for each distinct value in ascending order.
+    */
+    template <typename F>
+    void forEach(F f) const {
+        for (size_t i = 0; i < _values.size(); ++i) f(_values[i], _counts.get(i));
+    }
+
+private:
+    std::vector<double>         _values;       // ascending, distinct
+    PackedCounts                _counts;       // _counts[i] = multiplicity of _values[i]
+    size_t                      _total;
+    mutable std::vector<size_t> _prefix;       // _prefix[i] = counts of _values[0..i]
+    mutable bool                _prefixValid;
+
+    size_t find(double v) const { return (size_t)(std::lower_bound(_values.begin(), _values.end(), v) - _values.begin()); }
+
+    size_t removeFrom(size_t i, size_t k) {
+        size_t c = _counts.get(i), removed = k < c ? k : c;
+        if (removed == c) { _values.erase(_values.begin() + i); _counts.erase(i); }
+        else _counts.set(i, c - removed);
+        _total -= removed; _prefixValid = false;
+        return removed;
+    }
+
+    /*
+      Pre : r < size()
+      Post: returns dictionary slot holding rank r.
+    */
+    size_t slotOfRank(size_t r) const {
+        assert(r < _total);
+        if (!_prefixValid) {
+            _prefix.resize(_values.size());
+            size_t run = 0;
+            for (size_t i = 0; i < _values.size(); ++i) { run += _counts.get(i); _prefix[i] = run; }
+            _prefixValid = true;
+        }
+        return (size_t)(std::upper_bound(_prefix.begin(), _prefix.end(), r) - _prefix.begin());
+    }
+};
@@ -0,0 +1,264 @@
+#pragma once
+/*
+    Program: FieldScanner - one numeric field per line of a log, in chunks
+
+    Description:
+      - A FieldSpec names what to take from each line: the value of a
+        key=value pair ("latency_ms" in "ts=... latency_ms=12.7 ..."), or
+        the n-th column split on whitespace runs or on one delimiter
+        character. With neither, every number is taken (NumberScanner).
+      - feed()/finish() take a text stream in slices like NumberScanner, so
+        it drops into every loader, gzip input and FileFollower. Lines are
+        found with memchr, as are key candidates, so the scan runs at the
+        speed of the C library's vectorized byte search; only a line cut
+        off at the end of a slice is copied, into a buffer that is reused.
+      - Values are parsed with from_chars where the standard library has
+        it (C++17), else strtod on a small stack copy. Quotes around a
+        value are allowed. Lines without the field, or whose field is not
+        entirely a number, are counted in skipped() and dropped.
+*/
+
+#include <cctype>     // isdigit, isspace
+#include <cerrno>
+#include <cstddef>    // size_t
+#include <cstdlib>    // strtod
+#include <cstring>    // memchr, memcmp, memcpy
+#include <string>
+#include <vector>
+#include "NumberScanner.h"
+#if defined(__has_include)
+#if __has_include(<charconv>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#include <charconv>   // from_chars (C++17; floating point needs __cpp_lib_to_chars)
+#endif
+#endif
+
+/*
+  What FieldScanner takes from each line.
+*/
+struct FieldSpec {
+    std::string key;         // value of "key=value"; empty = use column
+    size_t      column;      // 1-based column when key is empty; 0 = every number
+    char        delimiter;   // column separator; ' ' = runs of spaces and tabs
+
+    FieldSpec() : column(0), delimiter(' ') {}
+
+    bool active() const { return !key.empty() || column > 0; }
+
+    /*
+      Pre : none
+      Post: returns the spec in the form parseFieldSpec() reads back:
+            "-", "latency_ms", "3", "3," or "3t" (tab).
+    */
+    std::string text() const {
+        if (!key.empty()) return key;
+        if (column == 0) return "-";
+        std::string s = std::to_string(column);
+        if (delimiter == '\t') s += 't';
+        else if (delimiter != ' ') s += delimiter;
+        return s;
+    }
+
+    /*
+      Pre : none
+      Post: returns a short description for menus ("key latency_ms", ...).
+    */
+    std::string describe() const {
+        if (!key.empty()) return "key " + key;
+        if (column == 0) return "all numbers";
+        std::string s = "column " + std::to_string(column);
+        if (delimiter == '\t') s += " (tab-separated)";
+        else if (delimiter != ' ') s += std::string(" ('") + delimiter + "'-separated)";
+        return s;
+    }
+};
+
+/*
+  Pre : none
+  Post: returns true with spec set from text: "-" or "" = every number;
+        digits = that column on whitespace, optionally followed by one of
+        ",;|" or "t" (tab) as the delimiter; otherwise a key name made of
+        letters, digits and "_.-:". Returns false with the reason in error.
+*/
+inline bool parseFieldSpec(const std::string& text, FieldSpec& spec, std::string& error) {
+    const size_t b = text.find_first_not_of(" \t"), e = text.find_last_not_of(" \t");
+    const std::string t = b == std::string::npos ? std::string() : text.substr(b, e - b + 1);
+    FieldSpec s;
+    if (t.empty() || t == "-") { spec = s; return true; }
+    size_t i = 0;
+    while (i < t.size() && isdigit((unsigned char)t[i])) ++i;
+    if (i > 0 && i + 1 >= t.size()) {
+        if (i > 9) { error = "column number too large"; return false; }
+        s.column = (size_t)std::stoul(t.substr(0, i));
+        if (s.column == 0) { error = "columns count from 1"; return false; }
+        if (i < t.size()) {
+            const char d = t[i];
+            if (d == 't') s.delimiter = '\t';
+            else if (d == ',' || d == ';' || d == '|') s.delimiter = d;
+            else { error = std::string("unknown column delimiter '") + d + "'"; return false; }
+        }
+        spec = s;
+        return true;
+    }
+    for (char c : t)
+        if (!isalnum((unsigned char)c) && c != '_' && c != '.' && c != '-' && c != ':') {
+            error = std::string("a key may not contain '") + c + "'";
+            return false;
+        }
+    s.key = t;
+    spec = s;
+    return true;
+}
+
+class FieldScanner {
+public:
+    static const size_t kMaxLine = 1 << 20;   // a cut-off line held past this is skipped
+
+    explicit FieldScanner(const FieldSpec& spec = FieldSpec()) : _spec(spec), _skipped(0), _discard(false) {}
+
+    const FieldSpec& spec() const { return _spec; }
+
+    /*
+      Pre : p holds n bytes (may be null when n == 0)
+      Post: the field of every line finished within p appended to out;
+            returns how many values were appended.
+    */
+    size_t feed(const char* p, size_t n, std::vector<double>& out) {
+        if (!_spec.active()) return _numbers.feed(p, n, out);
+        const size_t before = out.size();
+        const char* const end = p + n;
+        if (!_tail.empty() || _discard) {   // finish the line cut off last time
+            const char* nl = static_cast<const char*>(memchr(p, '\n', n));
+            if (!nl) {
+                if (!_discard) _tail.append(p, n);
+                if (_tail.size() > kMaxLine) { _tail.clear(); _discard = true; ++_skipped; }
+                return 0;
+            }
+            if (_discard) _discard = false;
+            else { _tail.append(p, (size_t)(nl - p)); line(_tail.data(), _tail.data() + _tail.size(), out); }
+            _tail.clear();
+            p = nl + 1;
+        }
+        while (p < end) {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(end - p)));
+            if (!nl) {
+                if ((size_t)(end - p) > kMaxLine) { _discard = true; ++_skipped; }
+                else _tail.assign(p, (size_t)(end - p));
+                break;
+            }
+            line(p, nl, out);
+            p = nl + 1;
+        }
+        return out.size() - before;
+    }
+
+    /*
+      Pre : none
+      Post: the held line, if any, treated as the last one of the stream;
+            returns how many values were appended (0 or 1).
+    */
+    size_t finish(std::vector<double>& out) {
+        if (!_spec.active()) return _numbers.finish(out);
+        const size_t before = out.size();
+        if (!_tail.empty()) line(_tail.data(), _tail.data() + _tail.size(), out);
+        _tail.clear();
+        _discard = false;
+        return out.size() - before;
+    }
+
+    /*
+      Pre : none
+      Post: held line dropped and skipped() reset, for a new stream.
+    */
+    void reset() { _numbers.reset(); _tail.clear(); _skipped = 0; _discard = false; }
+
+    /*
+      Pre : none
+      Post: returns the lines without a usable field (or, taking every
+            number, the tokens that were not numbers).
+    */
+    size_t skipped() const { return _spec.active() ? _skipped : _numbers.skipped(); }
+
+private:
+    static bool separator(char c) { return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '&' || c == '|'; }
+
+    /*
+      Pre : [b, e) is a value, possibly quoted and padded
+      Post: returns true with v if it is entirely a number.
+    */
+    static bool number(const char* b, const char* e, double& v) {
+        while (b < e && (*b == ' ' || *b == '\t')) ++b;
+        while (e > b && (e[-1] == ' ' || e[-1] == '\t')) --e;
+        if (e - b >= 2 && (*b == '"' || *b == '\'') && e[-1] == *b) { ++b; --e; }
+        if (b < e && *b == '+') ++b;   // from_chars takes no '+'
+        if (b == e) return false;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        const std::from_chars_result r = std::from_chars(b, e, v);
+        return r.ec == std::errc() && r.ptr == e;
+#else
+        char buf[64];
+        const size_t n = (size_t)(e - b);
+        if (n >= sizeof buf) return false;
+        memcpy(buf, b, n);
+        buf[n] = '\0';
+        char* stop = nullptr;
+        errno = 0;
+        v = std::strtod(buf, &stop);
+        return stop == buf + n && errno != ERANGE && !isspace((unsigned char)buf[0]);
+#endif
+    }
+
+    /*
+      Pre : [b, e) is one line without its '\n'
+      Post: returns true with v if the line holds the field.
+    */
+    bool extract(const char* b, const char* e, double& v) const {
+        if (!_spec.key.empty()) {
+            const size_t k = _spec.key.size();
+            for (const char* q = b; q < e && (q = static_cast<const char*>(memchr(q, _spec.key[0], (size_t)(e - q)))) != nullptr; ++q) {
+                if ((size_t)(e - q) <= k || q[k] != '=' || memcmp(q, _spec.key.data(), k) != 0) continue;
+                if (q != b && !separator(q[-1])) continue;   // "xlatency_ms=" is another key
+                const char* vb = q + k + 1;
+                const char* ve = vb;
+                if (ve < e && (*ve == '"' || *ve == '\'')) {
+                    const char* close = static_cast<const char*>(memchr(ve + 1, *ve, (size_t)(e - ve - 1)));
+                    ve = close ? close + 1 : e;
+                }
+                else while (ve < e && !separator(*ve)) ++ve;
+                return number(vb, ve, v);
+            }
+            return false;
+        }
+        const char* f = b;
+        if (_spec.delimiter == ' ') {
+            for (size_t c = 0; ; ++c) {
+                while (f < e && (*f == ' ' || *f == '\t')) ++f;
+                if (f == e) return false;
+                const char* fe = f;
+                while (fe < e && *fe != ' ' && *fe != '\t') ++fe;
+                if (c + 1 == _spec.column) return number(f, fe, v);
+                f = fe;
+            }
+        }
+        for (size_t c = 1; c < _spec.column; ++c) {
+            f = static_cast<const char*>(memchr(f, _spec.delimiter, (size_t)(e - f)));
+            if (!f) return false;
+            ++f;
+        }
+        const char* fe = static_cast<const char*>(memchr(f, _spec.delimiter, (size_t)(e - f)));
+        return number(f, fe ? fe : e, v);
+    }
+
+    void line(const char* b, const char* e, std::vector<double>& out) {
+        if (e > b && e[-1] == '\r') --e;
+        if (b == e) return;   // blank lines are not counted
+        double v;
+        if (extract(b, e, v)) out.push_back(v);
+        else ++_skipped;
+    }
+
+    FieldSpec     _spec;
+    NumberScanner _numbers;   // used when _spec is not active
+    std::string   _tail;      // line cut off at the end of the last slice
+    size_t        _skipped;
+    bool          _discard;   // inside an over-long line; drop until '\n'
+};
@@ -0,0 +1,259 @@
+#pragma once
+/*
+    Program: FileFollower - read numbers appended to a growing text file
+
+    Description:
+      - Like "tail -f": remembers the byte offset it has read to, and each
+        poll() parses only the bytes appended since with a FieldScanner
+        (every number, or one field per line; misses are counted).
+      - A number still being written (no whitespace after it yet) is kept
+        back until the rest of it arrives.
+      - Rotation: if the path now names a different file (renamed away and
+        recreated), the old file is read to its end first and the new one
+        is followed from its start. A file truncated in place (copytruncate)
+        is followed from its new start.
+      - On Linux wait() sleeps on inotify (a watch on the file's directory,
+        filtered to its name), so an idle follower costs nothing; elsewhere,
+        or if inotify is unavailable, wait() sleeps for the timeout and the
+        caller polls. On Windows rotation is seen only as truncation.
+      - FollowThread runs poll()/wait() on a thread of its own and hands
+        every batch of new values to a callback.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>    // size_t
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "FieldScanner.h"
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#define FILEFOLLOWER_INOTIFY 1
+#endif
+
+/*
+  Outcome of one FileFollower::poll().
+*/
+struct FollowReport {
+    size_t bytes;       // bytes read
+    size_t values;      // numbers appended to the output
+    size_t skipped;     // tokens that were not numbers, or lines without the field
+    bool   rotated;     // switched to a new file at the same path
+    bool   truncated;   // file shrank; restarted from its beginning
+
+    FollowReport() : bytes(0), values(0), skipped(0), rotated(false), truncated(false) {}
+};
+
+class FileFollower {
+public:
+    FileFollower() : _offset(0), _dev(0), _ino(0), _notify(-1) {}
+    ~FileFollower() { close(); }
+
+    FileFollower(const FileFollower&) = delete;
+    FileFollower& operator=(const FileFollower&) = delete;
+
+    /*
+      Pre : none
+      Post: follows path from its start (fromStart) or from its current end,
+            taking fields per FieldScanner; returns false if path cannot be
+            opened.
+    */
+    bool open(const std::string& path, bool fromStart = true, const FieldSpec& fields = FieldSpec()) {
+        close();
+        _path = path;
+        _scan = FieldScanner(fields);
+        if (!reopen()) { _path.clear(); return false; }
+        if (!fromStart) { _in.seekg(0, std::ios::end); _offset = (std::streamoff)_in.tellg(); }
+#if defined(FILEFOLLOWER_INOTIFY)
+        const size_t slash = path.find_last_of('/');
+        const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        _name = slash == std::string::npos ? path : path.substr(slash + 1);
+        _notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (_notify >= 0 && inotify_add_watch(_notify, dir.c_str(),
+                IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ATTRIB) < 0) {
+            ::close(_notify);
+            _notify = -1;
+        }
+#endif
+        return true;
+    }
+
+    /*
+      Pre : none
+      Post: file and watch released; isOpen() == false.
+    */
+    void close() {
+        if (_in.is_open()) _in.close();
+#if defined(FILEFOLLOWER_INOTIFY)
+        if (_notify >= 0) ::close(_notify);
+#endif
+        _notify = -1;
+        _path.clear(); _scan.reset();
+        _offset = 0;
+    }
+
+    bool isOpen() const { return !_path.empty(); }
+    const std::string& path() const { return _path; }
+    const FieldSpec& fields() const { return _scan.spec(); }
+
+    /*
+      Pre : none
+      Post: returns true if wait() sleeps on change notifications rather
+            than on the timeout alone.
+    */
+    bool notified() const { return _notify >= 0; }
+
+    /*
+      Pre : isOpen()
+      Post: numbers from the bytes appended since the last poll() appended
+            to out; the follower switched files if the path was rotated.
+    */
+    FollowReport poll(std::vector<double>& out) {
+        FollowReport r;
+        if (!_in.is_open() && !reopen()) return r;   // rotated away, not yet recreated
+        _in.clear();
+        _in.seekg(0, std::ios::end);
+        const std::streamoff size = (std::streamoff)_in.tellg();
+        if (size < _offset) { _offset = 0; _scan.reset(); r.truncated = true; }
+        readNew(out, r);
+
+        struct stat st;
+        if (stat(_path.c_str(), &st) == 0 && (_ino != 0 || _dev != 0) && (st.st_ino != _ino || st.st_dev != _dev)) {
+            // the old file is read to its end: its last token is complete
+            r.values += _scan.finish(out);
+            if (reopen()) { r.rotated = true; readNew(out, r); }
+        }
+        return r;
+    }
+
+    /*
+      Pre : isOpen()
+      Post: returns after the followed file may have changed, or after
+            timeoutMs; true means a change notification arrived.
+    */
+    bool wait(int timeoutMs) {
+#if defined(FILEFOLLOWER_INOTIFY)
+        if (_notify >= 0) {
+            pollfd p = { _notify, POLLIN, 0 };
+            if (::poll(&p, 1, timeoutMs) <= 0) return false;
+            bool ours = false;
+            alignas(inotify_event) char buf[4096];
+            ssize_t n;
+            while ((n = ::read(_notify, buf, sizeof buf)) > 0) {
+                for (ssize_t i = 0; i < n; ) {
+                    const inotify_event* ev = reinterpret_cast<const inotify_event*>(buf + i);
+                    if (ev->len == 0 || _name == ev->name) ours = true;
+                    i += (ssize_t)(sizeof(inotify_event) + ev->len);
+                }
+            }
+            return ours;
+        }
+#endif
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        return false;
+    }
+
+private:
+    static const size_t kChunk = 1 << 16;
+
+    /*
+      Pre : _path set
+      Post: _in opened at offset 0 with the file's identity noted; false if
+            the path does not exist now.
+    */
+    bool reopen() {
+        if (_in.is_open()) _in.close();
+        _in.clear();
+        _in.open(_path, std::ios::binary);
+        _offset = 0; _scan.reset();
+        if (!_in) return false;
+        struct stat st;
+        if (stat(_path.c_str(), &st) == 0) { _dev = (unsigned long long)st.st_dev; _ino = (unsigned long long)st.st_ino; }
+        return true;
+    }
+
+    void readNew(std::vector<double>& out, FollowReport& r) {
+        _in.clear();
+        _in.seekg(_offset);
+        char buf[kChunk];
+        while (_in.read(buf, sizeof buf) || _in.gcount() > 0) {
+            const size_t got = (size_t)_in.gcount();
+            _offset += (std::streamoff)got;
+            r.bytes += got;
+            const size_t skipped = _scan.skipped();
+            r.values += _scan.feed(buf, got, out);
+            r.skipped += _scan.skipped() - skipped;
+            if (got < sizeof buf) break;
+        }
+        _in.clear();
+    }
+
+    std::string        _path;
+    std::string        _name;     // file name within its directory (inotify filter)
+    std::ifstream      _in;
+    std::streamoff     _offset;   // bytes of _in consumed
+    FieldScanner       _scan;     // holds a token or line not yet finished
+    unsigned long long _dev, _ino;
+    int                _notify;   // inotify descriptor, -1 if none
+};
+
+class FollowThread {
+public:
+    FollowThread() : _stop(false) {}
+    ~FollowThread() { stop(); }
+
+    FollowThread(const FollowThread&) = delete;
+    FollowThread& operator=(const FollowThread&) = delete;
+
+    /*
+      Pre : not running; onValues is safe to call from another thread and
+            returns true once it has taken the values (false = keep them
+            and offer them again after the next wake)
+      Post: returns false if path cannot be opened; otherwise path is
+            followed from its start on a background thread until stop().
+    */
+    template <class Fn>
+    bool start(const std::string& path, Fn onValues, const FieldSpec& fields = FieldSpec()) {
+        if (!_follower.open(path, true, fields)) return false;
+        _stop = false;
+        _thread = std::thread([this, onValues]() mutable {
+            std::vector<double> pending;
+            FollowReport total;
+            while (!_stop) {
+                FollowReport r = _follower.poll(pending);
+                total.values += r.values; total.skipped += r.skipped; total.bytes += r.bytes;
+                total.rotated |= r.rotated; total.truncated |= r.truncated;
+                if ((!pending.empty() || total.skipped) && onValues(pending, total)) { pending.clear(); total = FollowReport(); }
+                if (!_stop) _follower.wait(kWakeMs);
+            }
+        });
+        return true;
+    }
+
+    /*
+      Pre : none
+      Post: thread joined (within about kWakeMs) and the file closed.
+    */
+    void stop() {
+        _stop = true;
+        if (_thread.joinable()) _thread.join();
+        _follower.close();
+    }
+
+    bool running() const { return _thread.joinable(); }
+    const std::string& path() const { return _follower.path(); }
+    const FieldSpec& fields() const { return _follower.fields(); }
+
+private:
+    static const int kWakeMs = 500;   // upper bound on stop() latency and on polling without inotify
+
+    FileFollower      _follower;
+    std::atomic<bool> _stop;
+    std::thread       _thread;
+};
@@ -0,0 +1,257 @@
+#pragma once
+/*
+    Program: FixedStatsArray - fixed-capacity StatsArray for tiny datasets
+
+    Description:
+      - Holds at most N values inline; never allocates.
+      - Unused slots are padded with +infinity so the whole array can be
+        sorted by a sorting network fixed at compile time (Batcher
+        odd-even merge sort), with branchless compare-exchange steps.
+      - insert() runs one fixed column of compare-exchanges instead of a
+        search and shift.
+      - Loops run over the compile-time N, so the compiler unrolls them.
+      - Construction and most statistics are constexpr (C++14), e.g.
+          constexpr FixedStatsArray<5> a{ 3, 1, 4, 1, 5 };
+          static_assert(a.median() == 3, "");
+      - Throws the same exceptions as StatsArray for invalid dataset sizes.
+*/
+
+#include <cassert>
+#include <cstddef>           // size_t
+#include <cmath>             // sqrt
+#include <initializer_list>
+#include <limits>            // numeric_limits
+#include <utility>           // index_sequence
+#include "StatsArray.h"      // DatasetEmptyException, InsufficientDataException
+
+// ---------------- Sorting network ----------------
+
+/*
+  Pre : a and b are both null, or both hold room for every comparator
+  Post: returns the number of comparators of Batcher's odd-even merge sort
+        for n inputs; when a/b are given, comparator c is (a[c], b[c]).
+*/
+constexpr size_t batcherNetwork(size_t n, size_t* a, size_t* b) {
+    size_t c = 0;
+    for (size_t p = 1; p < n; p <<= 1)
+        for (size_t k = p; k >= 1; k >>= 1)
+            for (size_t j = k % p; j + k < n; j += 2 * k)
+                for (size_t i = 0; i < k && i + j + k < n; ++i)
+                    if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) {
+                        if (a) { a[c] = i + j; b[c] = i + j + k; }
+                        ++c;
+                    }
+    return c;
+}
+
+/*
+  Compile-time comparator table for N inputs.
+*/
+template <size_t N>
+struct SortNetwork {
+    static constexpr size_t kSize = batcherNetwork(N, nullptr, nullptr);
+
+    struct Table { size_t a[kSize ? kSize : 1]; size_t b[kSize ? kSize : 1]; };
+
+    static constexpr Table table() { Table t{}; batcherNetwork(N, t.a, t.b); return t; }
+};
+
+/*
+  Pre : none
+  Post: x <= y; branchless (compiles to min/max).
+*/
+constexpr void compareExchange(double& x, double& y) {
+    const double lo = y < x ? y : x, hi = y < x ? x : y;
+    x = lo; y = hi;
+}
+
+/*
+  Pre : v holds N values
+  Post: v sorted ascending; one compare-exchange per comparator, fully unrolled.
+*/
+template <size_t N, size_t... I>
+constexpr void applySortNetwork(double* v, std::index_sequence<I...>) {
+    constexpr typename SortNetwork<N>::Table t = SortNetwork<N>::table();
+    int order[] = { 0, (compareExchange(v[t.a[I]], v[t.b[I]]), 0)... };
+    (void)order; (void)t; (void)v;
+}
+
+// ---------------- FixedStatsArray ----------------
+
+template <size_t N>
+class FixedStatsArray {
+    static_assert(N >= 1, "FixedStatsArray needs room for at least one value.");
+
+public:
+    /*
+      Pre : none
+      Post: creates empty container.
+    */
+    constexpr FixedStatsArray() : _v{}, _n(0) { clear(); }
+
+    /*
+      Pre : xs.size() <= N; values finite
+      Post: holds xs in ascending order.
+    */
+    constexpr FixedStatsArray(std::initializer_list<double> xs) : _v{}, _n(0) {
+        assert(xs.size() <= N);
+        clear();
+        for (double x : xs) _v[_n++] = x;
+        sortAll();
+    }
+
+    /*
+      Pre : M <= N; values finite
+      Post: holds xs in ascending order.
+    */
+    template <size_t M>
+    constexpr explicit FixedStatsArray(const double(&xs)[M]) : _v{}, _n(0) {
+        static_assert(M <= N, "Too many values for this FixedStatsArray.");
+        clear();
+        for (size_t i = 0; i < M; ++i) _v[_n++] = xs[i];
+        sortAll();
+    }
+
+    // ============================== Modifiers =============================
+
+    /*
+      Pre : x is finite
+      Post: returns false if full; else x inserted, ascending order kept.
+    */
+    constexpr bool insert(double x) {
+        if (_n == N) return false;
+        // the last slot is padding; overwrite it and sink x into place
+        _v[N - 1] = x;
+        for (size_t i = N - 1; i > 0; --i) compareExchange(_v[i - 1], _v[i]);
+        ++_n;
+        return true;
+    }
+
+    /*
+      Pre : none
+      Post: container emptied.
+    */
+    constexpr void clear() {
+        for (size_t i = 0; i < N; ++i) _v[i] = kPad;
+        _n = 0;
+    }
+
+    // ============================== Accessors =============================
+
+    /*
+      Pre : none
+      Post: returns number of stored elements.
+    */
+    constexpr size_t size() const { return _n; }
+
+    /*
+      Pre : none
+      Post: returns N.
+    */
+    static constexpr size_t capacity() { return N; }
+
+    /*
+      Pre : idx < size()
+      Post: returns value at idx.
+    */
+    constexpr double at(size_t idx) const { assert(idx < _n); return _v[idx]; }
+
+    // ============================== Statistics ============================
+
+    /*
+      Pre : size() >= 1
+      Post: returns minimum.
+    */
+    constexpr double min() const { requireSize(1, "Minimum"); return _v[0]; }
+
+    /*
+      Pre : size() >= 1
+      Post: returns maximum.
+    */
+    constexpr double max() const { requireSize(1, "Maximum"); return _v[_n - 1]; }
+
+    /*
+      Pre : size() >= 1
+      Post: returns max - min.
+    */
+    constexpr double range() const { requireSize(1, "Range"); return _v[_n - 1] - _v[0]; }
+
+    /*
+      Pre : size() >= 1
+      Post: returns sum of all values.
+    */
+    constexpr double sum() const {
+        requireSize(1, "Sum");
+        long double s = 0.0L;
+        for (size_t i = 0; i < N; ++i) s += i < _n ? (long double)_v[i] : 0.0L;
+        return (double)s;
+    }
+
+    /*
+      Pre : size() >= 1
+      Post: returns arithmetic mean.
+    */
+    constexpr double mean() const { requireSize(1, "Mean"); return sum() / (double)_n; }
+
+    /*
+      Pre : size() >= 1
+      Post: returns median of sorted data.
+    */
+    constexpr double median() const {
+        requireSize(1, "Median");
+        const size_t m = _n / 2; return (_n % 2) ? _v[m] : (_v[m - 1] + _v[m]) / 2.0;
+    }
+
+    /*
+      Pre : sample ? size() >= 2 : size() >= 1
+      Post: returns variance (sample uses n-1; population uses n).
+    */
+    constexpr double variance(bool sample) const {
+        if (sample) requireSize(2, "Variance (sample)"); else requireSize(1, "Variance (population)");
+        const long double mu = mean();
+        long double ss = 0.0L;
+        for (size_t i = 0; i < N; ++i) { const long double d = i < _n ? _v[i] - mu : 0.0L; ss += d * d; }
+        return (double)(ss / (long double)(sample ? _n - 1 : _n));
+    }
+
+    /*
+      Pre : sample ? size() >= 2 : size() >= 1
+      Post: returns standard deviation (not constexpr: sqrt).
+    */
+    double stdev(bool sample) const { return std::sqrt(variance(sample)); }
+
+    /*
+      Pre : size() >= 1
+      Post: returns (min + max)/2.
+    */
+    constexpr double midrange() const { requireSize(1, "Midrange"); return (_v[0] + _v[_n - 1]) / 2.0; }
+
+    /*
+      Pre : size() >= 1
+      Post: returns sum of squares.
+    */
+    constexpr double sumSquares() const {
+        requireSize(1, "Sum of Squares");
+        long double s = 0.0L;
+        for (size_t i = 0; i < N; ++i) s += i < _n ? (long double)_v[i] * _v[i] : 0.0L;
+        return (double)s;
+    }
+
+private:
+    double _v[N];   // ascending; slots [_n..N) hold kPad
+    size_t _n;
+
+    static constexpr double kPad = std::numeric_limits<double>::infinity();
+
+    constexpr void sortAll() { applySortNetwork<N>(_v, std::make_index_sequence<SortNetwork<N>::kSize>()); }
+
+    /*
+      Pre : need >= 1; what is a short label
+      Post: throws DatasetEmptyException if size()==0;
+            throws InsufficientDataException if size()<need.
+    */
+    constexpr void requireSize(size_t need, const char* what) const {
+        if (_n == 0) throw DatasetEmptyException("Dataset is empty.");
+        if (_n < need) throw InsufficientDataException(std::string(what) + " requires at least " + std::to_string(need) + " value(s).");
+    }
+};
@@ -0,0 +1,156 @@
+#pragma once
+/*
+    Program: GzipInput - stream gzip-compressed input in decompressed chunks
+
+    Description:
+      - isGzip() recognizes the gzip magic bytes, so a loader can pick the
+        path by content rather than by file name.
+      - inflateChunks() decompresses a gzip image (one or more concatenated
+        members, as "cat a.gz b.gz" or pigz produce) and hands the text to
+        a consumer in chunks. A second thread inflates ahead into a small
+        ring of buffers while the caller's thread consumes, so inflate and
+        parsing overlap; nothing is written to disk.
+      - Uses zlib when <zlib.h> is available (link with -lz; on MSVC the
+        zlib.lib import library is requested automatically). Without it, or
+        with STATSARRAY_NO_ZLIB defined, gzipSupported() is false and
+        inflateChunks() returns an error.
+*/
+
+#include <condition_variable>
+#include <cstddef>    // size_t
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#if !defined(STATSARRAY_NO_ZLIB) && defined(__has_include)
+#if __has_include(<zlib.h>)
+#include <zlib.h>
+#define GZIPINPUT_ZLIB 1
+#if defined(_MSC_VER)
+#pragma comment(lib, "zlib")
+#endif
+#endif
+#endif
+
+/*
+  Pre : p holds n bytes
+  Post: returns true if they start like a gzip stream.
+*/
+inline bool isGzip(const unsigned char* p, size_t n) { return n >= 2 && p[0] == 0x1f && p[1] == 0x8b; }
+
+inline bool gzipSupported() {
+#if defined(GZIPINPUT_ZLIB)
+    return true;
+#else
+    return false;
+#endif
+}
+
+namespace gzipinput {
+
+const size_t kChunk = 1 << 18;     // decompressed bytes per buffer
+const size_t kBuffers = 3;         // ring: one being parsed, the rest filled ahead
+
+} // namespace gzipinput
+
+/*
+  Pre : data holds n bytes of gzip; consume(const char* text, size_t len,
+        size_t consumed) takes each decompressed chunk in order, consumed
+        being the compressed bytes read so far
+  Post: every member decompressed and consumed; returns null, or a static
+        message if the data is corrupt or truncated (chunks before the
+        damage have been consumed).
+*/
+template <class Consume>
+inline const char* inflateChunks(const unsigned char* data, size_t n, Consume consume) {
+#if defined(GZIPINPUT_ZLIB)
+    using namespace gzipinput;
+    struct Filled { size_t buffer, len, consumed; };
+    std::vector<std::vector<char>> buffers(kBuffers, std::vector<char>(kChunk));
+    std::deque<size_t> idle;      // buffers free to fill
+    for (size_t i = 0; i < kBuffers; ++i) idle.push_back(i);
+    std::deque<Filled> ready;     // filled, in stream order
+    std::mutex m;
+    std::condition_variable cv;
+    bool finished = false, abandon = false;
+    const char* error = nullptr;
+
+    std::thread producer([&]() {
+        z_stream zs = z_stream();
+        const char* err = nullptr;
+        if (inflateInit2(&zs, 15 + 32) != Z_OK) err = "cannot start decompression";   // 32: gzip or zlib header
+        size_t in = 0;
+        bool member = true;   // inside a member (vs. between members)
+        while (!err) {
+            size_t b;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&] { return !idle.empty() || abandon; });
+                if (abandon) break;
+                b = idle.front(); idle.pop_front();
+            }
+            zs.next_out = reinterpret_cast<Bytef*>(buffers[b].data());
+            zs.avail_out = (uInt)kChunk;
+            while (zs.avail_out > 0) {
+                if (zs.avail_in == 0 && in < n) {
+                    const size_t take = n - in < ((size_t)1 << 30) ? n - in : ((size_t)1 << 30);
+                    zs.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data + in));
+                    zs.avail_in = (uInt)take;
+                    in += take;
+                }
+                if (!member) {
+                    // another member follows only if the gzip magic does
+                    const size_t at = in - zs.avail_in;
+                    if (n - at < 2 || !isGzip(data + at, n - at)) { in = n; zs.avail_in = 0; break; }
+                    inflateReset(&zs);
+                    member = true;
+                }
+                const int rc = inflate(&zs, Z_NO_FLUSH);
+                if (rc == Z_STREAM_END) { member = false; continue; }
+                if (rc == Z_BUF_ERROR && zs.avail_in == 0 && in == n) { err = "compressed data is truncated"; break; }
+                if (rc != Z_OK) { err = zs.msg ? "compressed data is corrupt" : "decompression failed"; break; }
+            }
+            const size_t len = kChunk - zs.avail_out;
+            const bool done = !member && zs.avail_in == 0 && in == n;
+            std::lock_guard<std::mutex> lock(m);
+            if (len) ready.push_back(Filled{ b, len, (size_t)(in - zs.avail_in) });
+            else idle.push_back(b);
+            cv.notify_all();
+            if (done) break;
+        }
+        inflateEnd(&zs);
+        std::lock_guard<std::mutex> lock(m);
+        if (err) error = err;
+        finished = true;
+        cv.notify_all();
+    });
+
+    try {
+        while (true) {
+            Filled f;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&] { return !ready.empty() || finished; });
+                if (ready.empty()) break;
+                f = ready.front(); ready.pop_front();
+            }
+            consume(buffers[f.buffer].data(), f.len, f.consumed);
+            std::lock_guard<std::mutex> lock(m);
+            idle.push_back(f.buffer);
+            cv.notify_all();
+        }
+    }
+    catch (...) {
+        { std::lock_guard<std::mutex> lock(m); abandon = true; }
+        cv.notify_all();
+        producer.join();
+        throw;
+    }
+    producer.join();
+    return error;
+#else
+    (void)data; (void)n; (void)consume;
+    return "gzip input needs zlib, which this build lacks";
+#endif
+}
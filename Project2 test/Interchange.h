@@ -0,0 +1,594 @@
+#pragma once
+/*
+    Program: Interchange - NumPy .npy and Arrow IPC columns for StatsArray
+
+    Description:
+      - Readers map the file (MappedFile) and take one numeric column:
+        float64, float32 or 8..64-bit signed/unsigned integers, either
+        byte order. .npy arrays of any shape are read as one flat column.
+      - A float64 column in host byte order that is finite, already sorted
+        and has no nulls is adopted in place (StatsArray::adoptSorted) when
+        the target array is empty: no parse, no copy, no sort.
+      - Anything else is decoded once and handed to insertBulk(), which
+        validates NaN/Inf under the caller's policy and sorts.
+      - Arrow columns written by saveArrow() carry the field metadata
+        "statsarray.sorted" = "ascending" and skip the sortedness check;
+        other inputs get one linear check.
+      - Writers export the sorted dataset: .npy as a 1-D float64 array,
+        Arrow as a one-column IPC file (format V5, one record batch).
+      - Plain uncompressed layouts only; no external libraries.
+*/
+
+#include <cassert>
+#include <cstddef>    // size_t
+#include <cstdint>
+#include <cstdlib>    // atoi
+#include <cstring>    // memcpy, memcmp
+#include <cmath>      // isfinite
+#include <string>
+#include <vector>
+#include <memory>     // shared_ptr
+#include <fstream>
+#include <initializer_list>
+#include "StatsArray.h"
+#include "MappedFile.h"
+
+/*
+  Outcome of loadNpy()/loadArrow().
+*/
+struct ColumnLoad {
+    const char*  error;     // null on success; static message otherwise
+    size_t       rows;      // values in the column (nulls included)
+    size_t       nulls;     // Arrow null slots skipped
+    bool         zeroCopy;  // adopted in place from the mapping
+    IngestReport ingest;    // NaN/Inf handling when decoded
+
+    ColumnLoad() : error(nullptr), rows(0), nulls(0), zeroCopy(false) {}
+
+    bool ok() const { return error == nullptr; }
+};
+
+namespace interchange {
+
+// ---------------- Byte order ----------------
+
+inline bool hostLittleEndian() { const uint16_t x = 1; unsigned char c; memcpy(&c, &x, 1); return c == 1; }
+
+/*
+  Pre : p has n readable bytes, n <= 8
+  Post: returns the little-endian unsigned integer at p.
+*/
+inline uint64_t getLE(const unsigned char* p, size_t n) {
+    uint64_t v = 0;
+    for (size_t i = n; i-- > 0; ) v = (v << 8) | p[i];
+    return v;
+}
+
+inline void putLE(unsigned char* p, uint64_t v, size_t n) { for (size_t i = 0; i < n; ++i) { p[i] = (unsigned char)v; v >>= 8; } }
+
+// ---------------- Element decoding ----------------
+
+/*
+  One column element type: 'f' (float), 'i' (signed) or 'u' (unsigned),
+  its width in bytes, and its byte order.
+*/
+struct ElemType {
+    char     kind;
+    unsigned bytes;
+    bool     bigEndian;
+};
+
+/*
+  Pre : t is a supported type (f4/f8, i/u 1..8)
+  Post: returns the element at p as double.
+*/
+inline double decodeElem(const unsigned char* p, const ElemType& t) {
+    uint64_t raw = 0;
+    if (t.bigEndian) for (unsigned i = 0; i < t.bytes; ++i) raw = (raw << 8) | p[i];
+    else raw = getLE(p, t.bytes);
+    if (t.kind == 'f') {
+        if (t.bytes == 8) { double d; memcpy(&d, &raw, 8); return d; }
+        uint32_t r32 = (uint32_t)raw; float f; memcpy(&f, &r32, 4); return (double)f;
+    }
+    if (t.kind == 'u') return (double)raw;
+    // sign-extend
+    const unsigned shift = 64 - 8 * t.bytes;
+    return (double)((int64_t)(raw << shift) >> shift);
+}
+
+inline bool supported(const ElemType& t) {
+    if (t.kind == 'f') return t.bytes == 4 || t.bytes == 8;
+    return (t.kind == 'i' || t.kind == 'u') && (t.bytes == 1 || t.bytes == 2 || t.bytes == 4 || t.bytes == 8);
+}
+
+/*
+  Pre : t is float64 in host byte order
+  Post: returns true if p can be read as double* in place.
+*/
+inline bool adoptable(const unsigned char* p, const ElemType& t) {
+    return t.kind == 'f' && t.bytes == 8 && t.bigEndian != hostLittleEndian() && ((uintptr_t)p % alignof(double)) == 0;
+}
+
+/*
+  Pre : a holds n doubles
+  Post: returns true if a is ascending and every value finite (one pass).
+*/
+inline bool sortedFinite(const double* a, size_t n) {
+    if (n == 0) return true;
+    for (size_t i = 0; i + 1 < n; ++i) if (!(a[i] <= a[i + 1])) return false;   // false on NaN too
+    return std::isfinite(a[0]) && std::isfinite(a[n - 1]);
+}
+
+/*
+  Pre : p holds n elements of t; validity is null or an Arrow LSB bitmap
+  Post: appends the non-null values to out as doubles; returns nulls skipped.
+*/
+inline size_t decodeColumn(const unsigned char* p, size_t n, const ElemType& t, const unsigned char* validity, std::vector<double>& out) {
+    size_t nulls = 0;
+    out.reserve(out.size() + n);
+    for (size_t i = 0; i < n; ++i) {
+        if (validity && !((validity[i >> 3] >> (i & 7)) & 1)) { ++nulls; continue; }
+        out.push_back(decodeElem(p + i * t.bytes, t));
+    }
+    return nulls;
+}
+
+/*
+  Pre : file stays mapped while arr may borrow from it
+  Post: column handed to arr (adopted in place when possible, else decoded
+        and inserted with policy); res updated.
+*/
+inline void deliver(const std::shared_ptr<MappedFile>& file, const unsigned char* p, size_t n, const ElemType& t,
+    bool flaggedSorted, StatsArray& arr, IngestPolicy policy, ColumnLoad& res) {
+    res.rows += n;
+    if (arr.size() == 0 && n > 0 && adoptable(p, t)) {
+        const double* a = reinterpret_cast<const double*>(p);
+        bool ok = flaggedSorted ? (std::isfinite(a[0]) && std::isfinite(a[n - 1])) : sortedFinite(a, n);
+        if (ok) { arr.adoptSorted(a, n, file); res.zeroCopy = true; res.ingest.inserted = n; return; }
+    }
+    std::vector<double> vals;
+    decodeColumn(p, n, t, nullptr, vals);
+    res.ingest = arr.insertBulk(vals.data(), vals.size(), policy);
+}
+
+// ---------------- FlatBuffers (Arrow metadata) ----------------
+
+/*
+  Bounds-checked reader for the few FlatBuffers tables Arrow uses.
+  Positions are byte offsets into the buffer; 0 means "absent"
+  (offset 0 is always the root offset, never a table).
+*/
+class FlatReader {
+public:
+    FlatReader(const unsigned char* b, size_t n) : _b(b), _n(n), _bad(false) {}
+
+    bool bad() const { return _bad; }
+
+    uint64_t get(size_t at, size_t bytes) {
+        if (at > _n || bytes > _n - at) { _bad = true; return 0; }
+        return getLE(_b + at, bytes);
+    }
+
+    size_t root() { return (size_t)get(0, 4); }
+
+    /*
+      Pre : table is a table position
+      Post: returns position of field id, or 0 if absent.
+    */
+    size_t field(size_t table, unsigned id) {
+        if (!table) return 0;
+        int32_t so = (int32_t)(uint32_t)get(table, 4);
+        size_t vt = (size_t)((int64_t)table - so);
+        size_t vtSize = (size_t)get(vt, 2);
+        if (4 + 2 * (size_t)id + 2 > vtSize) return 0;
+        size_t off = (size_t)get(vt + 4 + 2 * id, 2);
+        return off ? table + off : 0;
+    }
+
+    uint64_t scalar(size_t table, unsigned id, size_t bytes, uint64_t def = 0) {
+        size_t f = field(table, id);
+        return f ? get(f, bytes) : def;
+    }
+
+    /*
+      Pre : none
+      Post: follows the offset in field id; returns target position or 0.
+    */
+    size_t ref(size_t table, unsigned id) {
+        size_t f = field(table, id);
+        return f ? f + (size_t)get(f, 4) : 0;
+    }
+
+    size_t length(size_t vec) { return vec ? (size_t)get(vec, 4) : 0; }
+
+    /*
+      Pre : vec is a vector of tables/strings
+      Post: returns position of element i.
+    */
+    size_t element(size_t vec, size_t i) { size_t at = vec + 4 + 4 * i; return at + (size_t)get(at, 4); }
+
+    std::string str(size_t pos) {
+        size_t len = length(pos);
+        if (!pos || pos + 4 > _n || len > _n - pos - 4) return std::string();
+        return std::string(reinterpret_cast<const char*>(_b + pos + 4), len);
+    }
+
+private:
+    const unsigned char* _b;
+    size_t               _n;
+    bool                 _bad;
+};
+
+/*
+  Front-to-back FlatBuffers writer: a table is written before its
+  children, leaving offset slots that link() fills once the child exists,
+  so every offset points forward. Values are stored little-endian.
+*/
+class FlatBuilder {
+public:
+    /*
+      Inline table field: id in the schema, width in bytes (0 = offset slot).
+    */
+    struct Field { unsigned id; unsigned bytes; uint64_t value; };
+
+    std::vector<unsigned char> buf;
+
+    FlatBuilder() { slot(); }   // root offset
+
+    void pad(size_t a) { while (buf.size() % a) buf.push_back(0); }
+
+    size_t put(uint64_t v, size_t bytes) {
+        pad(bytes); size_t at = buf.size(); buf.resize(at + bytes); putLE(&buf[at], v, bytes); return at;
+    }
+
+    size_t slot() { return put(0, 4); }
+
+    void link(size_t slotAt, size_t target) { assert(target > slotAt); putLE(&buf[slotAt], target - slotAt, 4); }
+
+    /*
+      Pre : fields in layout order; slots has room for one entry per offset field
+      Post: vtable + table written; returns table position; slots[k] = position
+            of the k-th offset field.
+    */
+    size_t table(std::initializer_list<Field> fields, size_t* slots) {
+        unsigned maxId = 0;
+        for (const Field& f : fields) if (f.id > maxId) maxId = f.id;
+        pad(2);
+        const size_t vt = buf.size(), vtSize = 4 + 2 * (size_t)(maxId + 1);
+        buf.resize(vt + vtSize, 0);
+        pad(4);
+        const size_t tbl = put(0, 4);
+        putLE(&buf[tbl], (uint32_t)(tbl - vt), 4);
+        size_t k = 0;
+        for (const Field& f : fields) {
+            size_t at = f.bytes ? put(f.value, f.bytes) : put(0, 4);
+            if (!f.bytes) slots[k++] = at;
+            putLE(&buf[vt + 4 + 2 * f.id], at - tbl, 2);
+        }
+        putLE(&buf[vt], vtSize, 2);
+        putLE(&buf[vt + 2], buf.size() - tbl, 2);
+        return tbl;
+    }
+
+    /*
+      Pre : n elements of elemBytes each in data
+      Post: struct vector written (length + elements aligned to align); returns its position.
+    */
+    size_t structs(const void* data, size_t n, size_t elemBytes, size_t align) {
+        while ((buf.size() + 4) % align) buf.push_back(0);
+        size_t at = put(n, 4);
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        buf.insert(buf.end(), p, p + n * elemBytes);
+        return at;
+    }
+
+    /*
+      Pre : slots has room for n entries
+      Post: vector of n offsets written; slots[i] = position of entry i.
+    */
+    size_t offsets(size_t n, size_t* slots) {
+        size_t at = put(n, 4);
+        for (size_t i = 0; i < n; ++i) slots[i] = put(0, 4);
+        return at;
+    }
+
+    size_t str(const std::string& s) {
+        size_t at = put(s.size(), 4);
+        buf.insert(buf.end(), s.begin(), s.end()); buf.push_back(0);
+        return at;
+    }
+};
+
+// Arrow Schema.fbs / Message.fbs / File.fbs identifiers used here.
+enum ArrowType { ARROW_NULL = 1, ARROW_INT = 2, ARROW_FLOAT = 3, ARROW_BINARY = 4, ARROW_UTF8 = 5, ARROW_BOOL = 6,
+    ARROW_DECIMAL = 7, ARROW_DATE = 8, ARROW_TIME = 9, ARROW_TIMESTAMP = 10, ARROW_INTERVAL = 11, ARROW_LIST = 12,
+    ARROW_STRUCT = 13, ARROW_FIXED_BINARY = 15, ARROW_FIXED_LIST = 16, ARROW_MAP = 17, ARROW_DURATION = 18,
+    ARROW_LARGE_BINARY = 19, ARROW_LARGE_UTF8 = 20, ARROW_LARGE_LIST = 21 };
+const unsigned kArrowV5 = 4;
+const unsigned kHeaderSchema = 1, kHeaderRecordBatch = 3;
+const char* const kSortedKey = "statsarray.sorted";
+
+/*
+  Pre : field is a Field table
+  Post: adds the field-node and buffer counts of field and its children;
+        returns false for layouts this reader does not know.
+*/
+inline bool arrowLayout(FlatReader& fr, size_t field, size_t& nodes, size_t& buffers) {
+    unsigned t = (unsigned)fr.scalar(field, 2, 1);
+    ++nodes;
+    switch (t) {
+    case ARROW_NULL: break;
+    case ARROW_INT: case ARROW_FLOAT: case ARROW_BOOL: case ARROW_DECIMAL: case ARROW_DATE: case ARROW_TIME:
+    case ARROW_TIMESTAMP: case ARROW_INTERVAL: case ARROW_FIXED_BINARY: case ARROW_DURATION: buffers += 2; break;
+    case ARROW_BINARY: case ARROW_UTF8: case ARROW_LARGE_BINARY: case ARROW_LARGE_UTF8: buffers += 3; break;
+    case ARROW_LIST: case ARROW_LARGE_LIST: case ARROW_MAP: buffers += 2; break;
+    case ARROW_STRUCT: case ARROW_FIXED_LIST: buffers += 1; break;
+    default: return false;
+    }
+    size_t kids = fr.ref(field, 5);
+    for (size_t i = 0; i < fr.length(kids); ++i) if (!arrowLayout(fr, fr.element(kids, i), nodes, buffers)) return false;
+    return !fr.bad();
+}
+
+/*
+  Pre : fields vector of the schema
+  Post: returns the column element type of field, or kind 0 if not numeric.
+*/
+inline ElemType arrowElemType(FlatReader& fr, size_t field, bool bigEndian) {
+    ElemType t = { 0, 0, bigEndian };
+    unsigned tt = (unsigned)fr.scalar(field, 2, 1);
+    size_t type = fr.ref(field, 3);
+    if (tt == ARROW_INT) {
+        int32_t bits = (int32_t)(uint32_t)fr.scalar(type, 0, 4);
+        t.kind = fr.scalar(type, 1, 1) ? 'i' : 'u'; t.bytes = (unsigned)(bits / 8);
+    }
+    else if (tt == ARROW_FLOAT) {
+        unsigned prec = (unsigned)fr.scalar(type, 0, 2);   // 0 half, 1 single, 2 double
+        if (prec == 1) { t.kind = 'f'; t.bytes = 4; } else if (prec == 2) { t.kind = 'f'; t.bytes = 8; }
+    }
+    if (t.kind && !supported(t)) t.kind = 0;
+    return t;
+}
+
+/*
+  Pre : kvs is a [KeyValue] vector (may be 0)
+  Post: returns true if it holds statsarray.sorted = ascending.
+*/
+inline bool arrowSortedFlag(FlatReader& fr, size_t kvs) {
+    for (size_t i = 0; i < fr.length(kvs); ++i) {
+        size_t kv = fr.element(kvs, i);
+        if (fr.str(fr.ref(kv, 0)) == kSortedKey && fr.str(fr.ref(kv, 1)) == "ascending") return true;
+    }
+    return false;
+}
+
+/*
+  Pre : fb finished
+  Post: appends an encapsulated IPC message (continuation, length, metadata
+        padded to 8) to out; returns the metadata size including the prefix.
+*/
+inline size_t appendMessage(std::vector<unsigned char>& out, const FlatBuilder& fb) {
+    size_t len = (fb.buf.size() + 7) / 8 * 8;
+    unsigned char pre[8]; putLE(pre, 0xFFFFFFFFu, 4); putLE(pre + 4, len, 4);
+    out.insert(out.end(), pre, pre + 8);
+    out.insert(out.end(), fb.buf.begin(), fb.buf.end());
+    out.resize(out.size() + (len - fb.buf.size()), 0);
+    return 8 + len;
+}
+
+/*
+  Pre : slot is an offset slot in fb
+  Post: writes a one-field Schema (float64, not nullable, sorted flag) at slot.
+*/
+inline void writeSchema(FlatBuilder& fb, size_t slot, const std::string& column) {
+    size_t s[4];
+    size_t schema = fb.table({ { 0, 2, 0 }, { 1, 0, 0 } }, s);   // endianness Little, fields
+    fb.link(slot, schema);
+    size_t fieldSlot;
+    fb.link(s[0], fb.offsets(1, &fieldSlot));
+    size_t f[4];
+    // name, nullable, type_type, type, children, custom_metadata
+    size_t field = fb.table({ { 0, 0, 0 }, { 1, 1, 0 }, { 2, 1, ARROW_FLOAT }, { 3, 0, 0 }, { 5, 0, 0 }, { 6, 0, 0 } }, f);
+    fb.link(fieldSlot, field);
+    fb.link(f[0], fb.str(column));
+    size_t dummy;
+    fb.link(f[1], fb.table({ { 0, 2, 2 } }, &dummy));                       // FloatingPoint DOUBLE
+    fb.link(f[2], fb.offsets(0, nullptr));                                   // no children
+    size_t kvSlot;
+    fb.link(f[3], fb.offsets(1, &kvSlot));
+    size_t kvs[2];
+    fb.link(kvSlot, fb.table({ { 0, 0, 0 }, { 1, 0, 0 } }, kvs));
+    fb.link(kvs[0], fb.str(kSortedKey));
+    fb.link(kvs[1], fb.str("ascending"));
+}
+
+} // namespace interchange
+
+// ---------------- Readers ----------------
+
+/*
+  Pre : none
+  Post: numeric .npy array at path added to arr (all elements, any shape);
+        returns rows read and how they were delivered, or error set.
+*/
+inline ColumnLoad loadNpy(const std::string& path, StatsArray& arr, IngestPolicy policy = IngestPolicy::SKIP) {
+    using namespace interchange;
+    ColumnLoad res;
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(path)) { res.error = "Could not open file."; return res; }
+    const unsigned char* b = file->data(); const size_t n = file->size();
+    if (n < 10 || memcmp(b, "\x93NUMPY", 6) != 0) { res.error = "Not a .npy file."; return res; }
+    const unsigned major = b[6];
+    size_t hlen, hstart;
+    if (major == 1) { hlen = (size_t)getLE(b + 8, 2); hstart = 10; }
+    else if ((major == 2 || major == 3) && n >= 12) { hlen = (size_t)getLE(b + 8, 4); hstart = 12; }
+    else { res.error = "Unsupported .npy version."; return res; }
+    if (hlen > n - hstart) { res.error = "Truncated .npy header."; return res; }
+    const std::string h(reinterpret_cast<const char*>(b + hstart), hlen);
+
+    // descr: '<f8', '|u1', ...
+    size_t d = h.find("'descr'");
+    if (d == std::string::npos) { res.error = "Missing descr in .npy header."; return res; }
+    size_t q = h.find_first_of("'\"", h.find(':', d));
+    if (q == std::string::npos || q + 3 >= h.size()) { res.error = "Bad descr in .npy header."; return res; }
+    const char order = h[q + 1];
+    ElemType t = { h[q + 2], (unsigned)atoi(h.c_str() + q + 3), order == '>' || (order == '=' && !hostLittleEndian()) };
+    if (!supported(t)) { res.error = "Unsupported .npy dtype (need float32/64 or integers)."; return res; }
+
+    // shape: element count is the product of all dimensions
+    size_t sp = h.find("'shape'"), lp = sp == std::string::npos ? sp : h.find('(', sp), rp = lp == std::string::npos ? lp : h.find(')', lp);
+    if (rp == std::string::npos) { res.error = "Missing shape in .npy header."; return res; }
+    size_t count = 1;
+    for (size_t i = lp + 1; i < rp; ) {
+        if (h[i] >= '0' && h[i] <= '9') { size_t dim = 0; while (i < rp && h[i] >= '0' && h[i] <= '9') dim = dim * 10 + (size_t)(h[i++] - '0'); count *= dim; }
+        else ++i;
+    }
+    const size_t off = hstart + hlen;
+    if (t.bytes && count > (n - off) / t.bytes) { res.error = "Truncated .npy data."; return res; }
+    deliver(file, b + off, count, t, false, arr, policy, res);
+    return res;
+}
+
+/*
+  Pre : none
+  Post: numeric column of the Arrow IPC file at path added to arr; the
+        column is picked by name, or the first numeric column if column is
+        empty. Null slots are skipped and counted. Returns error on failure.
+*/
+inline ColumnLoad loadArrow(const std::string& path, StatsArray& arr, IngestPolicy policy = IngestPolicy::SKIP, const std::string& column = "") {
+    using namespace interchange;
+    ColumnLoad res;
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(path)) { res.error = "Could not open file."; return res; }
+    const unsigned char* b = file->data(); const size_t n = file->size();
+    if (n < 18 || memcmp(b, "ARROW1", 6) != 0 || memcmp(b + n - 6, "ARROW1", 6) != 0) { res.error = "Not an Arrow IPC file."; return res; }
+    const size_t footLen = (size_t)getLE(b + n - 10, 4);
+    if (footLen > n - 18) { res.error = "Bad Arrow footer."; return res; }
+    FlatReader fr(b + n - 10 - footLen, footLen);
+    const size_t footer = fr.root(), schema = fr.ref(footer, 1), fields = fr.ref(schema, 1);
+    const bool bigEndian = fr.scalar(schema, 0, 2) == 1;
+
+    // locate the column and its node/buffer indices in each record batch
+    size_t nodeIdx = 0, bufIdx = 0, pick = 0; ElemType t = { 0, 0, false }; bool found = false;
+    for (size_t i = 0; i < fr.length(fields) && !found; ++i) {
+        size_t f = fr.element(fields, i);
+        ElemType ft = arrowElemType(fr, f, bigEndian);
+        if (column.empty() ? ft.kind != 0 : fr.str(fr.ref(f, 0)) == column) { pick = f; t = ft; found = true; break; }
+        if (!arrowLayout(fr, f, nodeIdx, bufIdx)) { res.error = "Unsupported Arrow column layout before the requested column."; return res; }
+    }
+    if (fr.bad()) { res.error = "Corrupt Arrow footer."; return res; }
+    if (!found) { res.error = column.empty() ? "No numeric column in Arrow file." : "Column not found in Arrow file."; return res; }
+    if (!t.kind) { res.error = "Column is not float32/64 or integer."; return res; }
+    const bool flagged = arrowSortedFlag(fr, fr.ref(pick, 6));
+
+    const size_t batches = fr.ref(footer, 3), nb = fr.length(batches);
+    std::vector<double> vals;
+    for (size_t k = 0; k < nb; ++k) {
+        const size_t blk = batches + 4 + 24 * k;   // Block { offset: long, metaDataLength: int, bodyLength: long }
+        const uint64_t mOff = fr.get(blk, 8), mLen = fr.get(blk + 8, 4), bodyLen = fr.get(blk + 16, 8);
+        if (fr.bad() || mOff > n || mLen > n - mOff || bodyLen > n - mOff - mLen || mLen < 8) { res.error = "Bad Arrow record batch block."; return res; }
+        size_t meta = (size_t)mOff + 4, metaLen = (size_t)getLE(b + mOff, 4);
+        if (metaLen == 0xFFFFFFFFu) { metaLen = (size_t)getLE(b + mOff + 4, 4); meta += 4; }   // continuation marker
+        if (metaLen > n - meta) { res.error = "Bad Arrow message."; return res; }
+        FlatReader mr(b + meta, metaLen);
+        const size_t msg = mr.root();
+        if (mr.scalar(msg, 1, 1) != kHeaderRecordBatch) { res.error = "Expected an Arrow record batch."; return res; }
+        const size_t rb = mr.ref(msg, 2);
+        if (mr.ref(rb, 3)) { res.error = "Compressed Arrow bodies are not supported."; return res; }
+        const size_t nodes = mr.ref(rb, 1), bufs = mr.ref(rb, 2);
+        if (nodeIdx >= mr.length(nodes) || bufIdx + 1 >= mr.length(bufs)) { res.error = "Arrow record batch does not match schema."; return res; }
+        const uint64_t rows = mr.get(nodes + 4 + 16 * nodeIdx, 8), nullCount = mr.get(nodes + 4 + 16 * nodeIdx + 8, 8);
+        const size_t vb = bufs + 4 + 16 * bufIdx, db = vb + 16;   // validity, then data
+        const uint64_t vOff = mr.get(vb, 8), vLen = mr.get(vb + 8, 8), dOff = mr.get(db, 8), dLen = mr.get(db + 8, 8);
+        if (mr.bad() || dOff > bodyLen || dLen > bodyLen - dOff || rows > dLen / t.bytes
+            || (nullCount && (vOff > bodyLen || vLen > bodyLen - vOff || vLen * 8 < rows))) { res.error = "Bad Arrow buffer."; return res; }
+        const unsigned char* body = b + mOff + mLen;
+        if (nb == 1 && nullCount == 0) { deliver(file, body + dOff, (size_t)rows, t, flagged, arr, policy, res); return res; }
+        res.rows += (size_t)rows;
+        res.nulls += decodeColumn(body + dOff, (size_t)rows, t, nullCount && vLen ? body + vOff : nullptr, vals);
+    }
+    res.ingest = arr.insertBulk(vals.data(), vals.size(), policy);
+    return res;
+}
+
+// ---------------- Writers ----------------
+
+/*
+  Pre : none
+  Post: writes arr (ascending) as a 1-D float64 .npy array; returns false on I/O error.
+*/
+inline bool saveNpy(const std::string& path, const StatsArray& arr) {
+    using namespace interchange;
+    std::string h = std::string("{'descr': '") + (hostLittleEndian() ? "<" : ">") + "f8', 'fortran_order': False, 'shape': ("
+        + std::to_string(arr.size()) + ",), }";
+    while ((10 + h.size() + 1) % 64) h += ' ';   // data starts 64-byte aligned
+    h += '\n';
+    std::vector<double> vals(arr.size());
+    if (!vals.empty()) arr.copyTo(vals.data());
+    std::ofstream fout(path, std::ios::binary);
+    if (!fout) return false;
+    unsigned char pre[10] = { 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0, 0, 0 };
+    putLE(pre + 8, h.size(), 2);
+    fout.write(reinterpret_cast<const char*>(pre), 10);
+    fout.write(h.data(), (std::streamsize)h.size());
+    if (!vals.empty()) fout.write(reinterpret_cast<const char*>(vals.data()), (std::streamsize)(vals.size() * sizeof(double)));
+    return (bool)fout;
+}
+
+/*
+  Pre : host is little-endian
+  Post: writes arr (ascending) as an Arrow IPC file with one float64 column
+        flagged sorted; returns false on I/O error or big-endian host.
+*/
+inline bool saveArrow(const std::string& path, const StatsArray& arr, const std::string& column = "value") {
+    using namespace interchange;
+    if (!hostLittleEndian()) return false;
+    const size_t rows = arr.size(), dataLen = rows * sizeof(double), bodyLen = (dataLen + 7) / 8 * 8;
+    std::vector<unsigned char> out(8, 0);
+    memcpy(&out[0], "ARROW1", 6);
+
+    size_t s[3];
+    { // schema message: version, header_type, header, bodyLength
+        FlatBuilder fb;
+        size_t msg = fb.table({ { 0, 2, kArrowV5 }, { 1, 1, kHeaderSchema }, { 2, 0, 0 }, { 3, 8, 0 } }, s);
+        fb.link(0, msg);
+        writeSchema(fb, s[0], column);
+        appendMessage(out, fb);
+    }
+    const size_t batchOff = out.size();
+    size_t batchMeta;
+    { // record batch message
+        FlatBuilder fb;
+        size_t msg = fb.table({ { 0, 2, kArrowV5 }, { 1, 1, kHeaderRecordBatch }, { 2, 0, 0 }, { 3, 8, bodyLen } }, s);
+        fb.link(0, msg);
+        size_t r[2];
+        fb.link(s[0], fb.table({ { 0, 8, rows }, { 1, 0, 0 }, { 2, 0, 0 } }, r));   // length, nodes, buffers
+        unsigned char node[16]; putLE(node, rows, 8); putLE(node + 8, 0, 8);
+        fb.link(r[0], fb.structs(node, 1, 16, 8));
+        unsigned char bufs[32]; putLE(bufs, 0, 8); putLE(bufs + 8, 0, 8); putLE(bufs + 16, 0, 8); putLE(bufs + 24, dataLen, 8);
+        fb.link(r[1], fb.structs(bufs, 2, 16, 8));
+        batchMeta = appendMessage(out, fb);
+    }
+    out.resize(out.size() + bodyLen, 0);
+    if (rows) arr.copyTo(reinterpret_cast<double*>(&out[out.size() - bodyLen]));   // vector data is suitably aligned
+    const unsigned char eos[8] = { 0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0 };
+    out.insert(out.end(), eos, eos + 8);
+
+    { // footer: version, schema, dictionaries, recordBatches
+        FlatBuilder fb;
+        size_t foot = fb.table({ { 0, 2, kArrowV5 }, { 1, 0, 0 }, { 2, 0, 0 }, { 3, 0, 0 } }, s);
+        fb.link(0, foot);
+        writeSchema(fb, s[0], column);
+        fb.link(s[1], fb.structs(nullptr, 0, 24, 8));
+        unsigned char blk[24] = {};
+        putLE(blk, batchOff, 8); putLE(blk + 8, batchMeta, 4); putLE(blk + 16, bodyLen, 8);
+        fb.link(s[2], fb.structs(blk, 1, 24, 8));
+        out.insert(out.end(), fb.buf.begin(), fb.buf.end());
+        unsigned char tail[10]; putLE(tail, fb.buf.size(), 4); memcpy(tail + 4, "ARROW1", 6);
+        out.insert(out.end(), tail, tail + 10);
+    }
+    std::ofstream fout(path, std::ios::binary);
+    if (!fout) return false;
+    fout.write(reinterpret_cast<const char*>(out.data()), (std::streamsize)out.size());
+    return (bool)fout;
+}
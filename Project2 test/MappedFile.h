@@ -0,0 +1,114 @@
+#pragma once
+/*
+    Program: MappedFile - read-only view of a whole file
+
+    Description:
+      - Maps the file into memory (mmap on POSIX, MapViewOfFile on Windows)
+        so readers can use the bytes in place.
+      - Falls back to reading the file into a buffer where mapping is not
+        available or fails; data() works the same either way.
+      - Not copyable; keep it alive (e.g. via shared_ptr) while any pointer
+        into data() is in use.
+*/
+
+#include <cstddef>    // size_t
+#include <string>
+#include <vector>
+#include <fstream>
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define MAPPEDFILE_POSIX 1
+#endif
+
+class MappedFile {
+public:
+    MappedFile() : _p(nullptr), _n(0), _mapped(false) {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /*
+      Pre : none
+      Post: returns true and exposes the whole file through data()/size();
+            returns false if the file cannot be opened or read.
+    */
+    bool open(const std::string& path) {
+        close();
+#if defined(_WIN32)
+        HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (f != INVALID_HANDLE_VALUE) {
+            LARGE_INTEGER sz;
+            if (GetFileSizeEx(f, &sz) && sz.QuadPart > 0) {
+                HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (m) {
+                    const void* v = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+                    CloseHandle(m);   // the view keeps the mapping alive
+                    if (v) { _p = static_cast<const unsigned char*>(v); _n = (size_t)sz.QuadPart; _mapped = true; }
+                }
+            }
+            CloseHandle(f);
+            if (_mapped) return true;
+        }
+#elif defined(MAPPEDFILE_POSIX)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            struct stat st;
+            if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+                void* v = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (v != MAP_FAILED) { _p = static_cast<const unsigned char*>(v); _n = (size_t)st.st_size; _mapped = true; }
+            }
+            ::close(fd);
+            if (_mapped) return true;
+        }
+#endif
+        // fallback: read the whole file
+        std::ifstream fin(path, std::ios::binary);
+        if (!fin) return false;
+        _copy.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+        _p = _copy.empty() ? nullptr : &_copy[0]; _n = _copy.size();
+        return true;
+    }
+
+    /*
+      Pre : none
+      Post: mapping or buffer released; size() == 0.
+    */
+    void close() {
+        if (_mapped) {
+#if defined(_WIN32)
+            UnmapViewOfFile(_p);
+#elif defined(MAPPEDFILE_POSIX)
+            munmap(const_cast<unsigned char*>(_p), _n);
+#endif
+        }
+        _copy.clear(); _copy.shrink_to_fit();
+        _p = nullptr; _n = 0; _mapped = false;
+    }
+
+    const unsigned char* data() const { return _p; }
+    size_t size() const { return _n; }
+
+    /*
+      Pre : none
+      Post: returns true if data() is a real mapping (not the read fallback).
+    */
+    bool mapped() const { return _mapped; }
+
+private:
+    const unsigned char*       _p;
+    size_t                     _n;
+    bool                       _mapped;
+    std::vector<unsigned char> _copy; // fallback storage
+};
@@ -0,0 +1,148 @@
+#pragma once
+/*
+    Program: MetricsEndpoint - loopback HTTP endpoint for StatsMetrics
+
+    Description:
+      - Serves GET /metrics on 127.0.0.1:<port> in the Prometheus text
+        format from a thread of its own; any other path gets 404.
+      - A scrape only sums the per-thread counter shards, so it never
+        blocks or slows the threads doing the counting.
+      - One request per connection, answered with Connection: close;
+        slow or oversized requests are dropped after 2 s / 8 KiB.
+      - POSIX only; elsewhere start() returns false.
+*/
+
+#include <cstddef>    // size_t
+#include <cstdint>
+#include <cstring>    // memset
+#include <string>
+#include <thread>
+#include <atomic>
+#include "StatsMetrics.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#define METRICSENDPOINT_POSIX 1
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+class MetricsEndpoint {
+public:
+    MetricsEndpoint() : _listen(-1), _port(0), _stop(false) { _wake[0] = _wake[1] = -1; }
+    ~MetricsEndpoint() { stop(); }
+
+    MetricsEndpoint(const MetricsEndpoint&) = delete;
+    MetricsEndpoint& operator=(const MetricsEndpoint&) = delete;
+
+    /*
+      Pre : none
+      Post: returns true with the endpoint listening on 127.0.0.1:port and
+            served by a background thread (port 0 picks a free port; see port()).
+    */
+    bool start(uint16_t port) {
+        stop();
+#if defined(METRICSENDPOINT_POSIX)
+        _listen = socket(AF_INET, SOCK_STREAM, 0);
+        if (_listen < 0) return false;
+        int one = 1;
+        setsockopt(_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof addr);
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        socklen_t len = sizeof addr;
+        if (bind(_listen, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0 || ::listen(_listen, 16) != 0
+            || getsockname(_listen, reinterpret_cast<sockaddr*>(&addr), &len) != 0 || pipe(_wake) != 0) {
+            closeFds(); return false;
+        }
+        _port = ntohs(addr.sin_port);
+        _stop = false;
+        _thread = std::thread([this] { loop(); });
+        return true;
+#else
+        (void)port;
+        return false;
+#endif
+    }
+
+    /*
+      Pre : none
+      Post: serving thread joined and sockets closed.
+    */
+    void stop() {
+#if defined(METRICSENDPOINT_POSIX)
+        _stop = true;
+        if (_wake[1] >= 0) { char c = 0; ssize_t r = ::write(_wake[1], &c, 1); (void)r; }
+#endif
+        if (_thread.joinable()) _thread.join();
+        closeFds();
+    }
+
+    uint16_t port() const { return _port; }
+
+private:
+    int               _listen;
+    int               _wake[2];   // self-pipe that interrupts poll() on stop()
+    uint16_t          _port;
+    std::atomic<bool> _stop;
+    std::thread       _thread;
+
+    void closeFds() {
+#if defined(METRICSENDPOINT_POSIX)
+        if (_listen >= 0) ::close(_listen);
+        if (_wake[0] >= 0) ::close(_wake[0]);
+        if (_wake[1] >= 0) ::close(_wake[1]);
+#endif
+        _listen = _wake[0] = _wake[1] = -1;
+    }
+
+#if defined(METRICSENDPOINT_POSIX)
+    void loop() {
+        while (!_stop) {
+            pollfd p[2] = { { _listen, POLLIN, 0 }, { _wake[0], POLLIN, 0 } };
+            if (poll(p, 2, -1) < 0) { if (errno == EINTR) continue; return; }
+            if (p[1].revents || _stop) return;
+            int fd = accept(_listen, nullptr, nullptr);
+            if (fd >= 0) { answer(fd); ::close(fd); }
+        }
+    }
+
+    /*
+      Pre : fd is a connected client
+      Post: one request read and answered.
+    */
+    void answer(int fd) {
+        std::string req;
+        char buf[1024];
+        while (req.find("\r\n\r\n") == std::string::npos && req.find("\n\n") == std::string::npos) {
+            pollfd p = { fd, POLLIN, 0 };
+            if (req.size() > 8192 || poll(&p, 1, 2000) <= 0) return;
+            ssize_t r = ::recv(fd, buf, sizeof buf, 0);
+            if (r <= 0) return;
+            req.append(buf, (size_t)r);
+        }
+        std::string body, status = "200 OK", type = "text/plain; version=0.0.4; charset=utf-8";
+        const bool head = req.compare(0, 5, "HEAD ") == 0;
+        const size_t sp = req.find(' '), end = req.find_first_of(" ?\r\n", sp + 1);
+        const std::string path = sp == std::string::npos || end == std::string::npos ? std::string() : req.substr(sp + 1, end - sp - 1);
+        if ((head || req.compare(0, 4, "GET ") == 0) && path == "/metrics") StatsMetrics::instance().render(body);
+        else { status = "404 Not Found"; type = "text/plain"; body = "Try /metrics\n"; }
+        std::string resp = "HTTP/1.1 " + status + "\r\nContent-Type: " + type + "\r\nContent-Length: " + std::to_string(body.size())
+            + "\r\nConnection: close\r\n\r\n";
+        if (!head) resp += body;
+        for (size_t at = 0; at < resp.size(); ) {
+            ssize_t w = ::send(fd, resp.data() + at, resp.size() - at, MSG_NOSIGNAL);
+            if (w <= 0) { if (w < 0 && errno == EINTR) continue; return; }
+            at += (size_t)w;
+        }
+    }
+#endif
+};
@@ -0,0 +1,340 @@
+#pragma once
+/*
+    Program: MultiFileLoader - load many files into one StatsArray in parallel
+
+    Description:
+      - expandInputs() turns a file, a directory (its regular files, not
+        recursive, hidden ones skipped) or a wildcard pattern ("*", "?",
+        "[...]" in the last path component) into a sorted list of files.
+      - loadFiles() parses the files on a pool of threads, each taking the
+        next file from a shared counter. Every file becomes one sorted run:
+        text is read in large blocks with a queue of reads in flight
+        (AsyncReader: io_uring, else pread threads) and scanned in each
+        block as it arrives (FieldScanner: every number, or one key or
+        column per log line), gzip-compressed text (recognized by content,
+        any file name) is mapped (MappedFile) and inflated on a second
+        thread straight into the scanner (GzipInput),
+        .npy/.arrow columns go through the Interchange readers.
+      - The runs and the values already in the array are combined by one
+        k-way merge; the array then adopts the merged buffer without a copy
+        (StatsArray::adoptSorted), so nothing is re-sorted.
+      - NaN/Inf follow the IngestPolicy per file: REJECT drops only the
+        files that contain them.
+      - Progress is reported in bytes read from disk (compressed bytes for
+        gzip), from the calling thread, so the callback needs no locking.
+      - Each text file is hashed (XXH64, ContentHash) as its blocks are
+        parsed; a single file's hash is returned for result caches.
+*/
+
+#include <algorithm>  // sort
+#include <atomic>
+#include <cctype>     // tolower
+#include <chrono>
+#include <cstddef>    // size_t
+#include <cstdint>
+#include <cmath>      // isfinite
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>     // shared_ptr
+#include <queue>      // priority_queue
+#include <string>
+#include <thread>
+#include <utility>    // pair
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "StatsArray.h"
+#include "MappedFile.h"
+#include "Interchange.h"
+#include "FieldScanner.h"
+#include "GzipInput.h"
+#include "AsyncReader.h"
+#include "ContentHash.h"
+#if defined(_WIN32)
+#include <windows.h>  // FindFirstFileA
+#else
+#include <dirent.h>
+#include <glob.h>
+#endif
+
+/*
+  Outcome of loadFiles().
+*/
+struct MultiFileLoad {
+    size_t                   files;      // files attempted
+    size_t                   failed;     // could not be opened or decoded
+    size_t                   rejected;   // dropped under IngestPolicy::REJECT
+    uint64_t                 bytes;      // bytes read
+    size_t                   skipped;    // text tokens that were not numbers, or lines without the field
+    IngestReport             ingest;     // values inserted and NaN/Inf counts over all files
+    std::vector<std::string> errors;     // "path: reason", first few failures
+    uint64_t                 hash;       // XXH64 of the file's bytes when files == 1 (text or gzip)
+
+    MultiFileLoad() : files(0), failed(0), rejected(0), bytes(0), skipped(0), hash(0) {}
+};
+
+namespace multifile {
+
+const size_t kMaxErrors = 8;
+
+inline bool hasWildcard(const std::string& s) { return s.find_first_of("*?[") != std::string::npos; }
+
+inline bool isDirectory(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && (st.st_mode & S_IFMT) == S_IFDIR;
+}
+
+inline bool isRegularFile(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && (st.st_mode & S_IFMT) == S_IFREG;
+}
+
+inline uint64_t fileBytes(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+inline bool startsGzip(const std::string& path) {
+    unsigned char head[2] = { 0, 0 };
+    std::ifstream in(path, std::ios::binary);
+    in.read(reinterpret_cast<char*>(head), 2);
+    return isGzip(head, (size_t)in.gcount());
+}
+
+inline std::string lowerExtension(const std::string& path) {
+    const size_t dot = path.find_last_of('.'), slash = path.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return std::string();
+    std::string ext = path.substr(dot);
+    for (char& c : ext) c = (char)tolower((unsigned char)c);
+    return ext;
+}
+
+/*
+  One file's contribution: its accepted values, sorted.
+*/
+struct Run {
+    std::vector<double> values;
+    IngestReport        ingest;
+    size_t              skipped = 0;
+    uint64_t            hash = 0;       // XXH64 of the file (text and gzip only)
+    const char*         error = nullptr;
+};
+
+/*
+  Pre : none
+  Post: NaN/Inf in v counted into rep and handled per policy (REJECT
+        empties v and sets rep.rejected); v holds only finite values.
+*/
+inline void applyPolicy(std::vector<double>& v, IngestPolicy policy, IngestReport& rep) {
+    size_t w = 0;
+    for (size_t i = 0; i < v.size(); ++i) {
+        const double x = v[i];
+        if (std::isfinite(x)) { v[w++] = x; continue; }
+        if (x != x) { ++rep.nan; continue; }
+        if (x > 0) ++rep.posInf; else ++rep.negInf;
+        if (policy == IngestPolicy::CLAMP) {
+            v[w++] = x > 0 ? std::numeric_limits<double>::max() : std::numeric_limits<double>::lowest();
+            ++rep.clamped;
+        }
+    }
+    v.resize(w);
+    if (policy == IngestPolicy::REJECT && rep.invalid()) { v.clear(); rep.rejected = true; }
+}
+
+/*
+  Pre : none
+  Post: run filled from the file at path; done advanced by the bytes read.
+*/
+inline void loadRun(const std::string& path, IngestPolicy policy, const FieldSpec& fields, const ReadOptions& io,
+    Run& run, std::atomic<uint64_t>& done) {
+    const std::string ext = lowerExtension(path);
+    if (ext == ".npy" || ext == ".arrow" || ext == ".feather" || ext == ".ipc") {
+        StatsArray col;
+        ColumnLoad r = ext == ".npy" ? loadNpy(path, col, policy) : loadArrow(path, col, policy);
+        done += fileBytes(path);
+        if (!r.ok()) { run.error = r.error; return; }
+        run.ingest = r.ingest;
+        if (r.ingest.rejected) return;
+        run.values.resize(col.size());
+        if (!run.values.empty()) col.copyTo(run.values.data());   // ascending already
+        run.ingest.inserted = run.values.size();
+        return;
+    }
+    FieldScanner scan(fields);
+    Xxh64 hash;
+    if (startsGzip(path)) {
+        MappedFile file;
+        if (!file.open(path)) { run.error = "cannot open file"; return; }
+        size_t counted = 0;
+        run.error = inflateChunks(file.data(), file.size(), [&](const char* text, size_t len, size_t consumed) {
+            scan.feed(text, len, run.values);
+            hash.update(file.data() + counted, consumed - counted);
+            done += consumed - counted; counted = consumed;
+        });
+        hash.update(file.data() + counted, file.size() - counted);
+        done += file.size() - counted;
+        if (run.error) { std::vector<double>().swap(run.values); return; }
+    }
+    else {
+        run.error = readBlocks(path, io, [&](const char* block, size_t n) {
+            scan.feed(block, n, run.values);
+            hash.update(block, n);
+            done += n;
+        });
+        if (run.error) { std::vector<double>().swap(run.values); return; }
+    }
+    scan.finish(run.values);
+    run.skipped = scan.skipped();
+    run.hash = hash.digest();
+    applyPolicy(run.values, policy, run.ingest);
+    std::sort(run.values.begin(), run.values.end());
+    run.ingest.inserted = run.values.size();
+}
+
+/*
+  Pre : every run ascending
+  Post: returns all values of all runs, ascending (heap merge, O(n log k)).
+*/
+inline std::shared_ptr<std::vector<double>> mergeRuns(const std::vector<const std::vector<double>*>& runs) {
+    size_t total = 0;
+    for (const std::vector<double>* r : runs) total += r->size();
+    std::shared_ptr<std::vector<double>> out = std::make_shared<std::vector<double>>();
+    out->reserve(total);
+    typedef std::pair<double, size_t> Head;   // value, run index
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    std::vector<size_t> pos(runs.size(), 0);
+    for (size_t i = 0; i < runs.size(); ++i) if (!runs[i]->empty()) heads.push(Head((*runs[i])[0], i));
+    while (!heads.empty()) {
+        const size_t i = heads.top().second;
+        heads.pop();
+        const std::vector<double>& r = *runs[i];
+        // copy the run's stretch that stays below the next run's head
+        const double limit = heads.empty() ? std::numeric_limits<double>::infinity() : heads.top().first;
+        size_t j = pos[i];
+        do out->push_back(r[j++]); while (j < r.size() && r[j] <= limit);
+        pos[i] = j;
+        if (j < r.size()) heads.push(Head(r[j], i));
+    }
+    return out;
+}
+
+} // namespace multifile
+
+/*
+  Pre : none
+  Post: returns the files named by pattern (a file, a directory or a
+        wildcard pattern), sorted; empty if nothing matches.
+*/
+inline std::vector<std::string> expandInputs(const std::string& pattern) {
+    using namespace multifile;
+    std::vector<std::string> out;
+    if (isDirectory(pattern)) {
+        std::string dir = pattern;
+        if (!dir.empty() && dir.back() != '/' && dir.back() != '\\') dir += '/';
+#if defined(_WIN32)
+        WIN32_FIND_DATAA fd;
+        HANDLE h = FindFirstFileA((dir + "*").c_str(), &fd);
+        if (h != INVALID_HANDLE_VALUE) {
+            do if (fd.cFileName[0] != '.' && !(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) out.push_back(dir + fd.cFileName);
+            while (FindNextFileA(h, &fd));
+            FindClose(h);
+        }
+#else
+        if (DIR* d = opendir(dir.c_str())) {
+            while (dirent* e = readdir(d))
+                if (e->d_name[0] != '.' && isRegularFile(dir + e->d_name)) out.push_back(dir + e->d_name);
+            closedir(d);
+        }
+#endif
+    }
+    else if (hasWildcard(pattern)) {
+#if defined(_WIN32)
+        const size_t slash = pattern.find_last_of("/\\");
+        const std::string dir = slash == std::string::npos ? std::string() : pattern.substr(0, slash + 1);
+        WIN32_FIND_DATAA fd;
+        HANDLE h = FindFirstFileA(pattern.c_str(), &fd);
+        if (h != INVALID_HANDLE_VALUE) {
+            // hidden names (result caches) only on request, as glob() does
+            do if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && (fd.cFileName[0] != '.' || pattern[slash + 1] == '.'))
+                out.push_back(dir + fd.cFileName);
+            while (FindNextFileA(h, &fd));
+            FindClose(h);
+        }
+#else
+        glob_t g;
+        if (glob(pattern.c_str(), 0, nullptr, &g) == 0)
+            for (size_t i = 0; i < g.gl_pathc; ++i) if (isRegularFile(g.gl_pathv[i])) out.push_back(g.gl_pathv[i]);
+        globfree(&g);
+#endif
+    }
+    else if (isRegularFile(pattern)) out.push_back(pattern);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+/*
+  Pre : none
+  Post: the numbers of every file in paths merged into arr (one k-way
+        merge with its current values) on up to `threads` threads
+        (0 = hardware concurrency). progress(done, total), if given, is
+        called from this thread about every 100 ms and once at the end.
+        Text files yield the field named by fields (default: every number)
+        and are read as io says (queue depth, block size, io_uring).
+*/
+inline MultiFileLoad loadFiles(const std::vector<std::string>& paths, StatsArray& arr, IngestPolicy policy = IngestPolicy::SKIP,
+    unsigned threads = 0, const std::function<void(uint64_t, uint64_t)>& progress = nullptr, const FieldSpec& fields = FieldSpec(),
+    const ReadOptions& io = ReadOptions()) {
+    using namespace multifile;
+    MultiFileLoad res;
+    res.files = paths.size();
+    uint64_t total = 0;
+    for (const std::string& p : paths) total += fileBytes(p);
+
+    std::vector<Run> runs(paths.size());
+    std::atomic<size_t> next(0), finished(0);
+    std::atomic<uint64_t> done(0);
+    auto work = [&]() {
+        for (size_t i; (i = next.fetch_add(1)) < paths.size(); ++finished) {
+            try { loadRun(paths[i], policy, fields, io, runs[i], done); }
+            catch (const std::bad_alloc&) { std::vector<double>().swap(runs[i].values); runs[i].error = "out of memory"; }
+            catch (...) { std::vector<double>().swap(runs[i].values); runs[i].error = "could not be read"; }
+        }
+    };
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    if (threads > paths.size()) threads = (unsigned)std::max<size_t>(paths.size(), 1);
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t) pool.emplace_back(work);
+    for (int tick = 1; finished < paths.size(); ++tick) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (progress && tick % 10 == 0) progress(done, total);
+    }
+    for (std::thread& t : pool) t.join();
+    res.bytes = done;
+    if (progress) progress(res.bytes, total);
+    if (runs.size() == 1) res.hash = runs[0].hash;
+
+    std::vector<double> current(arr.size());
+    if (!current.empty()) arr.copyTo(current.data());
+    std::vector<const std::vector<double>*> sorted(1, &current);
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const Run& r = runs[i];
+        if (r.error) {
+            ++res.failed;
+            if (res.errors.size() < kMaxErrors) res.errors.push_back(paths[i] + ": " + r.error);
+            continue;
+        }
+        res.skipped += r.skipped;
+        res.ingest.nan += r.ingest.nan; res.ingest.posInf += r.ingest.posInf; res.ingest.negInf += r.ingest.negInf;
+        res.ingest.clamped += r.ingest.clamped;
+        if (r.ingest.rejected) { ++res.rejected; continue; }
+        res.ingest.inserted += r.values.size();
+        sorted.push_back(&r.values);
+    }
+    if (res.ingest.inserted == 0) return res;
+    std::shared_ptr<std::vector<double>> merged = mergeRuns(sorted);
+    runs.clear();
+    arr.adoptSorted(merged->data(), merged->size(), merged);
+    return res;
+}
@@ -0,0 +1,102 @@
+#pragma once
+/*
+    Program: NumberScanner - numbers from text that arrives in chunks
+
+    Description:
+      - feed() takes any slice of a text stream and parses every token that
+        is finished (followed by whitespace) in place, without copying; a
+        token cut off at the end of the slice is held until the next feed()
+        or finish().
+      - Tokens are parsed with strtod ("1.5", "-2e3", "nan", "inf", ...);
+        tokens that are not entirely a number are counted and skipped, as
+        is any run of more than kMaxToken bytes without whitespace.
+      - Shared by the file loaders and FileFollower, so a file parses the
+        same however it is read.
+*/
+
+#include <cctype>     // isspace
+#include <cerrno>
+#include <cstddef>    // size_t
+#include <cstdlib>    // strtod
+#include <string>
+#include <vector>
+
+class NumberScanner {
+public:
+    static const size_t kMaxToken = 4096;
+
+    NumberScanner() : _skipped(0), _discard(false) {}
+
+    /*
+      Pre : p holds n bytes (may be null when n == 0)
+      Post: numbers of the tokens finished within p appended to out; returns
+            how many were appended.
+    */
+    size_t feed(const char* p, size_t n, std::vector<double>& out) {
+        const size_t before = out.size();
+        const char* const end = p + n;
+        if (!_tail.empty() || _discard) {   // finish the token cut off last time
+            const char* q = p;
+            while (q < end && !isspace((unsigned char)*q)) ++q;
+            if (!_discard) _tail.append(p, (size_t)(q - p));
+            if (q == end) { holdLimit(); return 0; }
+            if (_discard) _discard = false;
+            else take(_tail.c_str(), _tail.c_str() + _tail.size(), out);
+            _tail.clear();
+            p = q;
+        }
+        while (p < end) {
+            while (p < end && isspace((unsigned char)*p)) ++p;
+            const char* tok = p;
+            while (p < end && !isspace((unsigned char)*p)) ++p;
+            if (tok == p) break;
+            if (p == end) { _tail.assign(tok, (size_t)(p - tok)); holdLimit(); break; }
+            take(tok, p, out);   // *p is whitespace: strtod stops there
+        }
+        return out.size() - before;
+    }
+
+    /*
+      Pre : none
+      Post: the held token, if any, parsed as the last one of the stream;
+            returns how many numbers were appended (0 or 1).
+    */
+    size_t finish(std::vector<double>& out) {
+        const size_t before = out.size();
+        if (!_tail.empty()) take(_tail.c_str(), _tail.c_str() + _tail.size(), out);
+        _tail.clear();
+        _discard = false;
+        return out.size() - before;
+    }
+
+    /*
+      Pre : none
+      Post: held token dropped and skipped() reset, for a new stream.
+    */
+    void reset() { _tail.clear(); _discard = false; _skipped = 0; }
+
+    size_t skipped() const { return _skipped; }
+
+private:
+    /*
+      Pre : [b, e) is one token and *e is whitespace or '\0'
+    */
+    void take(const char* b, const char* e, std::vector<double>& out) {
+        char* stop = nullptr;
+        errno = 0;
+        const double v = std::strtod(b, &stop);
+        if (stop == e && errno != ERANGE) out.push_back(v);
+        else ++_skipped;
+    }
+
+    void holdLimit() {
+        if (_tail.size() <= kMaxToken) return;
+        _tail.clear();
+        _discard = true;
+        ++_skipped;
+    }
+
+    std::string _tail;      // unfinished token from the previous feed()
+    size_t      _skipped;
+    bool        _discard;   // inside an over-long token; drop until whitespace
+};
@@ -0,0 +1,199 @@
+#pragma once
+/*
+    Program: ResultCache - sidecar cache of a text input's values and report
+
+    Description:
+      - For an input file "dir/data.txt" the cache is "dir/.data.txt.statcache"
+        (hidden, so directory and wildcard loads do not pick it up). It
+        holds the XXH64 hash (ContentHash) of the file's bytes, the field
+        spec and NaN/Inf policy the values were taken with, the values
+        themselves (ascending float64, as in a snapshot) and the full
+        statistics report for Sample and/or Population.
+      - The cache costs 8 bytes per value however compact the input is: a
+        gzip-compressed input of 2 MB can leave a 10 MB sidecar next to it.
+      - loadCachedResult() accepts the cache only if the input still has
+        the recorded size and modification time and then hashes the input
+        (a plain read at GB/s, no parsing) to confirm its content; the
+        values are then mapped in place (StatsArray::adoptSorted), so
+        nothing is parsed or sorted, and the stored report can be shown
+        without scanning the values.
+      - saveCachedResult() writes "<cache>.tmp" and renames it over the
+        cache, like saveSnapshot(). A cache that cannot be written (read-
+        only directory) is simply not used.
+*/
+
+#include <cstddef>    // size_t
+#include <cstdint>
+#include <cstdio>     // rename, remove
+#include <cstring>    // memcpy, memcmp, memset
+#include <fstream>
+#include <memory>     // shared_ptr
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "StatsArray.h"
+#include "MappedFile.h"
+#include "AsyncReader.h"
+#include "ContentHash.h"
+#if defined(_WIN32)
+#include <windows.h>  // MoveFileExA
+#endif
+
+/*
+  File header; fields text, values and reports follow at headerBytes.
+*/
+struct ResultCacheHeader {
+    char     magic[8];         // "STATRCAC"
+    uint32_t version;
+    uint32_t headerBytes;      // offset of the fields text, multiple of 64
+    uint64_t hash;             // XXH64 of the input file
+    uint64_t inputBytes;       // input size when hashed
+    int64_t  inputTime;        // input modification time (seconds) when hashed
+    uint64_t count;            // values
+    uint64_t reportBytes[2];   // report length: [0] Sample, [1] Population; 0 = none
+    uint32_t fieldsBytes;      // FieldSpec::text() the values were taken with
+    uint32_t policy;           // IngestPolicy the values were taken with
+    uint8_t  reserved[56];
+};
+
+const uint32_t kResultCacheVersion = 1;
+const uint32_t kResultCacheHeaderBytes = 128;
+static_assert(sizeof(ResultCacheHeader) == kResultCacheHeaderBytes, "ResultCacheHeader must fill its slot exactly.");
+
+/*
+  What a cache describes: one input, and how its values were taken.
+*/
+struct CachedResult {
+    uint64_t    hash;
+    uint64_t    inputBytes;
+    int64_t     inputTime;
+    std::string fields;
+    uint32_t    policy;
+    std::string report[2];   // [0] Sample, [1] Population; empty = not cached
+
+    CachedResult() : hash(0), inputBytes(0), inputTime(0), policy(0) {}
+};
+
+namespace resultcache {
+
+/*
+  Pre : none
+  Post: returns false if path cannot be examined; else its size and
+        modification time.
+*/
+inline bool inputStamp(const std::string& path, uint64_t& bytes, int64_t& time) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    bytes = (uint64_t)st.st_size;
+    time = (int64_t)st.st_mtime;
+    return true;
+}
+
+} // namespace resultcache
+
+/*
+  Pre : none
+  Post: returns the cache file for input ("dir/.name.statcache").
+*/
+inline std::string resultCachePath(const std::string& input) {
+    const size_t slash = input.find_last_of("/\\");
+    if (slash == std::string::npos) return "." + input + ".statcache";
+    return input.substr(0, slash + 1) + "." + input.substr(slash + 1) + ".statcache";
+}
+
+/*
+  Pre : none
+  Post: returns false if path cannot be read; else hash is the XXH64 of
+        its bytes.
+*/
+inline bool hashFile(const std::string& path, const ReadOptions& io, uint64_t& hash) {
+    Xxh64 x;
+    if (readBlocks(path, io, [&](const char* p, size_t n) { x.update(p, n); })) return false;
+    hash = x.digest();
+    return true;
+}
+
+/*
+  Pre : arr is empty
+  Post: returns true if input has a cache made with the same fields and
+        policy and its content is unchanged; arr then holds the cached
+        values (borrowed from the mapping) and out describes the cache.
+        Otherwise returns false and arr is unchanged.
+*/
+inline bool loadCachedResult(const std::string& input, const std::string& fields, uint32_t policy, const ReadOptions& io,
+    StatsArray& arr, CachedResult& out) {
+    using namespace resultcache;
+    uint64_t bytes; int64_t time;
+    if (!inputStamp(input, bytes, time)) return false;
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(resultCachePath(input)) || file->size() < sizeof(ResultCacheHeader)) return false;
+
+    const unsigned char* p = file->data();
+    ResultCacheHeader h;
+    memcpy(&h, p, sizeof h);
+    if (memcmp(h.magic, "STATRCAC", 8) != 0 || h.version != kResultCacheVersion) return false;
+    const uint64_t fieldsEnd = (uint64_t)h.headerBytes + h.fieldsBytes;
+    const uint64_t valuesAt = (uint64_t)h.headerBytes + (((uint64_t)h.fieldsBytes + 7) & ~(uint64_t)7);
+    if (h.headerBytes < sizeof h || h.headerBytes % 64 != 0 || fieldsEnd > file->size() || valuesAt > file->size()
+        || h.count > (file->size() - valuesAt) / sizeof(double)) return false;
+    const uint64_t reportsAt = valuesAt + h.count * sizeof(double);
+    if (h.reportBytes[0] > file->size() - reportsAt || h.reportBytes[1] > file->size() - reportsAt - h.reportBytes[0]) return false;
+    if (h.inputBytes != bytes || h.inputTime != time || h.policy != policy
+        || fields != std::string(reinterpret_cast<const char*>(p + h.headerBytes), h.fieldsBytes)) return false;
+
+    uint64_t hash;
+    if (!hashFile(input, io, hash) || hash != h.hash) return false;
+
+    out = CachedResult();
+    out.hash = h.hash; out.inputBytes = bytes; out.inputTime = time; out.fields = fields; out.policy = policy;
+    const char* r = reinterpret_cast<const char*>(p + reportsAt);
+    out.report[0].assign(r, (size_t)h.reportBytes[0]);
+    out.report[1].assign(r + h.reportBytes[0], (size_t)h.reportBytes[1]);
+    arr.adoptSorted(reinterpret_cast<const double*>(p + valuesAt), (size_t)h.count, file);
+    return true;
+}
+
+/*
+  Pre : r describes input and arr holds exactly the values taken from it
+  Post: the cache for input written atomically; returns false on I/O error.
+*/
+inline bool saveCachedResult(const std::string& input, const CachedResult& r, const StatsArray& arr) {
+    ResultCacheHeader h;
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, "STATRCAC", 8);
+    h.version = kResultCacheVersion;
+    h.headerBytes = kResultCacheHeaderBytes;
+    h.hash = r.hash;
+    h.inputBytes = r.inputBytes;
+    h.inputTime = r.inputTime;
+    h.count = arr.size();
+    h.reportBytes[0] = r.report[0].size();
+    h.reportBytes[1] = r.report[1].size();
+    h.fieldsBytes = (uint32_t)r.fields.size();
+    h.policy = r.policy;
+
+    std::vector<double> vals(arr.size());
+    if (!vals.empty()) arr.copyTo(vals.data());
+    const std::string path = resultCachePath(input), tmp = path + ".tmp";
+    {
+        std::ofstream fout(tmp, std::ios::binary | std::ios::trunc);
+        if (!fout) return false;
+        static const char pad[8] = { 0 };
+        fout.write(reinterpret_cast<const char*>(&h), sizeof h);
+        fout.write(r.fields.data(), (std::streamsize)r.fields.size());
+        fout.write(pad, (std::streamsize)((8 - r.fields.size() % 8) % 8));
+        if (!vals.empty()) fout.write(reinterpret_cast<const char*>(vals.data()), (std::streamsize)(vals.size() * sizeof(double)));
+        fout.write(r.report[0].data(), (std::streamsize)r.report[0].size());
+        fout.write(r.report[1].data(), (std::streamsize)r.report[1].size());
+        fout.flush();
+        if (!fout) { fout.close(); std::remove(tmp.c_str()); return false; }
+    }
+#if defined(_WIN32)
+    const bool moved = MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    const bool moved = std::rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+    if (!moved) std::remove(tmp.c_str());
+    return moved;
+}
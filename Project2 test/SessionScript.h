@@ -0,0 +1,123 @@
+#pragma once
+/*
+    Program: SessionScript - recorded menu sessions
+
+    Description:
+      - A session script holds one menu action per line: the menu key,
+        then the answer its prompt would take.
+            1 P             dataset type (S = Sample, P = Population)
+            2A 1.5 2, 3     insert values (spaces or commas)
+            2B 100          insert that many random values (drawn afresh on
+                            every replay, so the values differ)
+            2C data.txt     insert from a file, directory or pattern (*.txt)
+            2E latency_ms   field taken from text lines: a key, a column
+                            ("3", "3," for CSV, "3t" for tabs) or "-" (all)
+            2P 2            NaN/Inf policy (1 reject, 2 skip, 3 clamp)
+            3 4.5           delete every occurrence of a value
+            4 out.npy       export the dataset
+            5 /statsarray   publish to shared memory
+            F               any statistic A..Y
+            Z results.txt   write all results to a text file
+            0               end of session (optional)
+        Keys are case-insensitive; '#' starts a comment line.
+      - Following a file (menu 2F) is not recorded: its values arrive while
+        the session runs, so a session that followed a file replays
+        without them. Record a 2C load of the file to keep its contents.
+      - SessionRecorder appends each action as the menus carry it out,
+        flushed line by line so an interrupted session keeps its script.
+      - readSessionScript() checks every line before anything runs, so a
+        typo on line 40 does not leave a half-replayed dataset.
+*/
+
+#include <cctype>
+#include <cstddef>    // size_t
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct SessionCommand {
+    std::string key;    // upper-case menu key: "1", "2A", ..., "F", "Z"
+    std::string arg;    // the answer, trimmed; empty for statistics
+    size_t      line;   // 1-based line in the script
+};
+
+/*
+  Pre : none
+  Post: returns true with cmd filled if text is a well-formed command; a
+        blank or comment line returns true with cmd.key empty; otherwise
+        false with the reason in error.
+*/
+inline bool parseSessionLine(const std::string& text, SessionCommand& cmd, std::string& error) {
+    cmd.key.clear(); cmd.arg.clear();
+    const size_t b = text.find_first_not_of(" \t\r");
+    if (b == std::string::npos || text[b] == '#') return true;
+    size_t e = text.find_first_of(" \t\r", b);
+    if (e == std::string::npos) e = text.size();
+    for (size_t i = b; i < e; ++i) cmd.key += (char)toupper((unsigned char)text[i]);
+    const size_t ab = text.find_first_not_of(" \t", e), ae = text.find_last_not_of(" \t\r");
+    if (ab != std::string::npos && ab <= ae) cmd.arg = text.substr(ab, ae - ab + 1);
+
+    const std::string& k = cmd.key;
+    const bool statistic = k.size() == 1 && k[0] >= 'A' && k[0] <= 'Y';
+    const bool needsArg = k == "1" || k == "2A" || k == "2B" || k == "2C" || k == "2E" || k == "2P" || k == "3" || k == "4" || k == "5" || k == "Z";
+    if (!statistic && !needsArg && k != "0") { error = "unknown command '" + k + "'"; return false; }
+    if (needsArg && cmd.arg.empty()) { error = "command '" + k + "' needs an argument"; return false; }
+    if (!needsArg && !cmd.arg.empty()) { error = "command '" + k + "' takes no argument"; return false; }
+    if (k == "1" && cmd.arg != "S" && cmd.arg != "P" && cmd.arg != "s" && cmd.arg != "p") { error = "dataset type must be S or P"; return false; }
+    if (k == "2P" && (cmd.arg.size() != 1 || cmd.arg[0] < '1' || cmd.arg[0] > '3')) { error = "policy must be 1, 2 or 3"; return false; }
+    return true;
+}
+
+/*
+  Pre : none
+  Post: returns true with every command of the script at path (up to an
+        optional "0"); otherwise false with "path:line: reason" in error.
+*/
+inline bool readSessionScript(const std::string& path, std::vector<SessionCommand>& out, std::string& error) {
+    std::ifstream in(path);
+    if (!in) { error = "cannot open " + path; return false; }
+    std::string text;
+    for (size_t line = 1; std::getline(in, text); ++line) {
+        SessionCommand cmd;
+        if (!parseSessionLine(text, cmd, error)) { error = path + ":" + std::to_string(line) + ": " + error; return false; }
+        if (cmd.key.empty()) continue;
+        if (cmd.key == "0") break;
+        cmd.line = line;
+        out.push_back(cmd);
+    }
+    return true;
+}
+
+class SessionRecorder {
+public:
+    /*
+      Pre : none
+      Post: returns true with commands appended to path from now on (a new
+            file starts with a comment naming the format).
+    */
+    bool open(const std::string& path) {
+        std::ifstream probe(path);
+        const bool fresh = !probe || probe.peek() == std::ifstream::traits_type::eof();
+        probe.close();
+        _out.open(path, std::ios::app);
+        if (!_out) return false;
+        if (fresh) _out << "# StatsArray session script: one menu key and its answer per line\n" << std::flush;
+        return true;
+    }
+
+    bool isOpen() const { return _out.is_open(); }
+
+    /*
+      Pre : key/arg form a valid command (see parseSessionLine)
+      Post: the command appended and flushed; no-op when not recording.
+    */
+    void record(const std::string& key, const std::string& arg = std::string()) {
+        if (!_out.is_open()) return;
+        _out << key;
+        if (!arg.empty()) _out << ' ' << arg;
+        _out << '\n' << std::flush;
+    }
+
+private:
+    std::ofstream _out;
+};
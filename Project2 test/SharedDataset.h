@@ -0,0 +1,441 @@
+#pragma once
+/*
+    Program: SharedDataset - publish a sorted dataset in POSIX shared memory
+
+    Description:
+      - SharedDatasetWriter copies a StatsArray's ascending values and a
+        cached summary (count, min, max, sum, sum of squares, mean, M2) into
+        a named shared-memory segment (shm_open, e.g. "/stats").
+      - SharedDatasetReader maps the segment read-only in any local process
+        and answers queries with no IPC: percentile() and summary() read the
+        mapping in place; read() hands the callback the reader's own copy of
+        the latest publish, taken once per publish and checked against the
+        counter first, so any StatsArray query runs on consistent values.
+      - The segment starts with a versioned header. A sequence counter
+        (seqlock) is odd while a publish is in progress; readers retry a
+        query whose counter changed underneath it, so every answer comes
+        from one consistent publish. Readers never block the writer.
+      - A counter that stays at one odd value for longer than the reader's
+        stall timeout (setStallTimeout(), default 5 s) means the writer died
+        mid-publish and the segment is abandoned: read() and summary() then
+        throw std::runtime_error instead of waiting forever. The next
+        writer's create() on the segment completes the counter again.
+      - The segment only grows; readers remap when the writer enlarged it.
+      - One writer per segment. POSIX only (Linux, macOS); elsewhere
+        create()/open() return false. Older glibc needs -lrt for shm_open.
+*/
+
+#include <cassert>
+#include <cstddef>    // size_t
+#include <cstdint>
+#include <cstring>    // memcpy, memcmp
+#include <cmath>      // floor, sqrt
+#include <limits>     // numeric_limits
+#include <string>
+#include <memory>     // shared_ptr
+#include <new>        // placement new
+#include <stdexcept>  // runtime_error
+#include <atomic>
+#include <chrono>
+#include <thread>     // this_thread::yield
+#include <utility>    // declval
+#include <vector>
+#include "StatsArray.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define SHAREDDATASET_POSIX 1
+#endif
+
+/*
+  Summary cached at publish time. mean/M2 are from a two-pass sum, so
+  variance = m2 / (count - 1) (sample) or m2 / count (population).
+*/
+struct SharedSummary {
+    uint64_t count;
+    double   min, max, sum, sumSquares, mean, m2;
+
+    /*
+      Pre : sample ? count >= 2 : count >= 1
+      Post: returns variance (sample uses n-1; population uses n).
+    */
+    double variance(bool sample) const { return m2 / (double)(sample ? count - 1 : count); }
+};
+
+/*
+  Segment header; the values follow at headerBytes. Only fields present in
+  version 1 are ever read at their offsets; later versions append fields.
+*/
+struct SharedDatasetHeader {
+    char                  magic[8];      // "STATSHM"
+    uint32_t              version;
+    uint32_t              headerBytes;   // offset of the values, multiple of 64
+    std::atomic<uint64_t> seq;           // odd while a publish is in progress
+    uint64_t              capacity;      // values the segment holds
+    SharedSummary         summary;       // summary.count values are valid
+};
+
+const uint32_t kSharedDatasetVersion = 1;
+const uint32_t kSharedDatasetHeaderBytes = 128;
+static_assert(sizeof(SharedDatasetHeader) <= kSharedDatasetHeaderBytes, "SharedDatasetHeader outgrew its slot.");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The seqlock counter must be lock-free to live in shared memory.");
+
+/*
+  Owns one mmap of a segment; shared by the reader and the views it lends out.
+*/
+class SharedMapping {
+public:
+    SharedMapping(void* p, size_t n) : _p(p), _n(n) {}
+    ~SharedMapping() {
+#if defined(SHAREDDATASET_POSIX)
+        if (_p) munmap(_p, _n);
+#endif
+    }
+    SharedMapping(const SharedMapping&) = delete;
+    SharedMapping& operator=(const SharedMapping&) = delete;
+
+    SharedDatasetHeader* header() const { return static_cast<SharedDatasetHeader*>(_p); }
+    double* values() const { return reinterpret_cast<double*>(static_cast<char*>(_p) + header()->headerBytes); }
+    size_t size() const { return _n; }
+
+    /*
+      Pre : none
+      Post: returns how many values fit in this mapping.
+    */
+    size_t valueCapacity() const { return _n < kSharedDatasetHeaderBytes ? 0 : (_n - kSharedDatasetHeaderBytes) / sizeof(double); }
+
+private:
+    void*  _p;
+    size_t _n;
+};
+
+class SharedDatasetWriter {
+public:
+    SharedDatasetWriter() : _fd(-1) {}
+    ~SharedDatasetWriter() { close(); }
+
+    SharedDatasetWriter(const SharedDatasetWriter&) = delete;
+    SharedDatasetWriter& operator=(const SharedDatasetWriter&) = delete;
+
+    /*
+      Pre : name is a shm name ("/something"); no other writer uses it
+      Post: returns true with the segment created (or reused) and mapped
+            read-write; an existing segment keeps its sequence counter.
+    */
+    bool create(const std::string& name) {
+        close();
+#if defined(SHAREDDATASET_POSIX)
+        _fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+        if (_fd < 0) return false;
+        struct stat st;
+        if (fstat(_fd, &st) != 0) { close(); return false; }
+        size_t bytes = (size_t)st.st_size;
+        if (bytes < kSharedDatasetHeaderBytes) {
+            bytes = kSharedDatasetHeaderBytes;
+            if (ftruncate(_fd, (off_t)bytes) != 0) { close(); return false; }
+        }
+        _map = map(bytes);
+        if (!_map) { close(); return false; }
+        SharedDatasetHeader* h = _map->header();
+        if (memcmp(h->magic, "STATSHM", 8) != 0 || h->version != kSharedDatasetVersion || h->headerBytes != kSharedDatasetHeaderBytes) {
+            memset(static_cast<void*>(h), 0, kSharedDatasetHeaderBytes);
+            new (&h->seq) std::atomic<uint64_t>(0);
+            h->version = kSharedDatasetVersion; h->headerBytes = kSharedDatasetHeaderBytes;
+            std::atomic_thread_fence(std::memory_order_release);
+            memcpy(h->magic, "STATSHM", 8);   // readers check the magic last
+        }
+        else if (h->seq.load(std::memory_order_relaxed) & 1) h->seq.fetch_add(1, std::memory_order_relaxed); // a writer died mid-publish
+        h->capacity = _map->valueCapacity();
+        _name = name;
+        return true;
+#else
+        (void)name;
+        return false;
+#endif
+    }
+
+    /*
+      Pre : create() succeeded
+      Post: segment holds arr's values (ascending) and summary; readers see
+            either the previous publish or this one, never a mix. Grows the
+            segment when needed; returns false if it cannot.
+    */
+    bool publish(const StatsArray& arr) {
+        if (!_map) return false;
+        SharedDatasetHeader* h = _map->header();
+        const uint64_t s = h->seq.load(std::memory_order_relaxed);
+        h->seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        const size_t n = arr.size();
+        if (n > _map->valueCapacity()) {
+            // grow by half again so repeated publishes of a growing dataset stay cheap
+            size_t cap = n + n / 2;
+            size_t bytes = kSharedDatasetHeaderBytes + cap * sizeof(double);
+            std::shared_ptr<SharedMapping> bigger;
+#if defined(SHAREDDATASET_POSIX)
+            if (ftruncate(_fd, (off_t)bytes) == 0) bigger = map(bytes);
+#endif
+            if (!bigger) { h->seq.store(s + 2, std::memory_order_release); return false; } // old values untouched
+            _map = bigger;
+            h = _map->header();
+            h->capacity = _map->valueCapacity();
+        }
+
+        double* v = _map->values();
+        if (n) arr.copyTo(v);
+        SharedSummary& sm = h->summary;
+        sm.count = n;
+        sm.min = n ? v[0] : std::numeric_limits<double>::quiet_NaN();
+        sm.max = n ? v[n - 1] : std::numeric_limits<double>::quiet_NaN();
+        long double sum = 0.0L, sq = 0.0L;
+        for (size_t i = 0; i < n; ++i) { sum += v[i]; sq += (long double)v[i] * v[i]; }
+        const long double mean = n ? sum / (long double)n : 0.0L;
+        long double m2 = 0.0L;
+        for (size_t i = 0; i < n; ++i) { const long double d = v[i] - mean; m2 += d * d; }
+        sm.sum = (double)sum; sm.sumSquares = (double)sq;
+        sm.mean = n ? (double)mean : std::numeric_limits<double>::quiet_NaN(); sm.m2 = (double)m2;
+
+        h->seq.store(s + 2, std::memory_order_release);
+        return true;
+    }
+
+    /*
+      Pre : none
+      Post: returns the number of publishes seen by the segment (seq / 2).
+    */
+    uint64_t generation() const { return _map ? _map->header()->seq.load(std::memory_order_acquire) / 2 : 0; }
+
+    /*
+      Pre : none
+      Post: mapping and descriptor released; the segment itself stays.
+    */
+    void close() {
+        _map.reset();
+#if defined(SHAREDDATASET_POSIX)
+        if (_fd >= 0) ::close(_fd);
+#endif
+        _fd = -1;
+    }
+
+    /*
+      Pre : none
+      Post: segment name removed (open mappings stay valid); writer closed.
+    */
+    void unlink() {
+#if defined(SHAREDDATASET_POSIX)
+        if (!_name.empty()) shm_unlink(_name.c_str());
+#endif
+        _name.clear();
+        close();
+    }
+
+    bool isOpen() const { return (bool)_map; }
+    const std::string& name() const { return _name; }
+
+private:
+    int                            _fd;
+    std::string                    _name;
+    std::shared_ptr<SharedMapping> _map;
+
+    std::shared_ptr<SharedMapping> map(size_t bytes) {
+#if defined(SHAREDDATASET_POSIX)
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+        if (p != MAP_FAILED) return std::make_shared<SharedMapping>(p, bytes);
+#else
+        (void)bytes;
+#endif
+        return nullptr;
+    }
+};
+
+class SharedDatasetReader {
+public:
+    SharedDatasetReader() : _fd(-1), _stallTimeout(5000), _copy(std::make_shared<std::vector<double>>()), _viewSeq(1) {}
+    ~SharedDatasetReader() { close(); }
+
+    SharedDatasetReader(const SharedDatasetReader&) = delete;
+    SharedDatasetReader& operator=(const SharedDatasetReader&) = delete;
+
+    /*
+      Pre : none
+      Post: returns true with the segment mapped read-only; false if it does
+            not exist or is not a version-1 StatsArray segment.
+    */
+    bool open(const std::string& name) {
+        close();
+#if defined(SHAREDDATASET_POSIX)
+        _fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (_fd < 0) return false;
+        if (!remap()) { close(); return false; }
+        const SharedDatasetHeader* h = _map->header();
+        if (memcmp(h->magic, "STATSHM", 8) != 0 || h->version != kSharedDatasetVersion || h->headerBytes != kSharedDatasetHeaderBytes) {
+            close(); return false;
+        }
+        return true;
+#else
+        (void)name;
+        return false;
+#endif
+    }
+
+    void close() {
+        _view.clear(); _viewSeq = 1;
+        _map.reset();
+#if defined(SHAREDDATASET_POSIX)
+        if (_fd >= 0) ::close(_fd);
+#endif
+        _fd = -1;
+    }
+
+    bool isOpen() const { return (bool)_map; }
+
+    /*
+      Pre : t > 0
+      Post: read() and summary() treat a publish still in progress after t
+            as abandoned by a dead writer.
+    */
+    void setStallTimeout(std::chrono::milliseconds t) { _stallTimeout = t; }
+
+    /*
+      Pre : open() succeeded; f(const StatsArray&) returns a value and keeps
+            no reference to its argument
+      Post: runs f on the reader's copy of the latest consistent publish and
+            returns its result. The copy is refreshed (one memcpy) only when
+            a newer publish appeared, so repeated queries cost no copy and f
+            never sees a torn dataset. Exceptions from f propagate; throws
+            std::runtime_error if the segment is abandoned mid-publish (see
+            setStallTimeout()).
+    */
+    template <typename F>
+    auto read(F f) -> decltype(f(std::declval<const StatsArray&>())) {
+        assert(_map);
+        Stall stall;
+        for (;;) {
+            const SharedDatasetHeader* h = _map->header();
+            const uint64_t s = h->seq.load(std::memory_order_acquire);
+            if (s & 1) { waitForPublish(s, stall); continue; }
+            if (s == _viewSeq) break;
+            const size_t n = (size_t)h->summary.count;
+            if (n > _map->valueCapacity()) { if (!remap()) throw std::runtime_error("Shared dataset segment could not be remapped."); continue; }
+            _view.clear(); _viewSeq = 1;
+            _copy->resize(n);
+            if (n) memcpy(_copy->data(), _map->values(), n * sizeof(double));
+            if (!stable(s)) continue;
+            _view.adoptSorted(_copy->data(), n, _copy);
+            _viewSeq = s;
+        }
+        return f(static_cast<const StatsArray&>(_view));
+    }
+
+    /*
+      Pre : open() succeeded
+      Post: returns the cached summary of one consistent publish; throws
+            std::runtime_error if the segment is abandoned mid-publish.
+    */
+    SharedSummary summary() const {
+        assert(_map);
+        Stall stall;
+        for (;;) {
+            const SharedDatasetHeader* h = _map->header();
+            const uint64_t s = h->seq.load(std::memory_order_acquire);
+            if (s & 1) { waitForPublish(s, stall); continue; }
+            SharedSummary out;
+            memcpy(&out, &h->summary, sizeof out);
+            if (stable(s)) return out;
+        }
+    }
+
+    /*
+      Pre : open() succeeded; 0 <= p <= 100
+      Post: returns the p-th percentile, interpolating linearly between the
+            closest ranks; throws DatasetEmptyException if empty.
+    */
+    double percentile(double p) {
+        assert(p >= 0.0 && p <= 100.0);
+        Stall stall;
+        for (;;) {
+            const SharedDatasetHeader* h = _map->header();
+            const uint64_t s = h->seq.load(std::memory_order_acquire);
+            if (s & 1) { waitForPublish(s, stall); continue; }
+            const size_t n = (size_t)h->summary.count;
+            if (n > _map->valueCapacity()) { if (!remap()) throw std::runtime_error("Shared dataset segment could not be remapped."); continue; }
+            if (n == 0) { if (stable(s)) throw DatasetEmptyException("Dataset is empty."); continue; }
+            const double* xs = _map->values();   // in place: only indexed, never asserted on
+            const double r = (p / 100.0) * (double)(n - 1);
+            const size_t lo = (size_t)std::floor(r);
+            const double out = lo + 1 >= n ? xs[n - 1] : xs[lo] + (r - (double)lo) * (xs[lo + 1] - xs[lo]);
+            if (stable(s)) return out;
+        }
+    }
+
+    /*
+      Pre : open() succeeded
+      Post: out holds a private copy of one consistent publish.
+    */
+    void snapshot(StatsArray& out) {
+        out = read([](const StatsArray& a) { StatsArray c(a); c.detach(); return c; });
+    }
+
+    /*
+      Pre : open() succeeded
+      Post: returns the number of publishes so far (changes on every publish).
+    */
+    uint64_t generation() const { return _map->header()->seq.load(std::memory_order_acquire) / 2; }
+
+private:
+    // The odd counter value a query is waiting on, and since when.
+    struct Stall {
+        uint64_t                              seq;
+        std::chrono::steady_clock::time_point since;
+        Stall() : seq(0) {}
+    };
+
+    int                                  _fd;
+    std::shared_ptr<SharedMapping>       _map;
+    std::chrono::milliseconds            _stallTimeout;
+    std::shared_ptr<std::vector<double>> _copy;      // values of the publish _view holds
+    StatsArray                           _view;      // borrows *_copy
+    uint64_t                             _viewSeq;   // counter _copy was taken at; odd = none
+
+    /*
+      Pre : s is odd (a publish in progress)
+      Post: yields the CPU; throws std::runtime_error once the counter has
+            stayed at s for longer than the stall timeout.
+    */
+    void waitForPublish(uint64_t s, Stall& stall) const {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (stall.seq != s) { stall.seq = s; stall.since = now; }
+        else if (now - stall.since > _stallTimeout)
+            throw std::runtime_error("Shared dataset segment abandoned: a publish never finished (writer died?).");
+        std::this_thread::yield();
+    }
+
+    /*
+      Pre : s was read (acquire) before the data
+      Post: returns true if no publish started since s.
+    */
+    bool stable(uint64_t s) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return _map->header()->seq.load(std::memory_order_relaxed) == s;
+    }
+
+    /*
+      Pre : _fd open
+      Post: mapping replaced by one covering the current segment size.
+    */
+    bool remap() {
+#if defined(SHAREDDATASET_POSIX)
+        struct stat st;
+        if (fstat(_fd, &st) != 0 || (size_t)st.st_size < kSharedDatasetHeaderBytes) return false;
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, _fd, 0);
+        if (p == MAP_FAILED) return false;
+        _map = std::make_shared<SharedMapping>(p, (size_t)st.st_size);
+        return true;
+#else
+        return false;
+#endif
+    }
+};
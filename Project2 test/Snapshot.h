@@ -0,0 +1,186 @@
+#pragma once
+/*
+    Program: Snapshot - auto-saved dataset restored by mapping
+
+    Description:
+      - A snapshot file is a 64-byte header (magic "STATSNAP", version,
+        value count, Sample/Population flag) followed by the ascending
+        values as host-order float64, so the file is the array itself.
+      - loadSnapshot() maps the file (MappedFile) and hands the values to
+        StatsArray::adoptSorted(): startup checks only the header and the
+        file size, and value pages fault in as statistics first touch them.
+        The values are trusted to be what saveSnapshot() wrote; nothing
+        re-validates or re-sorts them.
+      - saveSnapshot() writes "<path>.tmp" and renames it over path, so a
+        crash mid-save leaves the previous snapshot intact and a mapping of
+        the old file stays valid. On Windows a file that is still mapped
+        cannot be replaced, so callers detach() the array before saving.
+      - SnapshotTimer calls a function every interval on a thread of its
+        own, for periodic auto-save.
+*/
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>    // size_t
+#include <cstdint>
+#include <cstdio>     // rename, remove
+#include <cstring>    // memcpy, memcmp
+#include <fstream>
+#include <memory>     // shared_ptr
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "StatsArray.h"
+#include "MappedFile.h"
+#if defined(_WIN32)
+#include <windows.h>  // MoveFileExA
+#endif
+
+/*
+  File header; the values follow at headerBytes.
+*/
+struct SnapshotHeader {
+    char     magic[8];      // "STATSNAP"
+    uint32_t version;
+    uint32_t headerBytes;   // offset of the values, multiple of 64
+    uint64_t count;         // values in the file
+    uint8_t  population;    // 1 = Population, 0 = Sample
+    uint8_t  reserved[39];
+};
+
+const uint32_t kSnapshotVersion = 1;
+const uint32_t kSnapshotHeaderBytes = 64;
+static_assert(sizeof(SnapshotHeader) == kSnapshotHeaderBytes, "SnapshotHeader must fill its slot exactly.");
+
+/*
+  Outcome of loadSnapshot().
+*/
+struct SnapshotLoad {
+    const char* error;        // null on success; static message otherwise
+    size_t      count;        // values restored
+    bool        population;   // saved dataset type
+    bool        found;        // the file exists and could be opened
+    bool        mapped;       // values read in place from a file mapping
+
+    SnapshotLoad() : error(nullptr), count(0), population(false), found(false), mapped(false) {}
+
+    bool ok() const { return error == nullptr; }
+};
+
+/*
+  Pre : xs holds n finite values in ascending order (may be null when n == 0)
+  Post: snapshot of xs written to path atomically; returns false on I/O
+        error (path is then unchanged).
+*/
+inline bool saveSnapshot(const std::string& path, const double* xs, size_t n, bool population) {
+    SnapshotHeader h;
+    memset(&h, 0, sizeof h);
+    memcpy(h.magic, "STATSNAP", 8);
+    h.version = kSnapshotVersion;
+    h.headerBytes = kSnapshotHeaderBytes;
+    h.count = n;
+    h.population = population ? 1 : 0;
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream fout(tmp, std::ios::binary | std::ios::trunc);
+        if (!fout) return false;
+        fout.write(reinterpret_cast<const char*>(&h), sizeof h);
+        if (n) fout.write(reinterpret_cast<const char*>(xs), (std::streamsize)(n * sizeof(double)));
+        fout.flush();
+        if (!fout) { fout.close(); std::remove(tmp.c_str()); return false; }
+    }
+#if defined(_WIN32)
+    const bool moved = MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    const bool moved = std::rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+    if (!moved) std::remove(tmp.c_str());
+    return moved;
+}
+
+/*
+  Pre : none
+  Post: snapshot of arr (ascending values) written to path atomically;
+        returns false on I/O error.
+*/
+inline bool saveSnapshot(const std::string& path, const StatsArray& arr, bool population) {
+    std::vector<double> vals(arr.size());
+    if (!vals.empty()) arr.copyTo(vals.data());
+    return saveSnapshot(path, vals.data(), vals.size(), population);
+}
+
+/*
+  Pre : none
+  Post: on success arr holds the snapshot's values, borrowed from the
+        mapping when it could be mapped (copied otherwise); on error arr is
+        unchanged and error says why (found == false if path does not exist).
+*/
+inline SnapshotLoad loadSnapshot(const std::string& path, StatsArray& arr) {
+    SnapshotLoad res;
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (!file->open(path)) { res.error = "no snapshot"; return res; }
+    res.found = true;
+
+    const unsigned char* p = file->data();
+    if (file->size() < sizeof(SnapshotHeader)) { res.error = "snapshot is truncated"; return res; }
+    SnapshotHeader h;
+    memcpy(&h, p, sizeof h);
+    if (memcmp(h.magic, "STATSNAP", 8) != 0) { res.error = "not a snapshot file"; return res; }
+    if (h.version != kSnapshotVersion) { res.error = "unsupported snapshot version"; return res; }
+    if (h.headerBytes < sizeof h || h.headerBytes % 64 != 0 || h.headerBytes > file->size()
+        || h.count != (file->size() - h.headerBytes) / sizeof(double)
+        || (file->size() - h.headerBytes) % sizeof(double) != 0) { res.error = "snapshot size does not match its header"; return res; }
+
+    res.count = (size_t)h.count;
+    res.population = h.population != 0;
+    res.mapped = file->mapped();
+    arr.adoptSorted(reinterpret_cast<const double*>(p + h.headerBytes), res.count, file);
+    return res;
+}
+
+class SnapshotTimer {
+public:
+    SnapshotTimer() : _stop(false) {}
+    ~SnapshotTimer() { stop(); }
+
+    SnapshotTimer(const SnapshotTimer&) = delete;
+    SnapshotTimer& operator=(const SnapshotTimer&) = delete;
+
+    /*
+      Pre : not running; tick is safe to call from another thread
+      Post: tick() runs every interval on a background thread until stop().
+    */
+    template <class Fn>
+    void start(std::chrono::milliseconds interval, Fn tick) {
+        _stop = false;
+        _thread = std::thread([this, interval, tick]() mutable {
+            std::unique_lock<std::mutex> lock(_m);
+            while (!_cv.wait_for(lock, interval, [this] { return _stop; })) {
+                lock.unlock();
+                tick();
+                lock.lock();
+            }
+        });
+    }
+
+    /*
+      Pre : none
+      Post: thread joined; a tick in progress finishes first.
+    */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(_m);
+            _stop = true;
+        }
+        _cv.notify_all();
+        if (_thread.joinable()) _thread.join();
+    }
+
+private:
+    std::mutex              _m;
+    std::condition_variable _cv;
+    bool                    _stop;
+    std::thread             _thread;
+};
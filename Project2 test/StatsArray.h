@@ -6,9 +6,28 @@
 
     Description:
       - Stores double values in a dynamic array, kept in ASCENDING order.
+      - The first STATSARRAY_INLINE_CAP values live inside the object;
+        the buffer spills to the heap only beyond that.
+      - Optional dictionary-encoded storage for low-cardinality data.
+      - Optional XOR-compressed block storage for large read-mostly data.
+      - Adaptive mode (opt-in, setAdaptive(true)) migrates between storages
+        by cardinality and insert/erase/query mix; see storageReport().
+      - Concurrent const readers are safe only in FLAT storage: in BUFFERED
+        storage a const query may merge pending inserts first, in
+        DICTIONARY storage rank lookups rebuild a prefix-count table, and in
+        BLOCKS storage they rebuild block prefixes and refill the decoded-block
+        cache, so share such an array (or an adaptive one) under external
+        locking.
+      - insertBulk() validates whole batches (SIMD NaN/Inf check) under an
+        IngestPolicy and merges them in one pass.
+      - adoptSorted() borrows an external sorted buffer (e.g. a mapped file)
+        without copying; the first write copies it (copy-on-write).
+      - Internal work (memmove bytes, reallocations, scans, merges) is
+        counted in per-thread StatsMetrics shards.
       - Full set of descriptive statistics.
       - Rule of Three implemented.
-      - Throws exceptions for invalid dataset sizes.
+      - Throws exceptions for invalid dataset sizes; the tryX() forms
+        (tryMedian(), ...) return a StatsResult error code instead.
       - Uses std::tie (C++14) rather than structured bindings.
 */
 
@@ -18,16 +37,40 @@
 #include <cmath>      // isfinite, sqrt, fabs
 #include <cstring>    // memcpy, memmove
 #include <cstddef>    // size_t
+#include <limits>     // numeric_limits
 #include <new>        // nothrow
 #include <vector>
+#include <map>
+#include <set>
+#include <algorithm>  // min, sort
 #include <tuple>      // tuple, tie
 #include <utility>
+#include <memory>     // shared_ptr
 #include <fstream>
 #include <stdexcept>
 #include <string>
 #include <iomanip>
-
-using namespace std;
+#include "DictionaryStore.h"
+#include "BlockStore.h"
+#include "StatsMetrics.h"
+
+// SIMD kernels: AVX when the compiler targets it, else SSE2 (always on x64).
+// Define STATSARRAY_NO_SIMD to force the scalar paths.
+#if !defined(STATSARRAY_NO_SIMD) && defined(__AVX__)
+#include <immintrin.h>
+#define STATSARRAY_SIMD_AVX 1
+#elif !defined(STATSARRAY_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define STATSARRAY_SIMD_SSE2 1
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>   // _BitScanForward
+#endif
+
+// Values kept inside the object before the first heap allocation.
+#ifndef STATSARRAY_INLINE_CAP
+#define STATSARRAY_INLINE_CAP 16
+#endif
 
 // ---------------- Exceptions ----------------
 
@@ -35,39 +78,326 @@ using namespace std;
   Pre : none
   Post: an exception type representing an empty dataset.
 */
-class DatasetEmptyException : public runtime_error {
+class DatasetEmptyException : public std::runtime_error {
 public:
-    explicit DatasetEmptyException(const string& msg) : runtime_error(msg) {}
+    explicit DatasetEmptyException(const std::string& msg) : std::runtime_error(msg) {}
 };
 
 /*
   Pre : none
   Post: an exception type representing insufficient data size for an operation.
 */
-class InsufficientDataException : public runtime_error {
+class InsufficientDataException : public std::runtime_error {
 public:
-    explicit InsufficientDataException(const string& msg) : runtime_error(msg) {}
+    explicit InsufficientDataException(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+// ---------------- StatsResult ----------------
+
+/*
+  Error codes of the non-throwing statistics (tryMedian(), ...).
+*/
+enum class StatsError { NONE, EMPTY, INSUFFICIENT, UNDEFINED };
+
+/*
+  Value-or-error result of a non-throwing statistic. Holds no heap memory:
+  'what' points at a static label (for UNDEFINED, the whole message) and
+  the text is only built by message() or valueOrThrow().
+*/
+template <typename T>
+struct StatsResultOf {
+    T           value;
+    StatsError  error;
+    const char* what;   // statistic label; null when ok()
+    size_t      need;   // INSUFFICIENT: values required
+
+    StatsResultOf() : value(), error(StatsError::NONE), what(nullptr), need(0) {}
+
+    /*
+      Pre : none
+      Post: carries the error of other (value default-constructed).
+    */
+    template <typename U>
+    explicit StatsResultOf(const StatsResultOf<U>& other) : value(), error(other.error), what(other.what), need(other.need) {}
+
+    static StatsResultOf failure(StatsError e, const char* what, size_t need = 0) {
+        StatsResultOf r; r.error = e; r.what = what; r.need = need; return r;
+    }
+
+    bool ok() const { return error == StatsError::NONE; }
+
+    /*
+      Pre : none
+      Post: returns the text the throwing API would use ("" when ok()).
+    */
+    std::string message() const {
+        switch (error) {
+        case StatsError::EMPTY:        return "Dataset is empty.";
+        case StatsError::INSUFFICIENT: return std::string(what) + " requires at least " + std::to_string(need) + " value(s).";
+        case StatsError::UNDEFINED:    return what;
+        default:                       return "";
+        }
+    }
+
+    /*
+      Pre : none
+      Post: returns value; throws DatasetEmptyException for EMPTY and
+            InsufficientDataException otherwise.
+    */
+    const T& valueOrThrow() const {
+        if (error == StatsError::EMPTY) throw DatasetEmptyException(message());
+        if (error != StatsError::NONE) throw InsufficientDataException(message());
+        return value;
+    }
+};
+
+typedef StatsResultOf<double> StatsResult;
+
+/*
+  Statistic chosen at run time (socket protocol, C ABI); the numbering is
+  part of both interfaces, so only append.
+*/
+enum class Statistic : uint8_t {
+    COUNT = 1, MIN, MAX, RANGE, SUM, MEAN, MEDIAN, VARIANCE, STDEV, MIDRANGE, IQR, SUM_SQUARES,
+    MEAN_ABS_DEVIATION, RMS, SEM, SKEWNESS, KURTOSIS, KURTOSIS_EXCESS, COEFF_VARIATION, RSD, PERCENTILE
+};
+
+// ---------------- Bulk ingestion ----------------
+
+/*
+  What insertBulk() does with NaN and +/-Inf.
+    REJECT: insert nothing if the batch holds any non-finite value.
+    SKIP  : drop non-finite values, insert the rest.
+    CLAMP : store +/-Inf as the largest/lowest finite double; drop NaN.
+*/
+enum class IngestPolicy { REJECT, SKIP, CLAMP };
+
+/*
+  Outcome of one insertBulk() call.
+*/
+struct IngestReport {
+    size_t inserted;   // values stored (clamped ones included)
+    size_t nan;        // NaN values seen
+    size_t posInf;     // +Inf values seen
+    size_t negInf;     // -Inf values seen
+    size_t clamped;    // CLAMP: infinities stored as finite extremes
+    bool   rejected;   // REJECT: batch refused
+
+    IngestReport() : inserted(0), nan(0), posInf(0), negInf(0), clamped(0), rejected(false) {}
+
+    size_t invalid() const { return nan + posInf + negInf; }
+};
+
+// ---------------- FrequencyIndex ----------------
+
+/*
+  value -> count map plus count -> {values} buckets.
+  Kept in step with StatsArray inserts/erases when enabled, so the
+  highest bucket is always the set of modes.
+*/
+class FrequencyIndex {
+public:
+    /*
+      Pre : k >= 1
+      Post: count of v increased by k; v moved to its new bucket.
+    */
+    void add(double v, size_t k = 1) {
+        assert(k >= 1);
+        size_t& c = _counts[v];
+        if (c) unlink(v, c);
+        c += k;
+        _buckets[c].insert(v);
+    }
+
+    /*
+      Pre : k >= 1 and count(v) >= k
+      Post: count of v decreased by k; v dropped when it reaches 0.
+    */
+    void remove(double v, size_t k = 1) {
+        assert(k >= 1);
+        auto it = _counts.find(v);
+        assert(it != _counts.end() && it->second >= k);
+        unlink(v, it->second);
+        it->second -= k;
+        if (it->second) _buckets[it->second].insert(v);
+        else _counts.erase(it);
+    }
+
+    /*
+      Pre : none
+      Post: all counts dropped.
+    */
+    void clear() { _counts.clear(); _buckets.clear(); }
+
+    /*
+      Pre : none
+      Post: returns occurrences of v (0 if absent).
+    */
+    size_t count(double v) const {
+        auto it = _counts.find(v); return it == _counts.end() ? 0 : it->second;
+    }
+
+    /*
+      Pre : none
+      Post: returns number of distinct values.
+    */
+    size_t distinct() const { return _counts.size(); }
+
+    /*
+      Pre : none
+      Post: returns highest count (0 if empty).
+    */
+    size_t maxCount() const { return _buckets.empty() ? 0 : _buckets.rbegin()->first; }
+
+    /*
+      Pre : none
+      Post: returns values whose count == maxCount(), ascending; empty if maxCount() <= 1.
+    */
+    std::vector<double> modes() const {
+        if (maxCount() <= 1) return std::vector<double>();
+        const std::set<double>& top = _buckets.rbegin()->second;
+        return std::vector<double>(top.begin(), top.end());
+    }
+
+    /*
+      Pre : none
+      Post: returns up to k (value,count) pairs by descending count;
+            ties by ascending value.
+    */
+    std::vector<std::pair<double, size_t>> mostFrequent(size_t k) const {
+        std::vector<std::pair<double, size_t>> res;
+        for (auto b = _buckets.rbegin(); b != _buckets.rend() && res.size() < k; ++b)
+            for (auto v = b->second.begin(); v != b->second.end() && res.size() < k; ++v)
+                res.push_back(std::make_pair(*v, b->first));
+        return res;
+    }
+
+private:
+    std::map<double, size_t>           _counts;   // value -> count
+    std::map<size_t, std::set<double>> _buckets;  // count -> values with that count
+
+    /*
+      Pre : v is in bucket c
+      Post: v removed from bucket c; empty bucket dropped.
+    */
+    void unlink(double v, size_t c) {
+        auto b = _buckets.find(c);
+        assert(b != _buckets.end());
+        b->second.erase(v);
+        if (b->second.empty()) _buckets.erase(b);
+    }
 };
 
 // ---------------- StatsArray ----------------
+
+/*
+  FLAT       : one sorted double per value (default).
+  DICTIONARY : sorted distinct values + bit-packed counts.
+  BLOCKS     : sorted values in XOR-compressed blocks with summary headers.
+  BUFFERED   : flat buffer whose tail holds unsorted inserts, merged on the
+               next read (LSM-style; for write-heavy streams).
+*/
+enum class Storage { FLAT, DICTIONARY, BLOCKS, BUFFERED };
+
+/*
+  Pre : none
+  Post: returns a short display name for s.
+*/
+inline const char* storageName(Storage s) {
+    switch (s) {
+    case Storage::FLAT:       return "flat";
+    case Storage::DICTIONARY: return "dictionary";
+    case Storage::BLOCKS:     return "blocks";
+    case Storage::BUFFERED:   return "buffered";
+    }
+    return "?";
+}
+
+/*
+  Snapshot of the adaptive storage engine, returned by StatsArray::storageReport().
+  Ratios are from the last evaluation (every 1024 writes once size() >= 4096).
+*/
+struct StorageReport {
+    Storage     current;
+    Storage     proposed;       // storage the last evaluation asked for
+    bool        adaptive;       // setAdaptive(true) and not since pinned by setStorage()
+    unsigned    streak;         // consecutive evaluations agreeing on 'proposed'
+    size_t      migrations;
+    size_t      distinct;       // estimated from 1024 sampled pairs above 65536 values
+    double      distinctRatio;  // distinct / size()
+    double      writeFraction;  // (inserts + erases) / (inserts + erases + queries)
+    double      valueRange;     // max - min
+    bool        integral;       // sampled values all whole numbers
+    const char* reason;         // why 'proposed' was chosen
+};
+
 class StatsArray {
 public:
+    /*
+      Read-only window [first, first+count) over the sorted values.
+      Does not own data; invalidated by any modification of the owner.
+    */
+    class View {
+    public:
+        class const_iterator {
+        public:
+            const_iterator(const View* v, size_t i) : _v(v), _i(i) {}
+            double operator*() const { return (*_v)[_i]; }
+            const_iterator& operator++() { ++_i; return *this; }
+            bool operator==(const const_iterator& o) const { return _i == o._i; }
+            bool operator!=(const const_iterator& o) const { return _i != o._i; }
+        private:
+            const View* _v;
+            size_t      _i;
+        };
+
+        View(const StatsArray& owner, size_t first, size_t count) : _owner(&owner), _first(first), _count(count) {}
+
+        /*
+          Pre : none
+          Post: returns number of values in the view.
+        */
+        size_t size() const { return _count; }
+
+        /*
+          Pre : none
+          Post: returns true if the view holds no values.
+        */
+        bool empty() const { return _count == 0; }
+
+        /*
+          Pre : i < size()
+          Post: returns i-th value of the view (ascending).
+        */
+        double operator[](size_t i) const { assert(i < _count); return _owner->at(_first + i); }
+
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end()   const { return const_iterator(this, _count); }
+
+    private:
+        const StatsArray* _owner;
+        size_t _first;
+        size_t _count;
+    };
+
     // =========================== Rule of Three ============================
 
     /*
       Pre : none
-      Post: creates empty container; no allocation until first insert.
+      Post: creates empty container using the inline buffer; no allocation
+            until more than kInlineCap values are stored.
     */
-    StatsArray() : _data(nullptr), _used(0), _cap(0) {}
+    StatsArray() : _data(_inline), _used(0), _cap(kInlineCap), _cold(nullptr) {}
 
     /*
       Pre : cap0 >= 0
-      Post: creates empty container with capacity = max(8, cap0).
+      Post: creates empty container with capacity = max(kInlineCap, cap0).
     */
     explicit StatsArray(size_t cap0)
-        : _data(new (nothrow) double[cap0 > 0 ? cap0 : 8]),
+        : _data(allocData(cap0)),
         _used(0),
-        _cap(cap0 > 0 ? cap0 : 8) {
+        _cap(cap0 > kInlineCap ? cap0 : kInlineCap),
+        _cold(nullptr) {
         assert(_data != nullptr);
     }
 
@@ -76,11 +406,12 @@ public:
       Post: *this is a deep copy of other.
     */
     StatsArray(const StatsArray& other)
-        : _data(new (nothrow) double[other._cap]),
+        : _data(other.flatLayout() && !other.borrowed() ? allocData(other._cap) : other._data),
         _used(other._used),
-        _cap(other._cap) {
-        assert(_data != nullptr);
-        if (_used) memcpy(_data, other._data, _used * sizeof(double));
+        _cap(other.borrowed() ? other._cap : other.flatLayout() ? (other._cap > kInlineCap ? other._cap : kInlineCap) : 0),
+        _cold(other._cold ? new ColdState(*other._cold) : nullptr) {
+        assert(_data != nullptr || !other.flatLayout());
+        if (_used && other.flatLayout() && !borrowed()) memcpy(_data, other._data, _used * sizeof(double));
     }
 
     /*
@@ -89,11 +420,15 @@ public:
     */
     StatsArray& operator=(const StatsArray& other) {
         if (this == &other) return *this;
-        double* nd = new (nothrow) double[other._cap];
-        assert(nd != nullptr);
-        if (other._used) memcpy(nd, other._data, other._used * sizeof(double));
-        delete[] _data;
-        _data = nd; _used = other._used; _cap = other._cap;
+        ColdState* ncold = other._cold ? new ColdState(*other._cold) : nullptr;
+        // Release the old buffer before allocating: the copy may land in _inline.
+        freeData(_data);
+        // a borrowed buffer is shared, not copied
+        double* nd = other.borrowed() ? other._data : other.flatLayout() ? allocData(other._cap) : nullptr;
+        size_t ncap = other.borrowed() ? other._cap : other.flatLayout() ? (other._cap > kInlineCap ? other._cap : kInlineCap) : 0;
+        if (other._used && other.flatLayout() && !other.borrowed()) memcpy(nd, other._data, other._used * sizeof(double));
+        delete _cold;
+        _data = nd; _used = other._used; _cap = ncap; _cold = ncold;
         return *this;
     }
 
@@ -101,7 +436,7 @@ public:
       Pre : object valid
       Post: dynamic memory released.
     */
-    ~StatsArray() { delete[] _data; }
+    ~StatsArray() { freeData(_data); delete _cold; }
 
     // ============================== Modifiers =============================
 
@@ -110,9 +445,64 @@ public:
       Post: x inserted at sorted position; size() increases by 1.
     */
     void insert(double x) {
-        assert(isfinite(x));
-        size_t pos = lowerBound(x);
-        insertAt(pos, x);
+        assert(std::isfinite(x));
+        const Storage st = storage();
+        if (st == Storage::DICTIONARY) { _cold->dict->add(x); ++_used; }
+        else if (st == Storage::BLOCKS) { _cold->blocks->add(x); ++_used; }
+        else if (st == Storage::BUFFERED) { growIfNeeded(); _data[_used++] = x; ++_cold->pending; }
+        else { size_t pos = lowerBound(x); insertAt(pos, x); }
+        if (FrequencyIndex* f = freqIndex()) f->add(x);
+        statsCount(StatsCounter::INSERTS);
+        noteWrite(true);
+    }
+
+    /*
+      Pre : xs points at n values (NaN/Inf allowed)
+      Post: non-finite values found in SIMD batches and handled per policy;
+            the accepted values are sorted once and merged in a single pass.
+            Returns inserted count and the count of each non-finite class.
+    */
+    IngestReport insertBulk(const double* xs, size_t n, IngestPolicy policy = IngestPolicy::SKIP) {
+        IngestReport rep;
+        std::vector<double> ok; ok.reserve(n);
+        size_t from = 0;
+        forEachNonFinite(xs, n, [&](size_t i) {
+            ok.insert(ok.end(), xs + from, xs + i); from = i + 1;
+            const double x = xs[i];
+            if (x != x) { ++rep.nan; return; }
+            if (x > 0) ++rep.posInf; else ++rep.negInf;
+            if (policy == IngestPolicy::CLAMP) {
+                ok.push_back(x > 0 ? std::numeric_limits<double>::max() : std::numeric_limits<double>::lowest());
+                ++rep.clamped;
+            }
+            });
+        ok.insert(ok.end(), xs + from, xs + n);
+        if (policy == IngestPolicy::REJECT && rep.invalid()) { rep.rejected = true; return rep; }
+        if (ok.empty()) return rep;
+
+        std::sort(ok.begin(), ok.end());
+        const size_t m = ok.size();
+        if (flatLayout()) {
+            growIfNeeded(m);
+            memcpy(_data + _used, ok.data(), m * sizeof(double));
+            if (storage() == Storage::FLAT) {
+                const size_t mergeFrom = lowerBound(ok[0]);   // values before it stay put
+                statsCount(StatsCounter::MEMMOVE_BYTES, (_used - mergeFrom + m) * sizeof(double));
+                std::inplace_merge(_data + mergeFrom, _data + _used, _data + _used + m);
+            }
+            else _cold->pending += m;
+            _used += m;
+        }
+        else if (storage() == Storage::DICTIONARY) {
+            forEachRun(ok.data(), m, [&](size_t start, size_t len) { _cold->dict->add(ok[start], len); });
+            _used += m;
+        }
+        else { for (size_t i = 0; i < m; ++i) _cold->blocks->add(ok[i]); _used += m; }
+        if (FrequencyIndex* f = freqIndex()) forEachRun(ok.data(), m, [&](size_t start, size_t len) { f->add(ok[start], len); });
+        rep.inserted = m;
+        statsCount(StatsCounter::BULK_VALUES, m);
+        noteWrite(true, m);
+        return rep;
     }
 
     /*
@@ -121,11 +511,24 @@ public:
     */
     size_t eraseValue(double v, size_t count = 1) {
         assert(count >= 1);
-        size_t pos = lowerBound(v), removed = 0;
-        while (pos < _used && _data[pos] == v && removed < count) {
-            for (size_t i = pos + 1; i < _used; ++i) _data[i - 1] = _data[i];
-            --_used; ++removed;
+        size_t removed = 0;
+        if (!flatLayout()) {
+            removed = storage() == Storage::DICTIONARY ? _cold->dict->remove(v, count) : _cold->blocks->remove(v, count);
+            _used -= removed;
         }
+        else {
+            settle(); own();
+            size_t pos = lowerBound(v);
+            while (pos < _used && _data[pos] == v && removed < count) {
+                statsCount(StatsCounter::MEMMOVE_BYTES, (_used - pos - 1) * sizeof(double));
+                for (size_t i = pos + 1; i < _used; ++i) _data[i - 1] = _data[i];
+                --_used; ++removed;
+            }
+        }
+        if (removed) statsCount(StatsCounter::ERASES, removed);
+        FrequencyIndex* f = freqIndex();
+        if (f && removed) f->remove(v, removed);
+        noteWrite(false);
         return removed;
     }
 
@@ -135,15 +538,116 @@ public:
     */
     void eraseAt(size_t idx) {
         assert(idx < _used);
-        for (size_t i = idx + 1; i < _used; ++i) _data[i - 1] = _data[i];
-        --_used;
+        if (!flatLayout()) {
+            double v = storage() == Storage::DICTIONARY ? _cold->dict->removeAt(idx) : _cold->blocks->removeAt(idx);
+            --_used;
+            if (FrequencyIndex* f = freqIndex()) f->remove(v);
+        }
+        else {
+            settle(); own();
+            if (FrequencyIndex* f = freqIndex()) f->remove(_data[idx]);
+            statsCount(StatsCounter::MEMMOVE_BYTES, (_used - idx - 1) * sizeof(double));
+            for (size_t i = idx + 1; i < _used; ++i) _data[i - 1] = _data[i];
+            --_used;
+        }
+        statsCount(StatsCounter::ERASES);
+        noteWrite(false);
+    }
+
+    /*
+      Pre : none
+      Post: size() becomes 0; capacity unchanged (a borrowed buffer is dropped).
+    */
+    void clear() {
+        _used = 0;
+        if (!_cold) return;
+        if (_cold->borrow) { _cold->borrow.reset(); _data = _inline; _cap = kInlineCap; }
+        _cold->pending = 0;
+        if (_cold->freq) _cold->freq->clear();
+        if (_cold->dict) _cold->dict->clear();
+        if (_cold->blocks) _cold->blocks->clear();
+    }
+
+    /*
+      Pre : xs holds n finite values in ascending order; keepAlive is non-null
+            and keeps xs valid (e.g. owns the file mapping)
+      Post: contents replaced by xs. FLAT/BUFFERED storage reads xs in place
+            (borrowed() == true) until the first write copies it; other
+            storages copy now. O(1) for FLAT/BUFFERED without a frequency
+            index: xs is not read, and adoption is not a write to the
+            adaptive engine.
+    */
+    void adoptSorted(const double* xs, size_t n, std::shared_ptr<const void> keepAlive) {
+        assert(keepAlive);
+        clear();
+        if (n == 0) return;
+        if (!flatLayout()) { insertBulk(xs, n); return; }
+        freeData(_data);
+        _data = const_cast<double*>(xs); _cap = n; _used = n;   // never written while borrowed
+        cold().borrow = keepAlive;
+        if (FrequencyIndex* f = freqIndex()) forEachRun(_data, n, [&](size_t start, size_t len) { f->add(_data[start], len); });
     }
 
     /*
       Pre : none
-      Post: size() becomes 0; capacity unchanged.
+      Post: on=true builds the value->count index from the current data and keeps
+            it updated on every insert/erase; on=false drops it.
     */
-    void clear() { _used = 0; }
+    void enableFrequencyIndex(bool on) {
+        if (!on) { if (_cold) { delete _cold->freq; _cold->freq = nullptr; } return; }
+        if (freqIndex()) return;
+        FrequencyIndex* f = new FrequencyIndex();
+        forEachDistinct([&](double v, size_t c) { f->add(v, c); });
+        cold().freq = f;
+    }
+
+    /*
+      Pre : none
+      Post: values moved to the requested storage; contents and order unchanged.
+            Turns adaptive mode off so the choice sticks.
+    */
+    void setStorage(Storage target) { if (_cold) _cold->adaptive = false; migrate(target); }
+
+    /*
+      Pre : none
+      Post: on=true lets the array pick its storage from the observed data and
+            op mix (evaluated every 1024 writes once size() >= 4096, two agreeing
+            evaluations needed to migrate); on=false (the default) keeps the
+            current storage. Once BUFFERED, DICTIONARY or BLOCKS, const
+            queries update internal state (the pending tail, the rank table,
+            the decoded-block cache), so a shared array needs external
+            locking even for reads.
+    */
+    void setAdaptive(bool on) { if (on || _cold) cold().adaptive = on; }
+
+    /*
+      Pre : none
+      Post: returns true if storage is chosen automatically.
+    */
+    bool adaptive() const { return _cold && _cold->adaptive; }
+
+    /*
+      Pre : none
+      Post: returns the adaptive engine's current view: storage, last samples,
+            pending proposal and why it was made.
+    */
+    StorageReport storageReport() const {
+        StorageReport r;
+        r.current = storage(); r.adaptive = adaptive();
+        if (_cold && _cold->adapt) {
+            const AdaptiveState& a = *_cold->adapt;
+            r.proposed = a.proposed; r.streak = a.streak; r.migrations = a.migrations;
+            r.distinct = a.distinct; r.distinctRatio = a.distinctRatio;
+            r.writeFraction = a.writeFraction; r.valueRange = a.range;
+            r.integral = a.integral; r.reason = a.reason;
+        }
+        else {
+            r.proposed = r.current; r.streak = 0; r.migrations = 0; r.distinct = 0; r.distinctRatio = 0.0;
+            r.writeFraction = 0.0; r.valueRange = 0.0; r.integral = false;
+            r.reason = r.adaptive ? "not sampled yet (size < 4096)" : "adaptive mode off";
+        }
+        return r;
+    }
 
     // ============================== Accessors =============================
 
@@ -155,7 +659,8 @@ public:
 
     /*
       Pre : none
-      Post: returns current capacity.
+      Post: returns current capacity of the flat buffer (0 for DICTIONARY/BLOCKS);
+            at least kInlineCap while the values live inline.
     */
     size_t capacity() const { return _cap; }
 
@@ -163,75 +668,426 @@ public:
       Pre : idx < size()
       Post: returns value at idx.
     */
-    double at(size_t idx) const { assert(idx < _used); return _data[idx]; }
+    double at(size_t idx) const {
+        assert(idx < _used);
+        if (!_cold || _cold->store == Storage::FLAT) return _data[idx];
+        if (flatLayout()) { settle(); return _data[idx]; }
+        return _cold->store == Storage::DICTIONARY ? _cold->dict->valueAtRank(idx) : _cold->blocks->valueAtRank(idx);
+    }
 
     /*
       Pre : none
       Post: returns underlying array address (for display).
     */
-    const void* dataAddress() const { return static_cast<const void*>(_data); }
+    const void* dataAddress() const {
+        if (flatLayout()) return static_cast<const void*>(_data);
+        return storage() == Storage::DICTIONARY ? _cold->dict->address() : _cold->blocks->address();
+    }
+
+    /*
+      Pre : none
+      Post: returns current storage kind.
+    */
+    Storage storage() const { return _cold ? _cold->store : Storage::FLAT; }
+
+    /*
+      Pre : none
+      Post: returns true while the values are read from an adopted external buffer.
+    */
+    bool borrowed() const { return _cold && _cold->borrow; }
+
+    /*
+      Pre : none
+      Post: an adopted buffer is copied into owned memory and let go
+            (borrowed() == false), e.g. before its file is replaced;
+            otherwise nothing changes.
+    */
+    void detach() { own(); }
+
+    /*
+      Pre : out has room for size() values
+      Post: out[0..size()) holds the values in ascending order.
+    */
+    void copyTo(double* out) const {
+        if (flatLayout()) { settle(); if (_used) memcpy(out, _data, _used * sizeof(double)); return; }
+        scan([&](double x, size_t w) { while (w--) *out++ = x; });
+    }
+
+    /*
+      Pre : none
+      Post: returns heap bytes held for the values (buffer, dictionary or blocks);
+            0 while the values live in the inline buffer or are borrowed.
+    */
+    size_t memoryBytes() const {
+        if (flatLayout()) return (_data == _inline || borrowed()) ? 0 : _cap * sizeof(double);
+        return storage() == Storage::DICTIONARY ? _cold->dict->bytes() : _cold->blocks->bytes();
+    }
+
+    /*
+      Pre : none
+      Post: returns view of the min(k, size()) smallest values, ascending.
+    */
+    View bottomK(size_t k) const { return View(*this, 0, k < _used ? k : _used); }
+
+    /*
+      Pre : none
+      Post: returns view of the min(k, size()) largest values, ascending.
+    */
+    View topK(size_t k) const { size_t c = k < _used ? k : _used; return View(*this, _used - c, c); }
+
+    /*
+      Pre : none
+      Post: returns true if the frequency index is maintained.
+    */
+    bool frequencyIndexEnabled() const { return freqIndex() != nullptr; }
+
+    /*
+      Pre : none
+      Post: returns number of occurrences of v.
+    */
+    size_t count(double v) const {
+        if (FrequencyIndex* f = freqIndex()) return f->count(v);
+        if (storage() == Storage::DICTIONARY) return _cold->dict->count(v);
+        if (storage() == Storage::BLOCKS) return _cold->blocks->count(v);
+        settle();
+        return upperBound(v) - lowerBound(v);
+    }
+
+    // ======================= Statistics (non-throwing) ====================
+    // Each tryX() reports a too-small dataset through StatsResult::error
+    // instead of throwing; nothing is allocated on either path.
+
+    /*
+      Pre : none
+      Post: smallest value, or EMPTY.
+    */
+    StatsResult tryMin() const { StatsResult r = checkSize(1, "Minimum"); if (r.ok()) r.value = at(0); return r; }
+
+    /*
+      Pre : none
+      Post: largest value, or EMPTY.
+    */
+    StatsResult tryMax() const { StatsResult r = checkSize(1, "Maximum"); if (r.ok()) r.value = at(_used - 1); return r; }
+
+    /*
+      Pre : none
+      Post: max - min, or EMPTY.
+    */
+    StatsResult tryRange() const { StatsResult r = checkSize(1, "Range"); if (r.ok()) r.value = at(_used - 1) - at(0); return r; }
+
+    /*
+      Pre : none
+      Post: sum of all values, or EMPTY.
+    */
+    StatsResult trySum() const {
+        StatsResult r = checkSize(1, "Sum");
+        if (!r.ok()) return r;
+        if (storage() == Storage::BLOCKS) { r.value = (double)_cold->blocks->sum(); return r; }
+        long double s = 0.0L; scan([&](double x, size_t w) { s += (long double)w * x; });
+        r.value = (double)s;
+        return r;
+    }
+
+    /*
+      Pre : none
+      Post: arithmetic mean, or EMPTY.
+    */
+    StatsResult tryMean() const { StatsResult r = trySum(); if (r.ok()) r.value /= (double)_used; return r; }
+
+    /*
+      Pre : none
+      Post: median of sorted data, or EMPTY.
+    */
+    StatsResult tryMedian() const {
+        StatsResult r = checkSize(1, "Median");
+        if (r.ok()) { size_t n = _used, m = n / 2; r.value = (n % 2) ? at(m) : (at(m - 1) + at(m)) / 2.0; }
+        return r;
+    }
+
+    /*
+      Pre : none
+      Post: variance (sample uses n-1; population uses n), or EMPTY/INSUFFICIENT.
+    */
+    StatsResult tryVariance(bool sample) const {
+        StatsResult r = checkSize(sample ? 2 : 1, sample ? "Variance (sample)" : "Variance (population)");
+        if (!r.ok()) return r;
+        const long double mu = tryMean().value;
+        long double ss = 0.0L; scan([&](double x, size_t w) { long double d = x - mu; ss += (long double)w * (d * d); });
+        const long double denom = sample ? (long double)(_used - 1) : (long double)_used;
+        long double ans = (denom > 0.0L ? ss / denom : 0.0L);
+        assert(std::isfinite((double)ans)); assert(ans >= -1e-12L);
+        if (!sample && _used == 1) assert(ans == 0.0L);
+        r.value = (double)ans;
+        return r;
+    }
+
+    /*
+      Pre : none
+      Post: standard deviation, or EMPTY/INSUFFICIENT.
+    */
+    StatsResult tryStdev(bool sample) const { StatsResult r = tryVariance(sample); if (r.ok()) r.value = std::sqrt(r.value); return r; }
+
+    /*
+      Pre : none
+      Post: (min + max)/2, or EMPTY.
+    */
+    StatsResult tryMidrange() const { StatsResult r = checkSize(1, "Midrange"); if (r.ok()) r.value = (at(0) + at(_used - 1)) / 2.0; return r; }
+
+    /*
+      Pre : none
+      Post: (Q1, Q2, Q3) using Tukey method, or EMPTY/INSUFFICIENT.
+    */
+    StatsResultOf<std::tuple<double, double, double>> tryQuartiles() const {
+        StatsResultOf<std::tuple<double, double, double>> r(checkSize(2, "Quartiles"));
+        if (!r.ok()) return r;
+        const double q2 = tryMedian().value;
+        const size_t n = _used, m = n / 2;
+        struct H {
+            static double subMed(const StatsArray& a, size_t L, size_t R) {
+                size_t len = R - L + 1, mid = L + len / 2; return (len % 2) ? a.at(mid) : (a.at(mid - 1) + a.at(mid)) / 2.0;
+            }
+        };
+        double q1, q3;
+        if (n % 2 == 0) { q1 = H::subMed(*this, 0, m - 1); q3 = H::subMed(*this, m, n - 1); }
+        else { q1 = H::subMed(*this, 0, m - 1); q3 = H::subMed(*this, m + 1, n - 1); }
+        assert(q1 <= q2 + 1e-12 && q2 <= q3 + 1e-12);
+        assert(q1 >= at(0) - 1e-12 && q3 <= at(_used - 1) + 1e-12);
+        r.value = std::make_tuple(q1, q2, q3);
+        return r;
+    }
+
+    /*
+      Pre : none
+      Post: Q3 - Q1, or EMPTY/INSUFFICIENT.
+    */
+    StatsResult tryIqr() const {
+        StatsResult r = checkSize(2, "Interquartile Range");
+        if (r.ok()) { StatsResultOf<std::tuple<double, double, double>> q = tryQuartiles(); r.value = std::get<2>(q.value) - std::get<0>(q.value); }
+        return r;
+    }
+
+    /*
+      Pre : none
+      Post: sum of squares, or EMPTY.
+    */
+    StatsResult trySumSquares() const {
+        StatsResult r = checkSize(1, "Sum of Squares");
+        if (!r.ok()) return r;
+        long double s = 0.0L; scan([&](double x, size_t w) { s += (long double)w * ((long double)x * x); });
+        r.value = (double)s;
+        return r;
+    }
+
+    /*
+      Pre : none
+      Post: mean absolute deviation from mean, or EMPTY.
+    */
+    StatsResult tryMeanAbsDeviation() const {
+        StatsResult r = checkSize(1, "Mean Absolute Deviation");
+        if (!r.ok()) return r;
+        long double mu = tryMean().value, s = 0.0L; scan([&](double x, size_t w) { s += (long double)w * fabsl(x - mu); });
+        r.value = (double)(s / (long double)_used);
+        return r;
+    }
+
+    /*
+      Pre : none
+      Post: root mean square, or EMPTY.
+    */
+    StatsResult tryRms() const {
+        StatsResult r = checkSize(1, "Root Mean Square");
+        if (r.ok()) r.value = std::sqrt(trySumSquares().value / (double)_used);
+        return r;
+    }
+
+    /*
+      Pre : none
+      Post: standard error of mean, or EMPTY/INSUFFICIENT.
+    */
+    StatsResult trySem(bool sample) const {
+        StatsResult r = checkSize(sample ? 2 : 1, sample ? "Standard Error of Mean (sample)" : "Standard Error of Mean (population)");
+        if (r.ok()) r.value = tryStdev(sample).value / std::sqrt((double)_used);
+        return r;
+    }
+
+    /*
+      Pre : none
+      Post: skewness (bias-corrected for sample), or EMPTY/INSUFFICIENT.
+    */
+    StatsResult trySkewness(bool sample) const {
+        StatsResult r = checkSize(sample ? 3 : 1, sample ? "Skewness (sample)" : "Skewness (population)");
+        if (!r.ok()) return r;
+        long double mu = tryMean().value, m2 = 0.0L, m3 = 0.0L, n = (long double)_used;
+        scan([&](double x, size_t w) { long double d = x - mu; m2 += (long double)w * (d * d); m3 += (long double)w * (d * d * d); });
+        if (sample) {
+            long double s2 = m2 / (n - 1.0L), s = std::sqrt(s2), g1 = (m3 / n) / (s * s * s);
+            r.value = (double)(std::sqrt(n * (n - 1.0L)) / (n - 2.0L) * g1);
+        }
+        else {
+            long double s2 = m2 / n, s = std::sqrt(s2); r.value = (double)((m3 / n) / (s * s * s));
+        }
+        return r;
+    }
+
+    /*
+      Pre : none
+      Post: Excel's bias-corrected "term1" kurtosis, or EMPTY/INSUFFICIENT.
+    */
+    StatsResult tryKurtosis() const {
+        StatsResult r = checkSize(4, "Kurtosis Excel term1");
+        if (r.ok()) r.value = (double)kurtosisTerm1();
+        return r;
+    }
+
+    /*
+      Pre : none
+      Post: Excel-style excess kurtosis, or EMPTY/INSUFFICIENT.
+    */
+    StatsResult tryKurtosisExcess() const {
+        StatsResult r = checkSize(4, "Kurtosis Excess Excel");
+        if (!r.ok()) return r;
+        long double n = static_cast<long double>(_used), term1 = kurtosisTerm1();
+        if (term1 == 0.0L) { r.value = 0.0; return r; }   // zero spread
+        long double term2 = (3.0L * (n - 1.0L) * (n - 1.0L)) /
+            ((n - 2.0L) * (n - 3.0L));
+        r.value = (double)(term1 - term2);   // ≈ 1.444851 for {0,9,34,92}
+        return r;
+    }
+
+    /*
+      Pre : none
+      Post: stdev/mean, or EMPTY/INSUFFICIENT, or UNDEFINED when mean == 0.
+    */
+    StatsResult tryCoefficientOfVariation(bool sample) const {
+        StatsResult r = checkSize(1, "Coefficient of Variation");
+        if (!r.ok()) return r;
+        double mu = tryMean().value;
+        if (mu == 0.0) return StatsResult::failure(StatsError::UNDEFINED, "Coefficient of Variation undefined when mean is 0.");
+        StatsResult sd = tryStdev(sample);
+        if (sd.ok()) sd.value /= mu;
+        return sd;
+    }
+
+    /*
+      Pre : none
+      Post: 100 * stdev/mean, or an error as tryCoefficientOfVariation.
+    */
+    StatsResult tryRelativeStdDeviation(bool sample) const {
+        StatsResult r = tryCoefficientOfVariation(sample);
+        if (r.ok()) r.value *= 100.0;
+        return r;
+    }
+
+    /*
+      Pre : none
+      Post: percentile p (0..100) by linear interpolation between closest
+            ranks, as StatsArrayPool::percentile; UNDEFINED if p is outside
+            0..100.
+    */
+    StatsResult tryPercentile(double p) const {
+        StatsResult r(checkSize(1, "Percentile"));
+        if (!r.ok()) return r;
+        if (!(p >= 0.0 && p <= 100.0)) return StatsResult::failure(StatsError::UNDEFINED, "Percentile must be within 0..100.");
+        const double rank = (p / 100.0) * (double)(_used - 1);
+        const size_t lo = (size_t)std::floor(rank);
+        r.value = lo + 1 >= _used ? at(_used - 1) : at(lo) + (rank - (double)lo) * (at(lo + 1) - at(lo));
+        return r;
+    }
+
+    /*
+      Pre : none
+      Post: statistic s (sample selects the n-1 forms; arg is the percentile
+            for PERCENTILE); error set like the try*() methods, UNDEFINED for
+            an unknown s.
+    */
+    StatsResult tryStatistic(Statistic s, bool sample = false, double arg = 0.0) const {
+        switch (s) {
+        case Statistic::COUNT:              { StatsResult r; r.value = (double)_used; return r; }
+        case Statistic::MIN:                return tryMin();
+        case Statistic::MAX:                return tryMax();
+        case Statistic::RANGE:              return tryRange();
+        case Statistic::SUM:                return trySum();
+        case Statistic::MEAN:               return tryMean();
+        case Statistic::MEDIAN:             return tryMedian();
+        case Statistic::VARIANCE:           return tryVariance(sample);
+        case Statistic::STDEV:              return tryStdev(sample);
+        case Statistic::MIDRANGE:           return tryMidrange();
+        case Statistic::IQR:                return tryIqr();
+        case Statistic::SUM_SQUARES:        return trySumSquares();
+        case Statistic::MEAN_ABS_DEVIATION: return tryMeanAbsDeviation();
+        case Statistic::RMS:                return tryRms();
+        case Statistic::SEM:                return trySem(sample);
+        case Statistic::SKEWNESS:           return trySkewness(sample);
+        case Statistic::KURTOSIS:           return tryKurtosis();
+        case Statistic::KURTOSIS_EXCESS:    return tryKurtosisExcess();
+        case Statistic::COEFF_VARIATION:    return tryCoefficientOfVariation(sample);
+        case Statistic::RSD:                return tryRelativeStdDeviation(sample);
+        case Statistic::PERCENTILE:         return tryPercentile(arg);
+        }
+        return StatsResult::failure(StatsError::UNDEFINED, "Unknown statistic.");
+    }
 
     // ============================== Statistics ============================
+    // Throwing forms: DatasetEmptyException / InsufficientDataException.
 
     /*
       Pre : size() >= 1
       Post: returns smallest value.
     */
-    double min() const { requireSize(1, "Minimum"); return _data[0]; }
+    double min() const { return tryMin().valueOrThrow(); }
 
     /*
       Pre : size() >= 1
       Post: returns largest value.
     */
-    double max() const { requireSize(1, "Maximum"); return _data[_used - 1]; }
+    double max() const { return tryMax().valueOrThrow(); }
 
     /*
       Pre : size() >= 1
       Post: returns max - min.
     */
-    double range() const { requireSize(1, "Range");   return _data[_used - 1] - _data[0]; }
+    double range() const { return tryRange().valueOrThrow(); }
 
     /*
       Pre : size() >= 1
       Post: returns sum of all values.
     */
-    double sum() const {
-        requireSize(1, "Sum");
-        long double s = 0.0L; for (size_t i = 0;i < _used;++i) s += _data[i];
-        return (double)s;
-    }
+    double sum() const { return trySum().valueOrThrow(); }
 
     /*
       Pre : size() >= 1
       Post: returns arithmetic mean.
     */
-    double mean() const { requireSize(1, "Mean"); return sum() / (double)_used; }
+    double mean() const { return tryMean().valueOrThrow(); }
 
     /*
       Pre : size() >= 1
       Post: returns median of sorted data.
     */
-    double median() const {
-        requireSize(1, "Median");
-        size_t n = _used, m = n / 2; return (n % 2) ? _data[m] : (_data[m - 1] + _data[m]) / 2.0;
-    }
+    double median() const { return tryMedian().valueOrThrow(); }
 
     /*
       Pre : size() >= 1
       Post: returns list of modes; empty if no mode.
     */
-    vector<double> modes() const {
+    std::vector<double> modes() const {
         requireSize(1, "Mode(s)");
-        vector<double> res; size_t best = 0, i = 0;
-        while (i < _used) {
-            size_t j = i + 1; while (j < _used && _data[j] == _data[i]) ++j;
-            if (j - i > best) best = j - i; i = j;
-        }
-        if (best <= 1) return res;
-        i = 0; while (i < _used) {
-            size_t j = i + 1; while (j < _used && _data[j] == _data[i]) ++j;
-            if (j - i == best) res.push_back(_data[i]); i = j;
+        if (FrequencyIndex* f = freqIndex()) return f->modes();
+        if (!flatLayout()) {
+            std::vector<double> res; size_t best = 1;
+            forEachDistinct([&](double v, size_t c) {
+                if (c > best) { best = c; res.clear(); res.push_back(v); }
+                else if (c == best && best > 1) res.push_back(v);
+                });
+            return res;
         }
+        settle();
+        // single pass: restart the list whenever a longer run shows up
+        std::vector<double> res; size_t best = 1; const double* a = _data;
+        forEachRun(a, _used, [&](size_t start, size_t len) {
+            if (len > best) { best = len; res.clear(); res.push_back(a[start]); }
+            else if (len == best && best > 1) res.push_back(a[start]);
+            });
         return res;
     }
 
@@ -239,64 +1095,40 @@ public:
       Pre : sample ? size() >= 2 : size() >= 1
       Post: returns variance (sample uses n-1; population uses n).
     */
-    double variance(bool sample) const {
-        if (sample) requireSize(2, "Variance (sample)"); else requireSize(1, "Variance (population)");
-        const long double mu = mean();
-        long double ss = 0.0L; for (size_t i = 0;i < _used;++i) { long double d = _data[i] - mu; ss += d * d; }
-        const long double denom = sample ? (long double)(_used - 1) : (long double)_used;
-        long double ans = (denom > 0.0L ? ss / denom : 0.0L);
-        assert(isfinite((double)ans)); assert(ans >= -1e-12L);
-        if (!sample && _used == 1) assert(ans == 0.0L);
-        return (double)ans;
-    }
+    double variance(bool sample) const { return tryVariance(sample).valueOrThrow(); }
 
     /*
       Pre : sample ? size() >= 2 : size() >= 1
       Post: returns standard deviation.
     */
-    double stdev(bool sample) const { return sqrt(variance(sample)); }
+    double stdev(bool sample) const { return tryStdev(sample).valueOrThrow(); }
 
     /*
       Pre : size() >= 1
       Post: returns (min + max)/2.
     */
-    double midrange() const { requireSize(1, "Midrange"); return (min() + max()) / 2.0; }
+    double midrange() const { return tryMidrange().valueOrThrow(); }
 
     /*
       Pre : size() >= 2
       Post: returns (Q1, Q2, Q3) using Tukey method; Q1 <= Q2 <= Q3.
     */
-    tuple<double, double, double> quartiles() const {
-        requireSize(2, "Quartiles");
-        const double q2 = median();
-        const size_t n = _used, m = n / 2;
-        struct H {
-            static double subMed(const double* a, size_t L, size_t R) {
-                size_t len = R - L + 1, mid = L + len / 2; return (len % 2) ? a[mid] : (a[mid - 1] + a[mid]) / 2.0;
-            }
-        };
-        double q1, q3;
-        if (n % 2 == 0) { q1 = H::subMed(_data, 0, m - 1); q3 = H::subMed(_data, m, n - 1); }
-        else { q1 = H::subMed(_data, 0, m - 1); q3 = H::subMed(_data, m + 1, n - 1); }
-        assert(q1 <= q2 + 1e-12 && q2 <= q3 + 1e-12);
-        assert(q1 >= _data[0] - 1e-12 && q3 <= _data[_used - 1] + 1e-12);
-        return make_tuple(q1, q2, q3);
-    }
+    std::tuple<double, double, double> quartiles() const { return tryQuartiles().valueOrThrow(); }
 
     /*
       Pre : size() >= 2
       Post: returns Q3 - Q1.
     */
-    double iqr() const { requireSize(2, "Interquartile Range"); double q1, q2, q3; tie(q1, q2, q3) = quartiles(); (void)q2; return q3 - q1; }
+    double iqr() const { return tryIqr().valueOrThrow(); }
 
     /*
       Pre : size() >= 2
       Post: returns values < (Q1 - 1.5*IQR) or > (Q3 + 1.5*IQR).
     */
-    vector<double> outliers() const {
-        requireSize(2, "Outliers"); double q1, q2, q3; tie(q1, q2, q3) = quartiles(); (void)q2;
-        double w = 1.5 * (q3 - q1), lo = q1 - w, hi = q3 + w; vector<double> res;
-        for (size_t i = 0;i < _used;++i) if (_data[i]<lo || _data[i]>hi) res.push_back(_data[i]);
+    std::vector<double> outliers() const {
+        requireSize(2, "Outliers"); double q1, q2, q3; std::tie(q1, q2, q3) = tryQuartiles().value; (void)q2;
+        double w = 1.5 * (q3 - q1), lo = q1 - w, hi = q3 + w; std::vector<double> res;
+        scan([&](double x, size_t c) { if (x<lo || x>hi) res.insert(res.end(), c, x); });
         return res;
     }
 
@@ -304,148 +1136,85 @@ public:
       Pre : size() >= 1
       Post: returns sum of squares.
     */
-    double sumSquares() const {
-        requireSize(1, "Sum of Squares");
-        long double s = 0.0L; for (size_t i = 0;i < _used;++i) s += (long double)_data[i] * _data[i]; return (double)s;
-    }
+    double sumSquares() const { return trySumSquares().valueOrThrow(); }
 
     /*
       Pre : size() >= 1
       Post: returns mean absolute deviation from mean.
     */
-    double meanAbsDeviation() const {
-        requireSize(1, "Mean Absolute Deviation");
-        long double mu = mean(), s = 0.0L; for (size_t i = 0;i < _used;++i) s += fabsl(_data[i] - mu);
-        return (double)(s / (long double)_used);
-    }
+    double meanAbsDeviation() const { return tryMeanAbsDeviation().valueOrThrow(); }
 
     /*
       Pre : size() >= 1
       Post: returns root mean square.
     */
-    double rms() const { requireSize(1, "Root Mean Square"); return sqrt(sumSquares() / (double)_used); }
+    double rms() const { return tryRms().valueOrThrow(); }
 
     /*
       Pre : sample ? size() >= 2 : size() >= 1
       Post: returns standard error of mean.
     */
-    double sem(bool sample) const {
-        if (sample) requireSize(2, "Standard Error of Mean (sample)");
-        else        requireSize(1, "Standard Error of Mean (population)");
-        return stdev(sample) / sqrt((double)_used);
-    }
+    double sem(bool sample) const { return trySem(sample).valueOrThrow(); }
 
     /*
       Pre : sample ? size() >= 3 : size() >= 1
       Post: returns skewness (bias-corrected for sample).
     */
-    double skewness(bool sample) const {
-        if (sample) requireSize(3, "Skewness (sample)"); else requireSize(1, "Skewness (population)");
-        long double mu = mean(), m2 = 0.0L, m3 = 0.0L, n = (long double)_used;
-        for (size_t i = 0;i < _used;++i) { long double d = _data[i] - mu; m2 += d * d; m3 += d * d * d; }
-        if (sample) {
-            long double s2 = m2 / (n - 1.0L), s = sqrt(s2), g1 = (m3 / n) / (s * s * s);
-            return (double)(sqrt(n * (n - 1.0L)) / (n - 2.0L) * g1);
-        }
-        else {
-            long double s2 = m2 / n, s = sqrt(s2); return (double)((m3 / n) / (s * s * s));
-        }
-    }
+    double skewness(bool sample) const { return trySkewness(sample).valueOrThrow(); }
 
     /*
    Pre : size() >= 4
    Post: Returns Excel's bias-corrected "term1" value
          (some sites label this as β2).
  */
-    double kurtosis() const {
-        requireSize(4, "Kurtosis Excel term1");
-
-        long double n = static_cast<long double>(_used);
-        long double mu = mean();
-
-        // sample variance (denominator n-1)
-        long double s2 = 0.0L;
-        for (size_t i = 0; i < _used; ++i) {
-            long double d = _data[i] - mu;
-            s2 += d * d;
-        }
-        long double s = sqrt(s2 / (n - 1.0L));
-        if (s == 0.0L) return 0.0;
-
-        // standardized deviations
-        long double sumZ4 = 0.0L;
-        for (size_t i = 0; i < _used; ++i) {
-            long double z = (_data[i] - mu) / s;
-            sumZ4 += z * z * z * z;
-        }
-
-        // Excel bias-corrected term1
-        long double term1 = (n * (n + 1.0L)) /
-            ((n - 1.0L) * (n - 2.0L) * (n - 3.0L)) * sumZ4;
-
-        return (double)term1;   // ≈ 14.944851 for {0,9,34,92}
-    }
+    double kurtosis() const { return tryKurtosis().valueOrThrow(); }
 
     /*
   Pre : size() >= 4
   Post: Returns Excel-style Excess Kurtosis (α4).
 */
-    double kurtosisExcess() const {
-        requireSize(4, "Kurtosis Excess Excel");
-
-        long double n = static_cast<long double>(_used);
-        long double mu = mean();
-
-        long double s2 = 0.0L;
-        for (size_t i = 0; i < _used; ++i) {
-            long double d = _data[i] - mu;
-            s2 += d * d;
-        }
-        long double s = sqrt(s2 / (n - 1.0L));
-        if (s == 0.0L) return 0.0;
-
-        long double sumZ4 = 0.0L;
-        for (size_t i = 0; i < _used; ++i) {
-            long double z = (_data[i] - mu) / s;
-            sumZ4 += z * z * z * z;
-        }
-
-        long double term1 = (n * (n + 1.0L)) /
-            ((n - 1.0L) * (n - 2.0L) * (n - 3.0L)) * sumZ4;
-        long double term2 = (3.0L * (n - 1.0L) * (n - 1.0L)) /
-            ((n - 2.0L) * (n - 3.0L));
-
-        return (double)(term1 - term2);   // ≈ 1.444851
-    }
+    double kurtosisExcess() const { return tryKurtosisExcess().valueOrThrow(); }
 
 
     /*
       Pre : size() >= 1 and mean() != 0
       Post: returns stdev/mean.
     */
-    double coefficientOfVariation(bool sample) const {
-        requireSize(1, "Coefficient of Variation");
-        double mu = mean(); if (mu == 0.0) throw InsufficientDataException("Coefficient of Variation undefined when mean is 0.");
-        return stdev(sample) / mu;
-    }
+    double coefficientOfVariation(bool sample) const { return tryCoefficientOfVariation(sample).valueOrThrow(); }
 
     /*
       Pre : size() >= 1 and mean() != 0
       Post: returns 100 * stdev/mean.
     */
-    double relativeStdDeviation(bool sample) const { return 100.0 * coefficientOfVariation(sample); }
+    double relativeStdDeviation(bool sample) const { return tryRelativeStdDeviation(sample).valueOrThrow(); }
 
     /*
       Pre : size() >= 1
       Post: returns (value,count) pairs in ascending order.
     */
-    vector<pair<double, size_t>> frequencyTable() const {
+    std::vector<std::pair<double, size_t>> frequencyTable() const {
         requireSize(1, "Frequency Table");
-        vector<pair<double, size_t>> ft; size_t i = 0;
-        while (i < _used) {
-            size_t j = i + 1; while (j < _used && _data[j] == _data[i]) ++j;
-            ft.push_back(make_pair(_data[i], j - i)); i = j;
-        }
+        std::vector<std::pair<double, size_t>> ft;
+        if (flatLayout()) { settle(); ft.reserve(countRuns(_data, _used)); }
+        else if (storage() == Storage::DICTIONARY) ft.reserve(_cold->dict->distinct());
+        forEachDistinct([&](double v, size_t c) { ft.push_back(std::make_pair(v, c)); });
+        return ft;
+    }
+
+    /*
+      Pre : size() >= 1
+      Post: returns up to k (value,count) pairs by descending count; ties by ascending value.
+    */
+    std::vector<std::pair<double, size_t>> mostFrequent(size_t k) const {
+        requireSize(1, "Most Frequent");
+        if (FrequencyIndex* f = freqIndex()) return f->mostFrequent(k);
+        std::vector<std::pair<double, size_t>> ft = frequencyTable();
+        size_t n = std::min(k, ft.size());
+        partial_sort(ft.begin(), ft.begin() + n, ft.end(),
+            [](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b) {
+                return a.second != b.second ? a.second > b.second : a.first < b.first;
+            });
+        ft.resize(n);
         return ft;
     }
 
@@ -453,10 +1222,10 @@ public:
       Pre : size() >= 1
       Post: writes a full, formatted report of statistics to os.
     */
-    void printAll(ostream& os, bool sample) const {
+    void printAll(std::ostream& os, bool sample) const {
         requireSize(1, "Print All");
         os << "DATA (sorted, n=" << _used << "): ";
-        for (size_t i = 0;i < _used;++i) { if (i) os << ' '; os << _data[i]; }
+        { bool first = true; scan([&](double x, size_t w) { while (w--) { if (!first) os << ' '; os << x; first = false; } }); }
         os << "\n\n";
         os << "Min: " << min() << "\n";
         os << "Max: " << max() << "\n";
@@ -469,7 +1238,7 @@ public:
         os << "Std Dev (" << (sample ? "sample" : "population") << "): " << stdev(sample) << "\n";
         os << "Midrange: " << midrange() << "\n";
         {
-            double q1, q2, q3; tie(q1, q2, q3) = quartiles(); os << "Quartiles (Q1,Q2,Q3): " << q1 << ", " << q2 << ", " << q3 << "\n";
+            double q1, q2, q3; std::tie(q1, q2, q3) = quartiles(); os << "Quartiles (Q1,Q2,Q3): " << q1 << ", " << q2 << ", " << q3 << "\n";
             os << "IQR: " << (q3 - q1) << "\n";
         }
         { auto v = outliers(); os << "Outliers (Tukey +/- 1.5*IQR): "; if (v.empty()) os << "(none)\n"; else { for (size_t i = 0;i < v.size();++i) { if (i) os << ' '; os << v[i]; } os << "\n"; } }
@@ -484,12 +1253,12 @@ public:
         os << "Relative Std Dev (%): " << relativeStdDeviation(sample) << "\n";
 
         os << "\nFrequency Table\n\n";
-        os << left << setw(10) << "Value" << setw(12) << "Frequency" << setw(12) << "Frequency %\n";
+        os << std::left << std::setw(10) << "Value" << std::setw(12) << "Frequency" << std::setw(12) << "Frequency %\n";
         auto ft = frequencyTable(); size_t total = _used;
         for (auto& p : ft) {
             double perc = 100.0 * (double)p.second / (double)total;
-            os << left << setw(10) << p.first << setw(12) << p.second
-                << setw(12) << fixed << setprecision(2) << perc << "\n";
+            os << std::left << std::setw(10) << p.first << std::setw(12) << p.second
+                << std::setw(12) << std::fixed << std::setprecision(2) << perc << "\n";
         }
     }
 
@@ -497,36 +1266,159 @@ public:
       Pre : path not empty; size() >= 1
       Post: writes printAll() to file; returns true on success.
     */
-    bool writeAllToFile(const string& path, bool sample) const {
+    bool writeAllToFile(const std::string& path, bool sample) const {
         requireSize(1, "Write All to File");
-        ofstream fout(path); if (!fout) return false; printAll(fout, sample); return true;
+        std::ofstream fout(path); if (!fout) return false; printAll(fout, sample); return true;
     }
 
 private:
-    double* _data;
-    size_t  _used;
-    size_t  _cap;
+    // Adaptive engine state; allocated once the array first reaches kAdaptMin values.
+    struct AdaptiveState {
+        size_t      inserts, erases, queries;   // since the last evaluation
+        size_t      untilEval;
+        Storage     proposed;
+        unsigned    streak;
+        size_t      migrations;
+        size_t      distinct;
+        double      distinctRatio, writeFraction, range;
+        bool        integral;
+        const char* reason;
+    };
+
+    // Everything but the flat buffer, allocated on first use: a FLAT array that
+    // owns its values, with no frequency index and adaptive mode off, has none.
+    struct ColdState {
+        std::shared_ptr<const void> borrow;   // non-null while _data is an adopted external buffer
+        FrequencyIndex*  freq;      // null unless enableFrequencyIndex(true)
+        Storage          store;
+        DictionaryStore* dict;      // values when store == DICTIONARY, else null
+        BlockStore*      blocks;    // values when store == BLOCKS, else null
+        size_t           pending;   // BUFFERED: unsorted values at the tail of _data
+        bool             adaptive;
+        AdaptiveState*   adapt;
+
+        ColdState() : freq(nullptr), store(Storage::FLAT), dict(nullptr), blocks(nullptr), pending(0), adaptive(false), adapt(nullptr) {}
+        ColdState(const ColdState& o)
+            : borrow(o.borrow),
+            freq(o.freq ? new FrequencyIndex(*o.freq) : nullptr),
+            store(o.store),
+            dict(o.dict ? new DictionaryStore(*o.dict) : nullptr),
+            blocks(o.blocks ? new BlockStore(*o.blocks) : nullptr),
+            pending(o.pending),
+            adaptive(o.adaptive),
+            adapt(o.adapt ? new AdaptiveState(*o.adapt) : nullptr) {}
+        ~ColdState() { delete freq; delete dict; delete blocks; delete adapt; }
+    private:
+        ColdState& operator=(const ColdState&);   // not assignable
+    };
+
+    double*    _data;
+    size_t     _used;
+    size_t     _cap;
+    ColdState* _cold;   // null until needed
+
+    static const size_t   kInlineCap = STATSARRAY_INLINE_CAP;
+    double _inline[kInlineCap];   // _data points here until the first spill
+
+    static const size_t   kAdaptMin = 4096;    // below this FLAT always wins
+    static const size_t   kEvalPeriod = 1024;  // writes between evaluations
+    static const unsigned kConfirm = 2;        // agreeing evaluations before migrating
+    static const size_t   kSamplePairs = 1024; // adjacent pairs sampled to estimate distinct values
 
     /*
       Pre : need >= 1; what is a short label
       Post: throws DatasetEmptyException if size()==0;
             throws InsufficientDataException if size()<need.
     */
-    void requireSize(size_t need, const char* what) const {
-        if (_used == 0) throw DatasetEmptyException("Dataset is empty.");
-        if (_used < need) throw InsufficientDataException(string(what) + " requires at least " + to_string(need) + " value(s).");
+    void requireSize(size_t need, const char* what) const { checkSize(need, what).valueOrThrow(); }
+
+    /*
+      Pre : need >= 1; what is a static label
+      Post: returns EMPTY if size()==0, INSUFFICIENT if size()<need, else ok.
+            Counts one query for the adaptive engine.
+    */
+    StatsResult checkSize(size_t need, const char* what) const {
+        if (_cold && _cold->adapt) ++_cold->adapt->queries;
+        if (_used == 0) return StatsResult::failure(StatsError::EMPTY, what);
+        if (_used < need) return StatsResult::failure(StatsError::INSUFFICIENT, what, need);
+        return StatsResult();
+    }
+
+    /*
+      Pre : size() >= 4
+      Post: returns Excel's bias-corrected kurtosis "term1"; 0 when all values are equal.
+    */
+    long double kurtosisTerm1() const {
+        long double n = static_cast<long double>(_used);
+        long double mu = tryMean().value;
+
+        // sample variance (denominator n-1)
+        long double s2 = 0.0L;
+        scan([&](double x, size_t w) {
+            long double d = x - mu;
+            s2 += (long double)w * (d * d);
+            });
+        long double s = std::sqrt(s2 / (n - 1.0L));
+        if (s == 0.0L) return 0.0L;
+
+        // standardized deviations
+        long double sumZ4 = 0.0L;
+        scan([&](double x, size_t w) {
+            long double z = (x - mu) / s;
+            sumZ4 += (long double)w * (z * z * z * z);
+            });
+
+        // Excel bias-corrected term1
+        return (n * (n + 1.0L)) /
+            ((n - 1.0L) * (n - 2.0L) * (n - 3.0L)) * sumZ4;   // ≈ 14.944851 for {0,9,34,92}
     }
 
     /*
       Pre : none
-      Post: capacity >= 8 and > used when growth occurs; data preserved.
+      Post: capacity >= used + extra; data preserved.
+            A released buffer (_cap == 0) restarts in the inline buffer.
     */
-    void growIfNeeded() {
-        if (_used < _cap) return;
-        size_t newCap = (_cap == 0 ? 8 : _cap * 2);
-        double* nd = new (nothrow) double[newCap]; assert(nd != nullptr);
+    void growIfNeeded(size_t extra = 1) {
+        if (_used + extra <= _cap) return;
+        size_t newCap = (_cap == 0 ? kInlineCap : _cap * 2);
+        if (newCap < _used + extra) newCap = _used + extra;
+        double* nd = allocData(newCap);
         if (_used) memcpy(nd, _data, _used * sizeof(double));
-        delete[] _data; _data = nd; _cap = newCap;
+        freeData(_data); _data = nd; _cap = newCap;
+        statsCount(StatsCounter::REALLOCATIONS);
+    }
+
+    /*
+      Pre : none
+      Post: returns _inline when cap fits inline, else a new heap buffer of cap doubles.
+    */
+    double* allocData(size_t cap) {
+        if (cap <= kInlineCap) return _inline;
+        double* p = new (std::nothrow) double[cap]; assert(p != nullptr);
+        return p;
+    }
+
+    /*
+      Pre : p == _data (null, _inline, borrowed, or from allocData)
+      Post: heap buffer released; a borrowed buffer is let go; inline and
+            null buffers are left alone.
+    */
+    void freeData(double* p) {
+        if (borrowed()) { _cold->borrow.reset(); return; }
+        if (p != _inline) delete[] p;
+    }
+
+    /*
+      Pre : flatLayout()
+      Post: _data is writable: a borrowed buffer is copied into owned memory.
+    */
+    void own() {
+        if (!borrowed()) return;
+        size_t cap = _used > kInlineCap ? _used : kInlineCap;
+        double* nd = allocData(cap);
+        if (_used) memcpy(nd, _data, _used * sizeof(double));
+        _cold->borrow.reset(); _data = nd; _cap = cap;
+        statsCount(StatsCounter::REALLOCATIONS);
     }
 
     /*
@@ -537,7 +1429,7 @@ private:
         assert(pos <= _used);
         growIfNeeded();
         size_t tail = _used - pos;
-        if (tail) memmove(&_data[pos + 1], &_data[pos], tail * sizeof(double));
+        if (tail) { memmove(&_data[pos + 1], &_data[pos], tail * sizeof(double)); statsCount(StatsCounter::MEMMOVE_BYTES, tail * sizeof(double)); }
         _data[pos] = x; ++_used;
     }
 
@@ -550,4 +1442,285 @@ private:
         while (L < R) { size_t M = (L + R) / 2; if (_data[M] < x) L = M + 1; else R = M; }
         return L;
     }
+
+    /*
+      Pre : f(value, weight) callable
+      Post: calls f over every value in ascending order; FLAT passes each value
+            with weight 1, DICTIONARY passes each distinct value with its count,
+            BLOCKS decodes one block at a time.
+    */
+    template <typename F>
+    void scan(F f) const {
+        statsCount(StatsCounter::SCANS);
+        if (flatLayout()) { settle(); for (size_t i = 0; i < _used; ++i) f(_data[i], (size_t)1); }
+        else if (storage() == Storage::DICTIONARY) _cold->dict->forEach(f);
+        else _cold->blocks->forEach(f);
+    }
+
+    /*
+      Pre : f(value, count) callable
+      Post: calls f once per distinct value in ascending order.
+    */
+    template <typename F>
+    void forEachDistinct(F f) const {
+        statsCount(StatsCounter::SCANS);
+        if (flatLayout()) {
+            settle();
+            const double* a = _data;
+            if (_used) forEachRun(a, _used, [&](size_t start, size_t len) { f(a[start], len); });
+        }
+        else if (storage() == Storage::DICTIONARY) _cold->dict->forEach(f);
+        else {
+            bool have = false; double cur = 0.0; size_t c = 0;
+            _cold->blocks->forEach([&](double v, size_t) {
+                if (have && v == cur) { ++c; return; }
+                if (have) f(cur, c);
+                cur = v; c = 1; have = true;
+                });
+            if (have) f(cur, c);
+        }
+    }
+
+    /*
+      Pre : none
+      Post: returns true if values live in _data (FLAT or BUFFERED).
+    */
+    bool flatLayout() const { return !_cold || _cold->store == Storage::FLAT || _cold->store == Storage::BUFFERED; }
+
+    /*
+      Pre : none
+      Post: returns the frequency index, or null if it is not maintained.
+    */
+    FrequencyIndex* freqIndex() const { return _cold ? _cold->freq : nullptr; }
+
+    /*
+      Pre : none
+      Post: returns the cold state, allocating it on first use.
+    */
+    ColdState& cold() { if (!_cold) _cold = new ColdState(); return *_cold; }
+
+    /*
+      Pre : none
+      Post: BUFFERED tail sorted and merged into the sorted prefix; nothing pending.
+    */
+    void settle() const {
+        if (!_cold || !_cold->pending) return;
+        double* mid = _data + (_used - _cold->pending);
+        std::sort(mid, _data + _used);
+        const size_t from = (size_t)(std::upper_bound(_data, mid, *mid) - _data); // values before it stay put
+        std::inplace_merge(_data + from, mid, _data + _used);
+        statsCount(StatsCounter::MERGES);
+        statsCount(StatsCounter::MEMMOVE_BYTES, (_used - from) * sizeof(double));
+        _cold->pending = 0;
+    }
+
+    /*
+      Pre : none
+      Post: values moved to target storage; contents and order unchanged.
+            Non-flat storages are expanded to a sorted buffer first.
+    */
+    void migrate(Storage target) {
+        if (target == storage()) return;
+        ColdState& c = cold();
+        statsCount(StatsCounter::MIGRATIONS);
+        settle();
+        if (!flatLayout()) {
+            size_t newCap = _used > kInlineCap ? _used : kInlineCap, k = 0;
+            double* nd = allocData(newCap);
+            if (c.store == Storage::BLOCKS) c.blocks->copyTo(nd);
+            else c.dict->forEach([&](double v, size_t w) { while (w--) nd[k++] = v; });
+            delete c.dict; c.dict = nullptr; delete c.blocks; c.blocks = nullptr;
+            _data = nd; _cap = newCap;
+            c.store = Storage::FLAT;
+        }
+        if (target == Storage::DICTIONARY) {
+            DictionaryStore* d = new DictionaryStore();
+            if (_used) forEachRun(_data, _used, [&](size_t start, size_t len) { d->add(_data[start], len); });
+            c.dict = d;
+        }
+        else if (target == Storage::BLOCKS) {
+            BlockStore* b = new BlockStore();
+            b->assign(_data, _used);
+            c.blocks = b;
+        }
+        if (!(target == Storage::FLAT || target == Storage::BUFFERED)) { freeData(_data); _data = nullptr; _cap = 0; }
+        c.store = target;
+    }
+
+    /*
+      Pre : a write (insert or erase) just completed
+      Post: op counted; storage re-evaluated every kEvalPeriod writes.
+    */
+    void noteWrite(bool isInsert, size_t k = 1) {
+        if (!_cold || !_cold->adaptive) return;
+        AdaptiveState*& a = _cold->adapt;
+        if (!a) {
+            if (_used < kAdaptMin) return;
+            a = new AdaptiveState();
+            a->inserts = a->erases = a->queries = 0;
+            a->untilEval = kEvalPeriod; a->proposed = _cold->store; a->streak = 0; a->migrations = 0;
+            a->distinct = 0; a->distinctRatio = a->writeFraction = a->range = 0.0;
+            a->integral = false; a->reason = "not sampled yet";
+        }
+        if (isInsert) a->inserts += k; else a->erases += k;
+        if (a->untilEval <= k) evaluateStorage(); else a->untilEval -= k;
+    }
+
+    /*
+      Pre : adaptive state allocated
+      Post: cardinality, range and op mix sampled; storage migrated when the
+            same new target wins kConfirm evaluations in a row.
+    */
+    void evaluateStorage() {
+        AdaptiveState& st = *_cold->adapt;
+        const Storage cur = _cold->store;
+        st.untilEval = kEvalPeriod;
+        size_t writes = st.inserts + st.erases, ops = writes + st.queries;
+        st.writeFraction = ops ? (double)writes / (double)ops : 0.0;
+        st.inserts = st.erases = st.queries = 0;
+
+        // shape of the data (merging a BUFFERED tail costs about the same as the run count)
+        // a BUFFERED tail is not merged here (that would undo the buffering); the sorted prefix is the sample
+        const size_t n = flatLayout() ? _used - _cold->pending : _used;
+        auto sample = [&](size_t i) { return flatLayout() ? _data[i] : at(i); };
+        st.distinct = 0; st.range = 0.0; st.integral = true;
+        if (n) {
+            if (cur == Storage::DICTIONARY) st.distinct = _cold->dict->distinct();
+            else if (cur == Storage::BLOCKS) forEachDistinct([&](double, size_t) { ++st.distinct; });
+            else st.distinct = n <= 64 * kSamplePairs ? countRuns(_data, n) : estimateRuns(_data, n);
+            st.range = sample(n - 1) - sample(0);
+            for (size_t k = 0; k < 64 && st.integral; ++k) {
+                double v = sample(n > 1 ? k * (n - 1) / 63 : 0);
+                if (v != std::floor(v)) st.integral = false;
+            }
+        }
+        st.distinctRatio = n ? (double)st.distinct / (double)n : 1.0;
+
+        // thresholds are wider for leaving a storage than for entering it (hysteresis)
+        Storage want;
+        const bool inDict = cur == Storage::DICTIONARY, inBuf = cur == Storage::BUFFERED;
+        if (_used < kAdaptMin) { want = Storage::FLAT; st.reason = "small dataset: flat sorted array"; }
+        else if (st.distinctRatio <= (inDict ? 0.25 : 1.0 / 16)) { want = Storage::DICTIONARY; st.reason = "heavy duplicates: dictionary of run counts"; }
+        else if (st.integral && st.range <= 65535.0 && st.distinctRatio <= (inDict ? 0.5 : 0.25)) { want = Storage::DICTIONARY; st.reason = "bounded integers: dictionary counting"; }
+        else if (st.writeFraction >= (inBuf ? 0.6 : 0.9)) { want = Storage::BUFFERED; st.reason = "write-heavy: buffered inserts, merged on read"; }
+        else { want = Storage::FLAT; st.reason = "read-mostly: flat sorted array"; }
+
+        if (want == cur) { st.proposed = want; st.streak = 0; return; }
+        if (want != st.proposed) { st.proposed = want; st.streak = 1; }
+        else ++st.streak;
+        if (st.streak >= kConfirm) { migrate(want); ++st.migrations; st.streak = 0; }
+    }
+
+    /*
+      Pre : m != 0
+      Post: returns index of the lowest set bit of m.
+    */
+    static unsigned lowBit(unsigned m) {
+#ifdef _MSC_VER
+        unsigned long i; _BitScanForward(&i, m); return (unsigned)i;
+#else
+        return (unsigned)__builtin_ctz(m);
+#endif
+    }
+
+    /*
+      Pre : m < 16 (a lane mask)
+      Post: returns number of set bits in m.
+    */
+    static unsigned popCount4(unsigned m) {
+        static const unsigned char bits[16] = { 0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4 };
+        return bits[m & 15u];
+    }
+
+    /*
+      Pre : a ascending; n >= 1
+      Post: returns the number of runs of equal values (boundary count + 1).
+    */
+    static size_t countRuns(const double* a, size_t n) {
+        size_t runs = 1, i = 0;
+#if defined(STATSARRAY_SIMD_AVX)
+        for (; i + 4 < n; i += 4)
+            runs += popCount4((unsigned)_mm256_movemask_pd(
+                _mm256_cmp_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(a + i + 1), _CMP_NEQ_UQ)));
+#elif defined(STATSARRAY_SIMD_SSE2)
+        for (; i + 2 < n; i += 2)
+            runs += popCount4((unsigned)_mm_movemask_pd(_mm_cmpneq_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(a + i + 1))));
+#endif
+        for (; i + 1 < n; ++i) runs += (a[i] != a[i + 1]);
+        return runs;
+    }
+
+    /*
+      Pre : a ascending; n >= 2
+      Post: returns the run count estimated from kSamplePairs evenly spaced
+            adjacent pairs, so a large (possibly mapped) buffer is touched
+            in at most that many places.
+    */
+    static size_t estimateRuns(const double* a, size_t n) {
+        size_t boundaries = 0;
+        for (size_t k = 0; k < kSamplePairs; ++k) {
+            const size_t i = (2 * k + 1) * (n - 1) / (2 * kSamplePairs);
+            boundaries += a[i] != a[i + 1];
+        }
+        return 1 + (size_t)((double)boundaries * (double)(n - 1) / (double)kSamplePairs);
+    }
+
+    /*
+      Pre : a ascending; n >= 1; f(start, len) callable
+      Post: calls f once per run of equal values, in ascending order.
+            Boundaries are found lane-wise (a[i] != a[i+1]) and walked off the movemask.
+    */
+    template <typename F>
+    static void forEachRun(const double* a, size_t n, F f) {
+        size_t start = 0, i = 0;
+#if defined(STATSARRAY_SIMD_AVX)
+        for (; i + 4 < n; i += 4) {
+            unsigned m = (unsigned)_mm256_movemask_pd(
+                _mm256_cmp_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(a + i + 1), _CMP_NEQ_UQ));
+            while (m) { size_t b = i + lowBit(m) + 1; f(start, b - start); start = b; m &= m - 1; }
+        }
+#elif defined(STATSARRAY_SIMD_SSE2)
+        for (; i + 2 < n; i += 2) {
+            unsigned m = (unsigned)_mm_movemask_pd(_mm_cmpneq_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(a + i + 1)));
+            while (m) { size_t b = i + lowBit(m) + 1; f(start, b - start); start = b; m &= m - 1; }
+        }
+#endif
+        for (; i + 1 < n; ++i) if (a[i] != a[i + 1]) { f(start, i + 1 - start); start = i + 1; }
+        f(start, n - start);
+    }
+
+    /*
+      Pre : f(index) callable
+      Post: calls f for each i in [0, n) where a[i] is NaN or +/-Inf, ascending.
+            Lanes are classified as !(|x| < Inf) and walked off the movemask.
+    */
+    template <typename F>
+    static void forEachNonFinite(const double* a, size_t n, F f) {
+        size_t i = 0;
+#if defined(STATSARRAY_SIMD_AVX)
+        const __m256d sign = _mm256_set1_pd(-0.0), inf = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+        for (; i + 4 <= n; i += 4) {
+            unsigned m = (unsigned)_mm256_movemask_pd(
+                _mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_loadu_pd(a + i)), inf, _CMP_NLT_UQ));
+            while (m) { f(i + lowBit(m)); m &= m - 1; }
+        }
+#elif defined(STATSARRAY_SIMD_SSE2)
+        const __m128d sign = _mm_set1_pd(-0.0), inf = _mm_set1_pd(std::numeric_limits<double>::infinity());
+        for (; i + 2 <= n; i += 2) {
+            unsigned m = (unsigned)_mm_movemask_pd(_mm_cmpnlt_pd(_mm_andnot_pd(sign, _mm_loadu_pd(a + i)), inf));
+            while (m) { f(i + lowBit(m)); m &= m - 1; }
+        }
+#endif
+        for (; i < n; ++i) if (!std::isfinite(a[i])) f(i);
+    }
+
+    /*
+      Pre : none
+      Post: returns first index i where _data[i] > x in [0..used].
+    */
+    size_t upperBound(double x) const {
+        size_t L = 0, R = _used;
+        while (L < R) { size_t M = (L + R) / 2; if (!(x < _data[M])) L = M + 1; else R = M; }
+        return L;
+    }
 };
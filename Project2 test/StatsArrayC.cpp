@@ -0,0 +1,157 @@
+/*
+    Program: StatsArrayC - C ABI implementation (see StatsArrayC.h)
+
+    Description:
+      - Each entry point validates its pointers, forwards to the try*()
+        forms of StatsArray and turns any exception into a status code,
+        so nothing C++ unwinds through a C caller.
+*/
+
+#ifndef STATSARRAY_C_BUILD
+#define STATSARRAY_C_BUILD
+#endif
+#include "StatsArrayC.h"
+#include "StatsArray.h"
+
+#include <cstring>    // memcpy
+#include <limits>
+#include <new>        // bad_alloc, nothrow
+
+struct statsarray {
+    StatsArray arr;
+};
+
+static_assert(STATSARRAY_STAT_COUNT == (int)Statistic::COUNT && STATSARRAY_STAT_PERCENTILE == (int)Statistic::PERCENTILE,
+              "statsarray_stat must match Statistic");
+static_assert(STATSARRAY_EMPTY == (int)StatsError::EMPTY && STATSARRAY_UNDEFINED == (int)StatsError::UNDEFINED,
+              "statsarray_status must mirror StatsError");
+
+namespace {
+
+const double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+template <class F>
+int32_t guarded(F f) {
+    try { return f(); }
+    catch (const std::bad_alloc&) { return STATSARRAY_OUT_OF_MEMORY; }
+    catch (...) { return STATSARRAY_INTERNAL; }
+}
+
+int32_t statusOf(const StatsResult& r) { return (int32_t)r.error; }
+
+double valueOf(const StatsResult& r) { return r.ok() ? r.value : kNaN; }
+
+bool validStat(int32_t s) { return s >= STATSARRAY_STAT_COUNT && s <= STATSARRAY_STAT_PERCENTILE; }
+
+} // namespace
+
+extern "C" {
+
+uint32_t statsarray_abi_version(void) { return STATSARRAY_ABI_VERSION; }
+
+const char* statsarray_status_string(int32_t status) {
+    switch (status) {
+    case STATSARRAY_OK:               return "ok";
+    case STATSARRAY_EMPTY:            return "dataset is empty";
+    case STATSARRAY_INSUFFICIENT:     return "not enough values";
+    case STATSARRAY_UNDEFINED:        return "statistic undefined for this data";
+    case STATSARRAY_INVALID_ARGUMENT: return "invalid argument";
+    case STATSARRAY_OUT_OF_MEMORY:    return "out of memory";
+    case STATSARRAY_REJECTED:         return "batch rejected: NaN or Inf present";
+    case STATSARRAY_BUFFER_TOO_SMALL: return "buffer too small";
+    case STATSARRAY_INTERNAL:         return "internal error";
+    }
+    return "unknown status";
+}
+
+statsarray* statsarray_create(void) {
+    try { return new (std::nothrow) statsarray(); }
+    catch (...) { return nullptr; }
+}
+
+void statsarray_free(statsarray* a) { delete a; }
+
+int32_t statsarray_insert_batch(statsarray* a, const double* values, size_t n, int32_t policy, statsarray_ingest* report) {
+    if (!a || (!values && n) || policy < STATSARRAY_REJECT || policy > STATSARRAY_CLAMP) return STATSARRAY_INVALID_ARGUMENT;
+    return guarded([&]() -> int32_t {
+        IngestReport r = n ? a->arr.insertBulk(values, n, (IngestPolicy)policy) : IngestReport();
+        if (report) {
+            report->inserted = r.inserted; report->nan = r.nan; report->pos_inf = r.posInf;
+            report->neg_inf = r.negInf; report->clamped = r.clamped;
+            report->rejected = r.rejected ? 1 : 0; report->reserved = 0;
+        }
+        return r.rejected ? STATSARRAY_REJECTED : STATSARRAY_OK;
+    });
+}
+
+int32_t statsarray_clear(statsarray* a) {
+    if (!a) return STATSARRAY_INVALID_ARGUMENT;
+    return guarded([&]() -> int32_t { a->arr.clear(); return STATSARRAY_OK; });
+}
+
+uint64_t statsarray_size(const statsarray* a) { return a ? (uint64_t)a->arr.size() : 0; }
+
+int32_t statsarray_query(const statsarray* a, int32_t stat, int32_t sample, double arg, double* out) {
+    if (!a || !out || !validStat(stat)) return STATSARRAY_INVALID_ARGUMENT;
+    return guarded([&]() -> int32_t {
+        StatsResult r = a->arr.tryStatistic((Statistic)stat, sample != 0, arg);
+        *out = valueOf(r);
+        return statusOf(r);
+    });
+}
+
+int32_t statsarray_query_batch(const statsarray* a, const statsarray_request* queries, statsarray_result* results, size_t n) {
+    if (!a || (n && (!queries || !results))) return STATSARRAY_INVALID_ARGUMENT;
+    return guarded([&]() -> int32_t {
+        for (size_t i = 0; i < n; ++i) {
+            statsarray_result& out = results[i];
+            out.reserved = 0;
+            if (!validStat(queries[i].stat)) { out.value = kNaN; out.status = STATSARRAY_INVALID_ARGUMENT; continue; }
+            StatsResult r = a->arr.tryStatistic((Statistic)queries[i].stat, queries[i].sample != 0, queries[i].arg);
+            out.value = valueOf(r); out.status = statusOf(r);
+        }
+        return STATSARRAY_OK;
+    });
+}
+
+int32_t statsarray_percentiles(const statsarray* a, const double* ps, double* out, size_t n) {
+    if (!a || (n && (!ps || !out))) return STATSARRAY_INVALID_ARGUMENT;
+    for (size_t i = 0; i < n; ++i) if (!(ps[i] >= 0.0 && ps[i] <= 100.0)) return STATSARRAY_INVALID_ARGUMENT;
+    return guarded([&]() -> int32_t {
+        if (n && a->arr.size() == 0) return STATSARRAY_EMPTY;
+        for (size_t i = 0; i < n; ++i) out[i] = a->arr.tryPercentile(ps[i]).value;
+        return STATSARRAY_OK;
+    });
+}
+
+int32_t statsarray_summarize(const statsarray* a, int32_t sample, statsarray_summary* out) {
+    if (!a || !out || out->size < sizeof(uint64_t) * 2) return STATSARRAY_INVALID_ARGUMENT;
+    return guarded([&]() -> int32_t {
+        statsarray_summary s;
+        s.size = out->size < sizeof s ? out->size : (uint32_t)sizeof s;
+        s.reserved = 0;
+        const StatsArray& arr = a->arr;
+        s.count = arr.size();
+        s.min = valueOf(arr.tryMin()); s.max = valueOf(arr.tryMax());
+        s.sum = valueOf(arr.trySum()); s.mean = valueOf(arr.tryMean()); s.median = valueOf(arr.tryMedian());
+        s.variance = valueOf(arr.tryVariance(sample != 0)); s.stdev = valueOf(arr.tryStdev(sample != 0));
+        s.q1 = s.q3 = kNaN;
+        StatsResultOf<std::tuple<double, double, double>> q = arr.tryQuartiles();
+        if (q.ok()) { s.q1 = std::get<0>(q.value); s.q3 = std::get<2>(q.value); }
+        memcpy(out, &s, s.size);   // a caller built against an older, shorter struct gets its prefix
+        return s.count ? STATSARRAY_OK : STATSARRAY_EMPTY;
+    });
+}
+
+int32_t statsarray_copy_values(const statsarray* a, double* out, size_t capacity, uint64_t* count) {
+    if (!a || !count || (capacity && !out)) return STATSARRAY_INVALID_ARGUMENT;
+    return guarded([&]() -> int32_t {
+        const size_t n = a->arr.size();
+        *count = n;
+        if (n > capacity) return STATSARRAY_BUFFER_TOO_SMALL;
+        if (n) a->arr.copyTo(out);
+        return STATSARRAY_OK;
+    });
+}
+
+} // extern "C"
@@ -0,0 +1,210 @@
+#ifndef STATSARRAY_C_H
+#define STATSARRAY_C_H
+/*
+    Program: StatsArrayC - C ABI for embedding StatsArray
+
+    Description:
+      - Opaque handle plus plain functions, usable from C and from any
+        language with a C FFI. No C++ type, exception or allocator crosses
+        the boundary: every call returns a status code, batch calls read
+        caller-owned contiguous arrays and write caller-provided results.
+      - Built by StatsArrayLib.vcxproj as a DLL (STATSARRAY_C_BUILD exports
+        the symbols); define STATSARRAY_C_STATIC on both sides to link it
+        as a static library (msbuild /p:ConfigurationType=StaticLibrary).
+      - Stable ABI: functions and enum values are only ever added. Structs
+        that may grow (statsarray_summary) start with a size field the
+        caller sets, and the library fills only what fits.
+      - A handle is used by one thread at a time; separate handles are
+        independent.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(STATSARRAY_C_STATIC)
+#define STATSARRAY_API
+#elif defined(_WIN32)
+#if defined(STATSARRAY_C_BUILD)
+#define STATSARRAY_API __declspec(dllexport)
+#else
+#define STATSARRAY_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define STATSARRAY_API __attribute__((visibility("default")))
+#else
+#define STATSARRAY_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STATSARRAY_ABI_VERSION 1
+
+typedef struct statsarray statsarray;
+
+/* 1..3 mirror StatsError */
+typedef enum statsarray_status {
+    STATSARRAY_OK               = 0,
+    STATSARRAY_EMPTY            = 1,    /* dataset has no values */
+    STATSARRAY_INSUFFICIENT     = 2,    /* too few values for the statistic */
+    STATSARRAY_UNDEFINED        = 3,    /* e.g. zero mean, percentile outside 0..100 */
+    STATSARRAY_INVALID_ARGUMENT = 16,
+    STATSARRAY_OUT_OF_MEMORY    = 17,
+    STATSARRAY_REJECTED         = 18,   /* STATSARRAY_REJECT batch held NaN/Inf */
+    STATSARRAY_BUFFER_TOO_SMALL = 19,
+    STATSARRAY_INTERNAL         = 20
+} statsarray_status;
+
+/* what insert_batch does with NaN and +/-Inf (IngestPolicy) */
+typedef enum statsarray_policy {
+    STATSARRAY_REJECT = 0,   /* insert nothing if the batch holds any */
+    STATSARRAY_SKIP   = 1,   /* drop them, insert the rest */
+    STATSARRAY_CLAMP  = 2    /* store +/-Inf as the finite extremes; drop NaN */
+} statsarray_policy;
+
+/* same numbering as Statistic and the StatsServer protocol */
+typedef enum statsarray_stat {
+    STATSARRAY_STAT_COUNT = 1,
+    STATSARRAY_STAT_MIN,
+    STATSARRAY_STAT_MAX,
+    STATSARRAY_STAT_RANGE,
+    STATSARRAY_STAT_SUM,
+    STATSARRAY_STAT_MEAN,
+    STATSARRAY_STAT_MEDIAN,
+    STATSARRAY_STAT_VARIANCE,
+    STATSARRAY_STAT_STDEV,
+    STATSARRAY_STAT_MIDRANGE,
+    STATSARRAY_STAT_IQR,
+    STATSARRAY_STAT_SUM_SQUARES,
+    STATSARRAY_STAT_MEAN_ABS_DEVIATION,
+    STATSARRAY_STAT_RMS,
+    STATSARRAY_STAT_SEM,
+    STATSARRAY_STAT_SKEWNESS,
+    STATSARRAY_STAT_KURTOSIS,
+    STATSARRAY_STAT_KURTOSIS_EXCESS,
+    STATSARRAY_STAT_COEFF_VARIATION,
+    STATSARRAY_STAT_RSD,
+    STATSARRAY_STAT_PERCENTILE
+} statsarray_stat;
+
+/* outcome of one insert_batch call (IngestReport) */
+typedef struct statsarray_ingest {
+    uint64_t inserted;   /* values stored, clamped ones included */
+    uint64_t nan;
+    uint64_t pos_inf;
+    uint64_t neg_inf;
+    uint64_t clamped;
+    int32_t  rejected;   /* nonzero if a REJECT batch was refused */
+    int32_t  reserved;
+} statsarray_ingest;
+
+/* one entry of a query_batch call */
+typedef struct statsarray_request {
+    int32_t stat;     /* statsarray_stat */
+    int32_t sample;   /* nonzero: n-1 forms of VARIANCE, STDEV, SEM, SKEWNESS, ... */
+    double  arg;      /* PERCENTILE: 0..100 */
+} statsarray_request;
+
+typedef struct statsarray_result {
+    double  value;    /* NaN unless status is STATSARRAY_OK */
+    int32_t status;   /* statsarray_status */
+    int32_t reserved;
+} statsarray_result;
+
+/*
+  Set size = sizeof(statsarray_summary) before the call. Fields that need
+  more values than the dataset holds are NaN.
+*/
+typedef struct statsarray_summary {
+    uint32_t size;
+    uint32_t reserved;
+    uint64_t count;
+    double   min, max, sum, mean, median;
+    double   variance, stdev;   /* sample (n-1) or population, as requested */
+    double   q1, q3;
+} statsarray_summary;
+
+/*
+  Pre : none
+  Post: returns STATSARRAY_ABI_VERSION of the library actually loaded.
+*/
+STATSARRAY_API uint32_t statsarray_abi_version(void);
+
+/*
+  Pre : none
+  Post: returns a static English description of status.
+*/
+STATSARRAY_API const char* statsarray_status_string(int32_t status);
+
+/*
+  Pre : none
+  Post: returns a new empty dataset, or NULL if out of memory.
+*/
+STATSARRAY_API statsarray* statsarray_create(void);
+
+/*
+  Pre : a was returned by statsarray_create (NULL is ignored)
+  Post: a and everything it holds released.
+*/
+STATSARRAY_API void statsarray_free(statsarray* a);
+
+/*
+  Pre : values holds n doubles (may be NULL when n == 0); report may be NULL
+  Post: the batch inserted under policy; report, if given, filled.
+        Returns STATSARRAY_REJECTED if a REJECT batch was refused.
+*/
+STATSARRAY_API int32_t statsarray_insert_batch(statsarray* a, const double* values, size_t n,
+                                               int32_t policy, statsarray_ingest* report);
+
+/*
+  Pre : none
+  Post: every value removed.
+*/
+STATSARRAY_API int32_t statsarray_clear(statsarray* a);
+
+/*
+  Pre : none
+  Post: returns the number of values (0 for NULL).
+*/
+STATSARRAY_API uint64_t statsarray_size(const statsarray* a);
+
+/*
+  Pre : out is writable
+  Post: *out set to statistic stat; returns its status.
+*/
+STATSARRAY_API int32_t statsarray_query(const statsarray* a, int32_t stat, int32_t sample, double arg, double* out);
+
+/*
+  Pre : queries and results hold n entries each
+  Post: results[i] answers queries[i]. Returns STATSARRAY_OK when the
+        batch was evaluated; per-query outcomes are in results[i].status.
+*/
+STATSARRAY_API int32_t statsarray_query_batch(const statsarray* a, const statsarray_request* queries,
+                                              statsarray_result* results, size_t n);
+
+/*
+  Pre : ps and out hold n entries each; every ps[i] in 0..100
+  Post: out[i] = percentile ps[i] (linear interpolation between ranks).
+*/
+STATSARRAY_API int32_t statsarray_percentiles(const statsarray* a, const double* ps, double* out, size_t n);
+
+/*
+  Pre : out->size set by the caller
+  Post: summary filled; STATSARRAY_EMPTY (count 0, the rest NaN) if the
+        dataset is empty.
+*/
+STATSARRAY_API int32_t statsarray_summarize(const statsarray* a, int32_t sample, statsarray_summary* out);
+
+/*
+  Pre : out holds capacity doubles (may be NULL when capacity == 0)
+  Post: *count = size; the values, ascending, copied to out if they fit,
+        else STATSARRAY_BUFFER_TOO_SMALL and out untouched.
+*/
+STATSARRAY_API int32_t statsarray_copy_values(const statsarray* a, double* out, size_t capacity, uint64_t* count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
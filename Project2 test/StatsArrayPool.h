@@ -0,0 +1,317 @@
+#pragma once
+/*
+    Program: StatsArrayPool - many small sorted datasets in shared slab arenas
+
+    Description:
+      - Each dataset is named by a 32-bit handle and costs a 12-byte entry;
+        there is no per-dataset object or heap allocation.
+      - Values live in power-of-two size classes (4, 8, 16, ... doubles).
+        Each class carries its blocks in fixed 64 KiB slabs with a free list;
+        a full dataset moves to a block of the next class.
+      - Values in a dataset are kept in ASCENDING order, like StatsArray.
+      - Bulk queries (computeAll, percentileAll) walk the slabs in memory
+        order, split across threads by slab.
+      - Not thread-safe for concurrent modification; bulk queries are
+        read-only and may run while no other thread modifies the pool.
+*/
+
+#include <cassert>
+#include <cstddef>    // size_t
+#include <cstdint>    // uint32_t, uint8_t
+#include <cstring>    // memcpy, memmove
+#include <cmath>      // isfinite, floor
+#include <limits>     // numeric_limits
+#include <memory>     // unique_ptr
+#include <vector>
+#include <atomic>
+#include <thread>
+#include "StatsArray.h"   // DatasetEmptyException
+
+typedef uint32_t StatsHandle;
+
+class StatsArrayPool {
+public:
+    static const StatsHandle kInvalidHandle = 0xFFFFFFFFu;
+
+    StatsArrayPool() : _live(0), _freeHandle(kInvalidHandle) {}
+
+    // Slabs are owned through unique_ptr; copying a pool is not supported.
+    StatsArrayPool(const StatsArrayPool&) = delete;
+    StatsArrayPool& operator=(const StatsArrayPool&) = delete;
+
+    // ============================== Datasets ==============================
+
+    /*
+      Pre : fewer than 2^32 - 1 handles in use
+      Post: returns handle of a new empty dataset; no storage used until first insert.
+    */
+    StatsHandle create() {
+        StatsHandle h;
+        if (_freeHandle != kInvalidHandle) { h = _freeHandle; _freeHandle = _entries[h].block; }
+        else { assert(_entries.size() < kInvalidHandle); h = (StatsHandle)_entries.size(); _entries.push_back(Entry()); }
+        _entries[h] = Entry(); _entries[h].cls = kEmpty;
+        ++_live;
+        return h;
+    }
+
+    /*
+      Pre : valid(h)
+      Post: dataset released; its block returns to the free list and h may be reused.
+    */
+    void release(StatsHandle h) {
+        assert(valid(h));
+        Entry& e = _entries[h];
+        if (e.cls != kEmpty) freeBlock(e.cls, e.block);
+        e.cls = kReleased; e.used = 0; e.block = _freeHandle; _freeHandle = h;
+        --_live;
+    }
+
+    /*
+      Pre : none
+      Post: returns true if h names a live dataset.
+    */
+    bool valid(StatsHandle h) const { return h < _entries.size() && _entries[h].cls != kReleased; }
+
+    /*
+      Pre : none
+      Post: returns number of live datasets.
+    */
+    size_t datasets() const { return _live; }
+
+    /*
+      Pre : none
+      Post: returns one past the highest handle ever issued (size of computeAll results).
+    */
+    size_t handleLimit() const { return _entries.size(); }
+
+    // ============================== Modifiers =============================
+
+    /*
+      Pre : valid(h); x is finite
+      Post: x inserted into dataset h, ascending order kept.
+    */
+    void insert(StatsHandle h, double x) {
+        assert(valid(h)); assert(std::isfinite(x));
+        Entry& e = _entries[h];
+        if (e.cls == kEmpty) { e.cls = 0; e.block = allocBlock(0, h); }
+        else if (e.used == capacityOf(e.cls)) {
+            assert((size_t)e.cls + 1 < kClasses);
+            uint32_t nb = allocBlock(e.cls + 1, h);
+            memcpy(blockData(e.cls + 1, nb), blockData(e.cls, e.block), e.used * sizeof(double));
+            freeBlock(e.cls, e.block);
+            e.cls = (uint8_t)(e.cls + 1); e.block = nb;
+        }
+        double* a = blockData(e.cls, e.block);
+        size_t pos = upperBound(a, e.used, x);
+        if (e.used > pos) memmove(a + pos + 1, a + pos, (e.used - pos) * sizeof(double));
+        a[pos] = x; ++e.used;
+    }
+
+    /*
+      Pre : valid(h); count >= 1
+      Post: removes up to 'count' occurrences of v from dataset h; returns number removed.
+            The dataset keeps its block (no shrinking).
+    */
+    size_t eraseValue(StatsHandle h, double v, size_t count = 1) {
+        assert(valid(h)); assert(count >= 1);
+        Entry& e = _entries[h];
+        if (e.used == 0) return 0;
+        double* a = blockData(e.cls, e.block);
+        size_t pos = lowerBound(a, e.used, v), end = pos;
+        while (end < e.used && a[end] == v && end - pos < count) ++end;
+        memmove(a + pos, a + end, (e.used - end) * sizeof(double));
+        e.used -= (uint32_t)(end - pos);
+        return end - pos;
+    }
+
+    /*
+      Pre : valid(h); idx < size(h)
+      Post: value at idx of dataset h removed; order preserved.
+    */
+    void eraseAt(StatsHandle h, size_t idx) {
+        assert(valid(h)); assert(idx < _entries[h].used);
+        Entry& e = _entries[h];
+        double* a = blockData(e.cls, e.block);
+        memmove(a + idx, a + idx + 1, (e.used - idx - 1) * sizeof(double));
+        --e.used;
+    }
+
+    // ============================== Accessors =============================
+
+    /*
+      Pre : valid(h)
+      Post: returns number of values in dataset h.
+    */
+    size_t size(StatsHandle h) const { assert(valid(h)); return _entries[h].used; }
+
+    /*
+      Pre : valid(h); idx < size(h)
+      Post: returns value at idx of dataset h.
+    */
+    double at(StatsHandle h, size_t idx) const {
+        assert(valid(h)); assert(idx < _entries[h].used);
+        return blockData(_entries[h].cls, _entries[h].block)[idx];
+    }
+
+    /*
+      Pre : valid(h)
+      Post: returns the sorted values of dataset h (null if empty); invalidated by insert.
+    */
+    const double* data(StatsHandle h) const {
+        assert(valid(h));
+        const Entry& e = _entries[h];
+        return e.cls == kEmpty ? nullptr : blockData(e.cls, e.block);
+    }
+
+    /*
+      Pre : none
+      Post: returns heap bytes held by slabs, entries and free lists.
+    */
+    size_t memoryBytes() const {
+        size_t b = _entries.capacity() * sizeof(Entry);
+        for (size_t c = 0; c < kClasses; ++c) {
+            b += _classes[c].slabs.size() * slabDoubles(c) * sizeof(double);
+            b += _classes[c].owner.capacity() * sizeof(StatsHandle) + _classes[c].freeBlocks.capacity() * sizeof(uint32_t);
+        }
+        return b;
+    }
+
+    // ============================== Bulk queries ==========================
+
+    /*
+      Pre : f(const double* sorted, size_t n) -> double is safe to call from several threads
+      Post: returns r with r[h] = f(values of h) for every dataset with size(h) >= 1;
+            r[h] is NaN for empty or released handles. r.size() == handleLimit().
+            Slabs are visited in memory order, shared among `threads` threads
+            (0 = hardware concurrency).
+    */
+    template <typename F>
+    std::vector<double> computeAll(F f, unsigned threads = 0) const {
+        std::vector<double> res(_entries.size(), std::numeric_limits<double>::quiet_NaN());
+        // one work item per slab, smallest class first
+        std::vector<std::pair<uint8_t, uint32_t>> work;
+        for (size_t c = 0; c < kClasses; ++c)
+            for (size_t s = 0; s < _classes[c].slabs.size(); ++s) work.push_back(std::make_pair((uint8_t)c, (uint32_t)s));
+        if (threads == 0) threads = std::thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+        if (threads > work.size()) threads = (unsigned)work.size();
+
+        std::atomic<size_t> next(0);
+        auto run = [&]() {
+            for (size_t w; (w = next.fetch_add(1)) < work.size(); ) {
+                const SizeClass& sc = _classes[work[w].first];
+                const size_t cap = capacityOf(work[w].first), per = slabDoubles(work[w].first) / cap;
+                const double* slab = sc.slabs[work[w].second].get();
+                const size_t first = (size_t)work[w].second * per;
+                for (size_t b = first; b < first + per && b < sc.owner.size(); ++b, slab += cap) {
+                    StatsHandle h = sc.owner[b];
+                    if (h != kInvalidHandle && _entries[h].used) res[h] = f(slab, (size_t)_entries[h].used);
+                }
+            }
+        };
+        if (threads <= 1) run();
+        else {
+            std::vector<std::thread> pool;
+            for (unsigned t = 1; t < threads; ++t) pool.emplace_back(run);
+            run();
+            for (std::thread& t : pool) t.join();
+        }
+        return res;
+    }
+
+    /*
+      Pre : 0 <= p <= 100
+      Post: returns the p-th percentile of every dataset (see percentile()),
+            indexed by handle; NaN where a dataset is empty.
+    */
+    std::vector<double> percentileAll(double p, unsigned threads = 0) const {
+        assert(p >= 0.0 && p <= 100.0);
+        return computeAll([p](const double* a, size_t n) { return percentileOf(a, n, p); }, threads);
+    }
+
+    /*
+      Pre : valid(h); 0 <= p <= 100
+      Post: returns the p-th percentile of dataset h, interpolating linearly
+            between the closest ranks; throws DatasetEmptyException if empty.
+    */
+    double percentile(StatsHandle h, double p) const {
+        assert(valid(h)); assert(p >= 0.0 && p <= 100.0);
+        if (_entries[h].used == 0) throw DatasetEmptyException("Dataset is empty.");
+        return percentileOf(data(h), _entries[h].used, p);
+    }
+
+private:
+    struct Entry {
+        uint32_t block;   // block index in class cls; next free handle once released
+        uint32_t used;
+        uint8_t  cls;     // size class, or kEmpty / kReleased
+        Entry() : block(0), used(0), cls(0) {}
+    };
+
+    struct SizeClass {
+        std::vector<std::unique_ptr<double[]>> slabs;
+        std::vector<StatsHandle>               owner;       // owner[b] = handle using block b, or kInvalidHandle
+        std::vector<uint32_t>                  freeBlocks;
+    };
+
+    static const size_t  kClasses = 22;        // 4 .. 4 << 21 (8M) doubles
+    static const size_t  kMinBlock = 4;
+    static const size_t  kSlabDoubles = 8192;  // 64 KiB per slab
+    static const uint8_t kEmpty = 0xFE;
+    static const uint8_t kReleased = 0xFF;
+
+    std::vector<Entry> _entries;
+    SizeClass          _classes[kClasses];
+    size_t             _live;
+    StatsHandle        _freeHandle;   // head of the released-handle list
+
+    static size_t capacityOf(size_t cls) { return kMinBlock << cls; }
+
+    // blocks per slab; classes above the slab size get one block per "slab"
+    static size_t slabDoubles(size_t cls) { size_t c = capacityOf(cls); return c > kSlabDoubles ? c : kSlabDoubles; }
+
+    double* blockData(size_t cls, uint32_t b) const {
+        const size_t cap = capacityOf(cls), per = slabDoubles(cls) / cap;
+        return _classes[cls].slabs[b / per].get() + (b % per) * cap;
+    }
+
+    /*
+      Pre : cls < kClasses
+      Post: returns a free block of class cls owned by h; grows by one slab if needed.
+    */
+    uint32_t allocBlock(size_t cls, StatsHandle h) {
+        SizeClass& sc = _classes[cls];
+        uint32_t b;
+        if (!sc.freeBlocks.empty()) { b = sc.freeBlocks.back(); sc.freeBlocks.pop_back(); sc.owner[b] = h; }
+        else {
+            const size_t per = slabDoubles(cls) / capacityOf(cls);
+            if (sc.owner.size() == sc.slabs.size() * per) sc.slabs.emplace_back(new double[slabDoubles(cls)]);
+            b = (uint32_t)sc.owner.size(); sc.owner.push_back(h);
+        }
+        return b;
+    }
+
+    void freeBlock(size_t cls, uint32_t b) {
+        _classes[cls].owner[b] = kInvalidHandle;
+        _classes[cls].freeBlocks.push_back(b);
+    }
+
+    static size_t lowerBound(const double* a, size_t n, double x) {
+        size_t L = 0, R = n;
+        while (L < R) { size_t M = (L + R) / 2; if (a[M] < x) L = M + 1; else R = M; }
+        return L;
+    }
+
+    static size_t upperBound(const double* a, size_t n, double x) {
+        size_t L = 0, R = n;
+        while (L < R) { size_t M = (L + R) / 2; if (!(x < a[M])) L = M + 1; else R = M; }
+        return L;
+    }
+
+    static double percentileOf(const double* a, size_t n, double p) {
+        const double r = (p / 100.0) * (double)(n - 1);
+        const size_t lo = (size_t)std::floor(r);
+        if (lo + 1 >= n) return a[n - 1];
+        return a[lo] + (r - (double)lo) * (a[lo + 1] - a[lo]);
+    }
+};
@@ -0,0 +1,278 @@
+#pragma once
+/*
+    Program: StatsMetrics - process-wide performance counters
+
+    Description:
+      - Counters (inserts, memmove bytes, reallocations, scans, ...) and
+        per-operation latency histograms, kept in one shard per thread.
+        A thread only ever writes its own shard (plain load + store on a
+        relaxed atomic, no locked instruction), so counting never contends.
+      - render() sums the shards for a scrape and writes the Prometheus text
+        exposition format (version 0.0.4). Gauges (dataset sizes, memory)
+        are set by their owner and copied under a mutex only the owner and
+        the scraper take.
+      - A finished thread's shard is folded into a retired total and freed,
+        so totals never go backwards and short-lived worker threads (one
+        set per file load) do not pile up shards.
+      - Build with STATSARRAY_NO_METRICS to compile every count out.
+*/
+
+#include <cstddef>    // size_t
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>     // unique_ptr
+#include <mutex>
+#include <string>
+#include <utility>    // pair
+#include <vector>
+#include <cstdio>     // snprintf, FILE
+#if defined(__linux__)
+#include <unistd.h>   // sysconf
+#endif
+
+enum class StatsCounter {
+    INSERTS,         // single-value inserts
+    BULK_VALUES,     // values accepted by insertBulk()
+    ERASES,          // values erased
+    MEMMOVE_BYTES,   // bytes shifted by inserts, erases and merges
+    REALLOCATIONS,   // value buffers grown or copied out of a borrowed mapping
+    SCANS,           // full passes over a dataset
+    MERGES,          // BUFFERED tails merged into the sorted prefix
+    MIGRATIONS,      // storage changes
+    COUNT_
+};
+
+enum class LatencyOp { INSERT, QUERY, CLEAR, DROP, LIST, COUNT_ };
+
+const size_t kStatsCounters = (size_t)StatsCounter::COUNT_;
+const size_t kLatencyOps = (size_t)LatencyOp::COUNT_;
+const size_t kLatencyBuckets = 14;   // finite upper bounds; one more slot for +Inf
+
+class StatsMetrics {
+public:
+    /*
+      Pre : none
+      Post: returns the process-wide registry (never destroyed, so threads
+            may count during static destruction).
+    */
+    static StatsMetrics& instance() { static StatsMetrics* m = new StatsMetrics(); return *m; }
+
+    /*
+      Pre : none
+      Post: counter c of the calling thread's shard increased by n.
+    */
+    void add(StatsCounter c, uint64_t n = 1) { bump(shard().counters[(size_t)c], n); }
+
+    /*
+      Pre : none
+      Post: one latency sample of op recorded in the calling thread's shard.
+    */
+    void observe(LatencyOp op, uint64_t nanos) {
+        Shard& s = shard();
+        size_t b = 0;
+        while (b < kLatencyBuckets && nanos > bucketNanos(b)) ++b;
+        bump(s.buckets[(size_t)op][b], 1);
+        bump(s.sumNanos[(size_t)op], nanos);
+    }
+
+    /*
+      Pre : none
+      Post: returns counter c summed over every thread.
+    */
+    uint64_t total(StatsCounter c) const {
+        std::lock_guard<std::mutex> g(_lock);
+        uint64_t t = _retired.counters[(size_t)c].load(std::memory_order_relaxed);
+        for (auto& s : _shards) t += s->counters[(size_t)c].load(std::memory_order_relaxed);
+        return t;
+    }
+
+    /*
+      Pre : name is a metric name; each series is { labels, value }, labels
+            like dataset="x" (may be empty)
+      Post: gauge family name replaced by series.
+    */
+    void setGauge(const std::string& name, const std::string& help, const std::vector<std::pair<std::string, double>>& series) {
+        std::lock_guard<std::mutex> g(_lock);
+        Gauge& gg = _gauges[name];
+        gg.help = help; gg.series = series;
+    }
+
+    /*
+      Pre : key is a label name
+      Post: returns key="value" with value escaped for the text format.
+    */
+    static std::string label(const std::string& key, const std::string& value) {
+        std::string out = key + "=\"";
+        for (char ch : value) {
+            if (ch == '\\' || ch == '"') { out += '\\'; out += ch; }
+            else if (ch == '\n') out += "\\n";
+            else out += ch;
+        }
+        return out + "\"";
+    }
+
+    /*
+      Pre : none
+      Post: appends every metric in Prometheus text format to out.
+    */
+    void render(std::string& out) {
+        std::lock_guard<std::mutex> g(_lock);
+        uint64_t c[kStatsCounters] = {};
+        uint64_t h[kLatencyOps][kLatencyBuckets + 1] = {}, sum[kLatencyOps] = {};
+        auto fold = [&](const Shard& s) {
+            for (size_t i = 0; i < kStatsCounters; ++i) c[i] += s.counters[i].load(std::memory_order_relaxed);
+            for (size_t o = 0; o < kLatencyOps; ++o) {
+                for (size_t b = 0; b <= kLatencyBuckets; ++b) h[o][b] += s.buckets[o][b].load(std::memory_order_relaxed);
+                sum[o] += s.sumNanos[o].load(std::memory_order_relaxed);
+            }
+        };
+        fold(_retired);
+        for (auto& s : _shards) fold(*s);
+
+        static const char* const names[kStatsCounters][2] = {
+            { "statsarray_inserts_total", "Values inserted one at a time." },
+            { "statsarray_bulk_values_total", "Values accepted by bulk inserts." },
+            { "statsarray_erases_total", "Values erased." },
+            { "statsarray_memmove_bytes_total", "Bytes shifted by inserts, erases and merges." },
+            { "statsarray_reallocations_total", "Value buffer reallocations." },
+            { "statsarray_scans_total", "Full passes over a dataset." },
+            { "statsarray_merges_total", "Buffered tails merged into the sorted prefix." },
+            { "statsarray_migrations_total", "Storage changes." },
+        };
+        for (size_t i = 0; i < kStatsCounters; ++i) family(out, names[i][0], names[i][1], "counter") += sample(names[i][0], "", (double)c[i]);
+
+        // ingest rate since the previous scrape
+        const uint64_t ingested = c[(size_t)StatsCounter::INSERTS] + c[(size_t)StatsCounter::BULK_VALUES];
+        const auto now = std::chrono::steady_clock::now();
+        const double secs = std::chrono::duration<double>(now - _lastScrape).count();
+        const double rate = _scraped && secs > 0 ? (double)(ingested - _lastIngested) / secs : 0.0;
+        _scraped = true; _lastScrape = now; _lastIngested = ingested;
+        family(out, "statsarray_ingest_values_per_second", "Values ingested per second since the previous scrape.", "gauge")
+            += sample("statsarray_ingest_values_per_second", "", rate);
+
+        static const char* const ops[kLatencyOps] = { "insert", "query", "clear", "drop", "list" };
+        family(out, "statsarray_request_duration_seconds", "Request handling time by operation.", "histogram");
+        for (size_t o = 0; o < kLatencyOps; ++o) {
+            uint64_t cum = 0;
+            for (size_t b = 0; b <= kLatencyBuckets; ++b) {
+                cum += h[o][b];
+                char le[32];
+                if (b < kLatencyBuckets) snprintf(le, sizeof le, "%g", (double)bucketNanos(b) / 1e9); else snprintf(le, sizeof le, "+Inf");
+                out += sample("statsarray_request_duration_seconds_bucket", std::string("op=\"") + ops[o] + "\",le=\"" + le + "\"", (double)cum);
+            }
+            out += sample("statsarray_request_duration_seconds_sum", std::string("op=\"") + ops[o] + "\"", (double)sum[o] / 1e9);
+            out += sample("statsarray_request_duration_seconds_count", std::string("op=\"") + ops[o] + "\"", (double)cum);
+        }
+
+        for (auto& gg : _gauges) {
+            family(out, gg.first, gg.second.help, "gauge");
+            for (auto& s : gg.second.series) out += sample(gg.first, s.first, s.second);
+        }
+
+#if defined(__linux__)
+        long pages = 0, resident = 0;
+        if (FILE* f = fopen("/proc/self/statm", "r")) {
+            if (fscanf(f, "%ld %ld", &pages, &resident) == 2)
+                family(out, "process_resident_memory_bytes", "Resident memory size in bytes.", "gauge")
+                    += sample("process_resident_memory_bytes", "", (double)resident * (double)sysconf(_SC_PAGESIZE));
+            fclose(f);
+        }
+#endif
+    }
+
+private:
+    struct Shard {
+        std::atomic<uint64_t> counters[kStatsCounters];
+        std::atomic<uint64_t> buckets[kLatencyOps][kLatencyBuckets + 1];
+        std::atomic<uint64_t> sumNanos[kLatencyOps];
+        char                  pad[64];   // keeps neighbouring shards off this one's last cache line
+        Shard() {
+            for (auto& c : counters) c.store(0, std::memory_order_relaxed);
+            for (auto& o : buckets) for (auto& b : o) b.store(0, std::memory_order_relaxed);
+            for (auto& s : sumNanos) s.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    // Hands the calling thread's shard back when the thread exits.
+    struct ShardOwner {
+        Shard* shard = nullptr;
+        ~ShardOwner() { if (shard) StatsMetrics::instance().retire(shard); }
+    };
+
+    struct Gauge {
+        std::string                help;
+        std::vector<std::pair<std::string, double>> series;
+    };
+
+    // upper bounds, 1us .. 1s
+    static uint64_t bucketNanos(size_t b) {
+        static const uint64_t t[kLatencyBuckets] = {
+            1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+            1000000, 2500000, 10000000, 100000000, 1000000000 };
+        return t[b];
+    }
+
+    mutable std::mutex              _lock;     // shard list, gauges, scrape state
+    std::vector<std::unique_ptr<Shard>> _shards;   // live threads
+    Shard                           _retired;  // sums of finished threads' shards
+    std::map<std::string, Gauge>    _gauges;
+    bool                            _scraped = false;
+    std::chrono::steady_clock::time_point _lastScrape;
+    uint64_t                        _lastIngested = 0;
+
+    StatsMetrics() {}
+
+    // single writer per shard: no read-modify-write needed
+    static void bump(std::atomic<uint64_t>& a, uint64_t n) { a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+    Shard& shard() {
+        static thread_local ShardOwner mine;
+        if (!mine.shard) {
+            std::unique_ptr<Shard> s(new Shard());
+            mine.shard = s.get();
+            std::lock_guard<std::mutex> g(_lock);
+            _shards.push_back(std::move(s));
+        }
+        return *mine.shard;
+    }
+
+    /*
+      Pre : s is the exiting thread's shard; that thread counts no more
+      Post: s's counts added to _retired; s removed and freed.
+    */
+    void retire(Shard* s) {
+        std::lock_guard<std::mutex> g(_lock);
+        for (size_t i = 0; i < kStatsCounters; ++i) bump(_retired.counters[i], s->counters[i].load(std::memory_order_relaxed));
+        for (size_t o = 0; o < kLatencyOps; ++o) {
+            for (size_t b = 0; b <= kLatencyBuckets; ++b) bump(_retired.buckets[o][b], s->buckets[o][b].load(std::memory_order_relaxed));
+            bump(_retired.sumNanos[o], s->sumNanos[o].load(std::memory_order_relaxed));
+        }
+        for (size_t i = 0; i < _shards.size(); ++i)
+            if (_shards[i].get() == s) { _shards[i] = std::move(_shards.back()); _shards.pop_back(); break; }
+    }
+
+    static std::string& family(std::string& out, const std::string& name, const std::string& help, const char* type) {
+        out += "# HELP " + name + " " + help + "\n# TYPE " + name + " " + type + "\n";
+        return out;
+    }
+
+    static std::string sample(const std::string& name, const std::string& labels, double v) {
+        char num[40];
+        snprintf(num, sizeof num, "%.17g", v);
+        return name + (labels.empty() ? std::string() : "{" + labels + "}") + " " + num + "\n";
+    }
+};
+
+/*
+  Pre : none
+  Post: counter c increased by n (compiled out under STATSARRAY_NO_METRICS).
+*/
+inline void statsCount(StatsCounter c, uint64_t n = 1) {
+#if defined(STATSARRAY_NO_METRICS)
+    (void)c; (void)n;
+#else
+    StatsMetrics::instance().add(c, n);
+#endif
+}
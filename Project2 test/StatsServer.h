@@ -0,0 +1,528 @@
+#pragma once
+/*
+    Program: StatsServer - StatsArray datasets served over a Unix domain socket
+
+    Description:
+      - One long-lived process holds named datasets; clients push samples and
+        query statistics over a local stream socket (AF_UNIX).
+      - Single-threaded epoll event loop with non-blocking sockets; each
+        connection has an input and an output buffer, so clients may
+        pipeline any number of requests. Replies come back in request order,
+        also to a client that half-closes (shutdown(SHUT_WR)) after its
+        last request: the connection closes once its replies are sent.
+      - Binary protocol, little-endian:
+          request : u32 len | u8 op | u8 nameLen | name | payload
+          reply   : u32 len | u8 status | payload
+        len counts the bytes after the length field.
+          INSERT  payload f64[n]           -> u64 inserted, u64 skipped (NaN/Inf)
+          QUERY   u8 stat, u8 sample, f64 arg (PERCENTILE: 0..100) -> f64
+                  (an unknown stat or a percentile outside 0..100 is BAD_REQUEST)
+          CLEAR   (no payload)             -> (none)
+          DROP    (no payload)             -> (none)
+          LIST    (empty name)             -> u32 count, { u8 len, name }...
+      - A batch of samples is one INSERT frame going through insertBulk(),
+        so per-sample cost is a memcpy plus the merge; datasets turn on
+        adaptive storage (the loop is their only reader), which switches to
+        buffered inserts under write-heavy load.
+      - Each request's handling time goes into the StatsMetrics latency
+        histogram of its op; dataset sizes and memory are published as
+        gauges at most every 250 ms after a change.
+      - StatsClient is a small blocking client for tests and tools.
+      - Linux only (epoll, eventfd); elsewhere listen() returns false.
+*/
+
+#include <cassert>
+#include <cstddef>    // size_t
+#include <cstdint>
+#include <cstring>    // memcpy
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>     // unique_ptr
+#include <unordered_map>
+#include <chrono>
+#include "StatsArray.h"
+#include "StatsMetrics.h"
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#define STATSSERVER_EPOLL 1
+#endif
+
+enum class WireOp : uint8_t { INSERT = 1, QUERY = 2, CLEAR = 3, DROP = 4, LIST = 5 };
+
+typedef Statistic WireStat;   // wire values are Statistic's
+
+// 1..3 mirror StatsError
+enum class WireStatus : uint8_t { OK = 0, EMPTY = 1, INSUFFICIENT = 2, UNDEFINED = 3, BAD_REQUEST = 16, NO_DATASET = 17 };
+
+const size_t kWireMaxFrame = 64u << 20;   // larger frames close the connection
+
+namespace wire {
+
+inline void putU32(std::vector<unsigned char>& b, uint32_t v) { for (int i = 0; i < 4; ++i) b.push_back((unsigned char)(v >> (8 * i))); }
+inline void putU64(std::vector<unsigned char>& b, uint64_t v) { for (int i = 0; i < 8; ++i) b.push_back((unsigned char)(v >> (8 * i))); }
+inline void putF64(std::vector<unsigned char>& b, double d) { uint64_t v; memcpy(&v, &d, 8); putU64(b, v); }
+inline uint32_t getU32(const unsigned char* p) { uint32_t v = 0; for (int i = 3; i >= 0; --i) v = (v << 8) | p[i]; return v; }
+inline uint64_t getU64(const unsigned char* p) { uint64_t v = 0; for (int i = 7; i >= 0; --i) v = (v << 8) | p[i]; return v; }
+inline double getF64(const unsigned char* p) { uint64_t v = getU64(p); double d; memcpy(&d, &v, 8); return d; }
+
+inline bool hostLittleEndian() { const uint16_t x = 1; unsigned char c; memcpy(&c, &x, 1); return c == 1; }
+
+/*
+  Pre : none
+  Post: appends a request frame header (length, op, name) for a payload of
+        payloadBytes; returns false if the name is longer than 255 bytes.
+*/
+inline bool beginRequest(std::vector<unsigned char>& b, WireOp op, const std::string& name, size_t payloadBytes) {
+    if (name.size() > 255) return false;
+    putU32(b, (uint32_t)(2 + name.size() + payloadBytes));
+    b.push_back((unsigned char)op); b.push_back((unsigned char)name.size());
+    b.insert(b.end(), name.begin(), name.end());
+    return true;
+}
+
+} // namespace wire
+
+class StatsServer {
+public:
+    StatsServer() : _listen(-1), _epoll(-1), _wake(-1), _gaugesDirty(true) {}
+    ~StatsServer() { close(); }
+
+    StatsServer(const StatsServer&) = delete;
+    StatsServer& operator=(const StatsServer&) = delete;
+
+    /*
+      Pre : path fits in sockaddr_un (about 107 bytes)
+      Post: returns true with a listening socket at path (a stale socket
+            file is replaced); false on error or non-Linux builds.
+    */
+    bool listen(const std::string& path) {
+        close();
+#if defined(STATSSERVER_EPOLL)
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof addr);
+        addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof addr.sun_path) return false;
+        memcpy(addr.sun_path, path.c_str(), path.size());
+        _listen = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (_listen < 0) return false;
+        ::unlink(path.c_str());
+        if (bind(_listen, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0 || ::listen(_listen, 128) != 0) { close(); return false; }
+        _path = path;
+        _epoll = epoll_create1(EPOLL_CLOEXEC);
+        _wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_epoll < 0 || _wake < 0 || !watch(_listen, EPOLLIN, EPOLL_CTL_ADD) || !watch(_wake, EPOLLIN, EPOLL_CTL_ADD)) { close(); return false; }
+        return true;
+#else
+        (void)path;
+        return false;
+#endif
+    }
+
+    /*
+      Pre : listen() succeeded
+      Post: serves clients until requestStop(); returns false on a fatal
+            epoll error.
+    */
+    bool run() {
+#if defined(STATSSERVER_EPOLL)
+        epoll_event ev[64];
+        for (;;) {
+            if (_gaugesDirty && std::chrono::steady_clock::now() - _gaugesAt >= std::chrono::milliseconds(250)) publishGauges();
+            int k = epoll_wait(_epoll, ev, 64, _gaugesDirty ? 250 : -1);
+            if (k < 0) { if (errno == EINTR) continue; return false; }
+            for (int i = 0; i < k; ++i) {
+                const int fd = ev[i].data.fd;
+                if (fd == _wake) { uint64_t x; ssize_t r = ::read(_wake, &x, sizeof x); (void)r; return true; }
+                if (fd == _listen) { acceptAll(); continue; }
+                auto it = _conns.find(fd);
+                if (it == _conns.end()) continue;
+                Conn& c = *it->second;
+                bool alive = true;
+                if (!c.readClosed && (ev[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) alive = readFrom(c);
+                if (alive) alive = writeTo(c);
+                if (!alive) drop(fd);
+            }
+        }
+#else
+        return false;
+#endif
+    }
+
+    /*
+      Pre : none
+      Post: run() returns soon; safe to call from a signal handler or another thread.
+    */
+    void requestStop() {
+#if defined(STATSSERVER_EPOLL)
+        const uint64_t one = 1;
+        if (_wake >= 0) { ssize_t r = ::write(_wake, &one, sizeof one); (void)r; }
+#endif
+    }
+
+    /*
+      Pre : none
+      Post: all connections closed, socket file removed; datasets kept.
+    */
+    void close() {
+#if defined(STATSSERVER_EPOLL)
+        for (auto& c : _conns) ::close(c.first);
+        if (_listen >= 0) ::close(_listen);
+        if (_epoll >= 0) ::close(_epoll);
+        if (_wake >= 0) ::close(_wake);
+        if (!_path.empty()) ::unlink(_path.c_str());
+#endif
+        _conns.clear();
+        _listen = _epoll = _wake = -1;
+        _path.clear();
+    }
+
+    /*
+      Pre : none
+      Post: returns the dataset called name, creating it if needed (for
+            preloading before run(); not for use while run() is active).
+    */
+    StatsArray& dataset(const std::string& name) { return open(name); }
+
+    size_t datasets() const { return _sets.size(); }
+
+private:
+    struct Conn {
+        int                   fd;
+        std::vector<unsigned char> in, out;
+        size_t                inPos, outPos;
+        uint32_t              events;       // epoll events watched
+        bool                  readClosed;   // peer sent EOF; close once out is sent
+        Conn(int f, uint32_t watched) : fd(f), inPos(0), outPos(0), events(watched), readClosed(false) {}
+    };
+
+    int                                 _listen, _epoll, _wake;
+    std::string                         _path;
+    std::map<std::string, StatsArray>   _sets;
+    std::unordered_map<int, std::unique_ptr<Conn>> _conns;
+    std::vector<double>                 _scratch;   // aligned copy of an INSERT payload
+    bool                                _gaugesDirty;
+    std::chrono::steady_clock::time_point _gaugesAt;
+
+    /*
+      Pre : none
+      Post: returns the dataset called name; a new one has adaptive storage on.
+    */
+    StatsArray& open(const std::string& name) {
+        auto it = _sets.find(name);
+        if (it == _sets.end()) { it = _sets.insert(std::make_pair(name, StatsArray())).first; it->second.setAdaptive(true); }
+        return it->second;
+    }
+
+    /*
+      Pre : none
+      Post: per-dataset size and memory gauges and the connection count
+            handed to StatsMetrics.
+    */
+    void publishGauges() {
+        std::vector<std::pair<std::string, double>> values, bytes;
+        for (auto& s : _sets) {
+            const std::string l = StatsMetrics::label("dataset", s.first);
+            values.push_back(std::make_pair(l, (double)s.second.size()));
+            bytes.push_back(std::make_pair(l, (double)s.second.memoryBytes()));
+        }
+        StatsMetrics& m = StatsMetrics::instance();
+        m.setGauge("statsarray_dataset_values", "Values held per dataset.", values);
+        m.setGauge("statsarray_dataset_memory_bytes", "Heap bytes of value storage per dataset.", bytes);
+        m.setGauge("statsarray_server_connections", "Open client connections.", std::vector<std::pair<std::string, double>>(1, std::make_pair(std::string(), (double)_conns.size())));
+        _gaugesDirty = false; _gaugesAt = std::chrono::steady_clock::now();
+    }
+
+#if defined(STATSSERVER_EPOLL)
+    bool watch(int fd, uint32_t events, int op) {
+        epoll_event e; memset(&e, 0, sizeof e);
+        e.events = events; e.data.fd = fd;
+        return epoll_ctl(_epoll, op, fd, &e) == 0;
+    }
+
+    void acceptAll() {
+        for (;;) {
+            int fd = accept4(_listen, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            int buf = 1 << 20;
+            setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buf, sizeof buf);
+            setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof buf);
+            if (!watch(fd, EPOLLIN, EPOLL_CTL_ADD)) { ::close(fd); continue; }
+            _conns[fd].reset(new Conn(fd, EPOLLIN));
+            _gaugesDirty = true;
+        }
+    }
+
+    void drop(int fd) {
+        epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        _conns.erase(fd);
+        _gaugesDirty = true;
+    }
+
+    /*
+      Pre : c readable
+      Post: available bytes read (at most 4 MiB per wakeup, for fairness) and
+            every complete frame answered; at end of input c.readClosed is
+            set (frames before it are still answered). Returns false to
+            close c.
+    */
+    bool readFrom(Conn& c) {
+        size_t budget = 4u << 20;
+        for (;;) {
+            const size_t have = c.in.size();
+            c.in.resize(have + (256u << 10));
+            ssize_t r = ::read(c.fd, &c.in[have], 256u << 10);
+            c.in.resize(have + (r > 0 ? (size_t)r : 0));
+            if (r == 0) { c.readClosed = true; break; }
+            if (r < 0) { if (errno == EINTR) continue; if (errno == EAGAIN || errno == EWOULDBLOCK) break; return false; }
+            if (!process(c)) return false;
+            if ((size_t)r >= budget) break;
+            budget -= (size_t)r;
+        }
+        return process(c);
+    }
+
+    /*
+      Pre : none
+      Post: queued replies written as far as the socket allows; EPOLLOUT
+            requested while some remain, EPOLLIN dropped after end of input.
+            Returns false to close c: on error, or once a read-closed
+            connection has sent every reply.
+    */
+    bool writeTo(Conn& c) {
+        while (c.outPos < c.out.size()) {
+            ssize_t w = ::send(c.fd, &c.out[c.outPos], c.out.size() - c.outPos, MSG_NOSIGNAL);
+            if (w < 0) { if (errno == EINTR) continue; if (errno == EAGAIN || errno == EWOULDBLOCK) break; return false; }
+            c.outPos += (size_t)w;
+        }
+        if (c.outPos == c.out.size()) { c.out.clear(); c.outPos = 0; }
+        if (c.readClosed && c.out.empty()) return false;
+        const uint32_t events = (c.readClosed ? 0u : (uint32_t)EPOLLIN) | (c.out.empty() ? 0u : (uint32_t)EPOLLOUT);
+        if (events != c.events) { c.events = events; watch(c.fd, events, EPOLL_CTL_MOD); }
+        return true;
+    }
+#endif
+
+    /*
+      Pre : none
+      Post: each complete frame in c.in answered into c.out and consumed;
+            returns false on a malformed or oversized frame.
+    */
+    bool process(Conn& c) {
+        while (c.in.size() - c.inPos >= 4) {
+            const unsigned char* p = &c.in[c.inPos];
+            const size_t len = wire::getU32(p);
+            if (len < 2 || len > kWireMaxFrame) return false;
+            if (c.in.size() - c.inPos - 4 < len) break;
+            const unsigned nameLen = p[5];
+            if (2 + (size_t)nameLen > len) return false;
+            const auto t0 = std::chrono::steady_clock::now();
+            const WireOp op = (WireOp)p[4];
+            handle(c, op, std::string(reinterpret_cast<const char*>(p + 6), nameLen), p + 6 + nameLen, len - 2 - nameLen);
+            if (op >= WireOp::INSERT && op <= WireOp::LIST) {
+                const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+                StatsMetrics::instance().observe((LatencyOp)((unsigned)op - (unsigned)WireOp::INSERT), (uint64_t)ns);
+                if (op != WireOp::QUERY && op != WireOp::LIST) _gaugesDirty = true;
+            }
+            c.inPos += 4 + len;
+        }
+        // keep the unread tail at the front
+        if (c.inPos == c.in.size()) { c.in.clear(); c.inPos = 0; }
+        else if (c.inPos >= c.in.size() / 2) { c.in.erase(c.in.begin(), c.in.begin() + (ptrdiff_t)c.inPos); c.inPos = 0; }
+        return true;
+    }
+
+    void reply(Conn& c, WireStatus s, size_t payloadBytes) { wire::putU32(c.out, (uint32_t)(1 + payloadBytes)); c.out.push_back((unsigned char)s); }
+
+    /*
+      Pre : payload holds n bytes
+      Post: request executed and its reply appended to c.out.
+    */
+    void handle(Conn& c, WireOp op, const std::string& name, const unsigned char* payload, size_t n) {
+        switch (op) {
+        case WireOp::INSERT: {
+            if (n % 8) { reply(c, WireStatus::BAD_REQUEST, 0); return; }
+            _scratch.resize(n / 8);
+            if (n) {
+                if (wire::hostLittleEndian()) memcpy(_scratch.data(), payload, n);
+                else for (size_t i = 0; i < n / 8; ++i) _scratch[i] = wire::getF64(payload + 8 * i);
+            }
+            IngestReport r = open(name).insertBulk(_scratch.data(), _scratch.size(), IngestPolicy::SKIP);
+            reply(c, WireStatus::OK, 16); wire::putU64(c.out, r.inserted); wire::putU64(c.out, r.invalid());
+            return;
+        }
+        case WireOp::QUERY: {
+            if (n != 10) { reply(c, WireStatus::BAD_REQUEST, 0); return; }
+            auto it = _sets.find(name);
+            if (it == _sets.end()) { reply(c, WireStatus::NO_DATASET, 0); return; }
+            const double arg = wire::getF64(payload + 2);
+            if (payload[0] < (uint8_t)WireStat::COUNT || payload[0] > (uint8_t)WireStat::PERCENTILE) { reply(c, WireStatus::BAD_REQUEST, 0); return; }
+            if ((WireStat)payload[0] == WireStat::PERCENTILE && !(arg >= 0.0 && arg <= 100.0)) { reply(c, WireStatus::BAD_REQUEST, 0); return; }
+            StatsResult r = it->second.tryStatistic((WireStat)payload[0], payload[1] != 0, arg);
+            if (!r.ok()) { reply(c, (WireStatus)r.error, 0); return; }
+            reply(c, WireStatus::OK, 8); wire::putF64(c.out, r.value);
+            return;
+        }
+        case WireOp::CLEAR:
+        case WireOp::DROP: {
+            auto it = _sets.find(name);
+            if (it == _sets.end()) { reply(c, WireStatus::NO_DATASET, 0); return; }
+            if (op == WireOp::DROP) _sets.erase(it); else it->second.clear();
+            reply(c, WireStatus::OK, 0);
+            return;
+        }
+        case WireOp::LIST: {
+            size_t bytes = 4;
+            for (auto& s : _sets) bytes += 1 + s.first.size();
+            reply(c, WireStatus::OK, bytes); wire::putU32(c.out, (uint32_t)_sets.size());
+            for (auto& s : _sets) { c.out.push_back((unsigned char)s.first.size()); c.out.insert(c.out.end(), s.first.begin(), s.first.end()); }
+            return;
+        }
+        }
+        reply(c, WireStatus::BAD_REQUEST, 0);
+    }
+};
+
+/*
+  Blocking client. Requests are queued and sent by flush() (or when the
+  queue passes 1 MiB), so many can be pipelined before reading replies.
+*/
+class StatsClient {
+public:
+    struct Reply {
+        WireStatus                 status;
+        std::vector<unsigned char> payload;
+
+        bool ok() const { return status == WireStatus::OK; }
+        double value() const { return payload.size() >= 8 ? wire::getF64(payload.data()) : 0.0; }
+        uint64_t u64(size_t at) const { return payload.size() >= at + 8 ? wire::getU64(payload.data() + at) : 0; }
+    };
+
+    StatsClient() : _fd(-1), _inPos(0) {}
+    ~StatsClient() { close(); }
+
+    StatsClient(const StatsClient&) = delete;
+    StatsClient& operator=(const StatsClient&) = delete;
+
+    /*
+      Pre : none
+      Post: returns true if connected to the server socket at path.
+    */
+    bool connect(const std::string& path) {
+        close();
+#if defined(STATSSERVER_EPOLL)
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof addr);
+        addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof addr.sun_path) return false;
+        memcpy(addr.sun_path, path.c_str(), path.size());
+        _fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (_fd < 0) return false;
+        if (::connect(_fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0) { close(); return false; }
+        return true;
+#else
+        (void)path;
+        return false;
+#endif
+    }
+
+    void close() {
+#if defined(STATSSERVER_EPOLL)
+        if (_fd >= 0) ::close(_fd);
+#endif
+        _fd = -1; _out.clear(); _in.clear(); _inPos = 0;
+    }
+
+    /*
+      Pre : connected; n * 8 + name fits in one frame
+      Post: INSERT of xs[0..n) queued; returns false on a send error.
+    */
+    bool insert(const std::string& name, const double* xs, size_t n) {
+        if (!wire::beginRequest(_out, WireOp::INSERT, name, n * 8)) return false;
+        if (wire::hostLittleEndian()) { const unsigned char* p = reinterpret_cast<const unsigned char*>(xs); _out.insert(_out.end(), p, p + n * 8); }
+        else for (size_t i = 0; i < n; ++i) wire::putF64(_out, xs[i]);
+        return autoFlush();
+    }
+
+    /*
+      Pre : connected
+      Post: QUERY queued; returns false on a send error.
+    */
+    bool query(const std::string& name, WireStat s, bool sample = true, double arg = 0.0) {
+        if (!wire::beginRequest(_out, WireOp::QUERY, name, 10)) return false;
+        _out.push_back((unsigned char)s); _out.push_back(sample ? 1 : 0); wire::putF64(_out, arg);
+        return autoFlush();
+    }
+
+    /*
+      Pre : connected; op is CLEAR, DROP or LIST (name ignored for LIST)
+      Post: request queued; returns false on a send error.
+    */
+    bool command(WireOp op, const std::string& name = "") {
+        if (!wire::beginRequest(_out, op, op == WireOp::LIST ? std::string() : name, 0)) return false;
+        return autoFlush();
+    }
+
+    /*
+      Pre : connected
+      Post: every queued request sent; returns false on error.
+    */
+    bool flush() {
+#if defined(STATSSERVER_EPOLL)
+        size_t at = 0;
+        while (at < _out.size()) {
+            ssize_t w = ::send(_fd, &_out[at], _out.size() - at, MSG_NOSIGNAL);
+            if (w < 0) { if (errno == EINTR) continue; return false; }
+            at += (size_t)w;
+        }
+#endif
+        _out.clear();
+        return true;
+    }
+
+    /*
+      Pre : requests sent (flush())
+      Post: next reply read into r, in request order; false on disconnect.
+    */
+    bool read(Reply& r) {
+        if (!fill(4)) return false;
+        const size_t len = wire::getU32(&_in[_inPos]);
+        if (len < 1 || !fill(4 + len)) return false;
+        const unsigned char* p = &_in[_inPos];
+        r.status = (WireStatus)p[4];
+        r.payload.assign(p + 5, p + 4 + len);
+        _inPos += 4 + len;
+        return true;
+    }
+
+private:
+    int                   _fd;
+    std::vector<unsigned char> _out, _in;
+    size_t                _inPos;   // next unread reply byte in _in
+
+    bool autoFlush() { return _out.size() < (1u << 20) || flush(); }
+
+    bool fill(size_t need) {
+#if defined(STATSSERVER_EPOLL)
+        if (_inPos == _in.size()) { _in.clear(); _inPos = 0; }
+        unsigned char buf[64 << 10];
+        while (_in.size() - _inPos < need) {
+            ssize_t r = ::recv(_fd, buf, sizeof buf, 0);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return false;
+            _in.insert(_in.end(), buf, buf + r);
+        }
+        return true;
+#else
+        (void)need;
+        return false;
+#endif
+    }
+};
@@ -3,23 +3,398 @@
 #include <iostream>
 #include <algorithm>
 #include <string>
+#include <cctype>
+#include <cerrno>
+#include <climits>   // INT_MIN, INT_MAX
+#include <cmath>     // isfinite
+#include <cstdlib>   // exit, strtod
+#include <cstring>   // memchr, memmove
+#include <utility>   // pair
+#include <vector>
+#if defined(__has_include)
+#if __has_include(<charconv>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#include <charconv>  // from_chars (C++17; floating point needs __cpp_lib_to_chars)
+#endif
+#endif
+#if defined(_WIN32)
+#include <io.h>      // _read
+#include <locale.h>  // _create_locale, _strtod_l
+#else
+#include <unistd.h>  // read
+#include <poll.h>
+#include <locale.h>  // newlocale, strtod_l
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+#endif
 using namespace std;
 
+//Buffered standard input behind every input*() helper. stdin is read 64 KiB at
+//a time, so piped or pasted input costs no system call per prompt; cout is
+//flushed only when the reader has to wait for more input. Nothing else may
+//read cin once this is in use.
+class InputReader
+{
+public:
+	static InputReader& instance()
+	{
+		static InputReader reader;
+		return reader;
+	}
+
+	//PreCondition: NA
+	//PostCondition: returns true with the next whitespace-separated token in out
+	//               (the rest of its line is left unread); false at end of input
+	bool token(string& out)
+	{
+		out.clear();
+		while (true)
+		{
+			if (_pos == _len && !fill())
+				return false;
+			while (_pos < _len && isspace((unsigned char)_buf[_pos]))
+				_pos++;
+			if (_pos < _len)
+				break;
+		}
+		while (true)
+		{
+			size_t start = _pos;
+			while (_pos < _len && !isspace((unsigned char)_buf[_pos]))
+				_pos++;
+			out.append(_buf + start, _pos - start);
+			if (_pos < _len || !fill())
+				return true;
+		}
+	}
+
+	//PreCondition: NA
+	//PostCondition: returns true with the rest of the current line in out (no
+	//               line break); false if input had already ended
+	bool line(string& out)
+	{
+		out.clear();
+		if (_pos == _len && !fill())
+			return false;
+		while (true)
+		{
+			const char* nl = static_cast<const char*>(memchr(_buf + _pos, '\n', _len - _pos));
+			size_t end = nl ? (size_t)(nl - _buf) : _len;
+			out.append(_buf + _pos, end - _pos);
+			_pos = end;
+			if (nl)
+			{
+				_pos++;
+				break;
+			}
+			if (!fill())
+				break;
+		}
+		if (!out.empty() && out.back() == '\r')
+			out.pop_back();
+		return true;
+	}
+
+	//PreCondition: NA
+	//PostCondition: returns true if a whole line is buffered or can be read without
+	//               waiting (pasted or piped input); never blocks
+	bool lineReady()
+	{
+		while (!memchr(_buf + _pos, '\n', _len - _pos))
+		{
+			if (_ended || _len - _pos == kCapacity || !waiting())
+				return false;
+			memmove(_buf, _buf + _pos, _len - _pos);
+			_len -= _pos;
+			_pos = 0;
+			long n = readSome(_buf + _len, kCapacity - _len);
+			if (n <= 0)
+			{
+				_ended = true;
+				return false;
+			}
+			_len += (size_t)n;
+		}
+		return true;
+	}
+
+	//PreCondition: lineReady() returned true
+	//PostCondition: out holds the next line (no line break), which is left unread
+	void peekLine(string& out) const
+	{
+		const char* nl = static_cast<const char*>(memchr(_buf + _pos, '\n', _len - _pos));
+		out.assign(_buf + _pos, nl ? (size_t)(nl - _buf) - _pos : 0);
+		if (!out.empty() && out.back() == '\r')
+			out.pop_back();
+	}
+
+	//PreCondition: NA
+	//PostCondition: input discarded up to and including the next line break
+	void skipLine()
+	{
+		while (_pos < _len || fill())
+		{
+			const char* nl = static_cast<const char*>(memchr(_buf + _pos, '\n', _len - _pos));
+			if (nl)
+			{
+				_pos = (size_t)(nl - _buf) + 1;
+				return;
+			}
+			_pos = _len;
+		}
+	}
+
+private:
+	static const size_t kCapacity = 1 << 16;
+	char   _buf[kCapacity];
+	size_t _pos = 0, _len = 0;
+	bool   _ended = false;
+
+	InputReader() {}
+
+	bool fill()
+	{
+		if (_ended)
+			return false;
+		cout.flush();   // the prompt must be visible before we block
+		_pos = _len = 0;
+		long n = readSome(_buf, kCapacity);
+		if (n <= 0)
+		{
+			_ended = true;
+			return false;
+		}
+		_len = (size_t)n;
+		return true;
+	}
+
+	// bytes read into dst, 0 at end of input, < 0 on error
+	static long readSome(char* dst, size_t n)
+	{
+		while (true)
+		{
+#if defined(_WIN32)
+			long r = _read(0, dst, (unsigned)n);
+#else
+			long r = (long)::read(0, dst, n);
+#endif
+			if (r >= 0 || errno != EINTR)
+				return r;
+		}
+	}
+
+	// stdin has data (or end of input) ready now
+	static bool waiting()
+	{
+#if defined(_WIN32)
+		return false;   // console reads cannot be polled; pasted lines are still seen once buffered
+#else
+		pollfd p = { 0, POLLIN, 0 };
+		return poll(&p, 1, 0) > 0;
+#endif
+	}
+};
+
+//PreCondition: NA
+//PostCondition: reports that input ended and exits (a prompt can never be answered)
+[[noreturn]] inline void inputEnded()
+{
+	cout << "\nERROR: Input ended before an answer was given.\n";
+	cout.flush();
+	exit(1);
+}
+
+//PreCondition: NA
+//PostCondition: returns the next token; exits if input has ended
+inline string inputToken()
+{
+	string token;
+	if (!InputReader::instance().token(token))
+		inputEnded();
+	return token;
+}
+
+//PreCondition: NA
+//PostCondition: discards the rest of the current input line
+inline void inputSkipLine()
+{
+	InputReader::instance().skipLine();
+}
+
+//PreCondition: NA
+//PostCondition: returns "" with value set if all of text is a finite number
+//               (decimal point '.', whatever the locale); otherwise the reason it is not
+inline string parseDouble(const string& text, double& value)
+{
+	const char* begin = text.c_str();
+	const char* end = begin + text.size();
+	const char* digits = begin;
+	if (digits != end && *digits == '+' && digits + 1 != end && digits[1] != '-')
+		digits++;   // from_chars takes no '+'
+	const char* stop;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+	from_chars_result r = from_chars(digits, end, value);
+	if (r.ec == errc::invalid_argument)
+		return "not a number";
+	if (r.ec == errc::result_out_of_range)
+		return "out of range";
+	stop = r.ptr;
+#else
+#if defined(_WIN32)
+	static const _locale_t cLocale = _create_locale(LC_ALL, "C");
+	char* e = nullptr;
+	errno = 0;
+	value = _strtod_l(digits, &e, cLocale);
+#else
+	static const locale_t cLocale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+	char* e = nullptr;
+	errno = 0;
+	value = strtod_l(digits, &e, cLocale);
+#endif
+	stop = e;
+	if (stop == digits || isspace((unsigned char)*digits))
+		return "not a number";
+	if (errno == ERANGE && fabs(value) > 1.0)
+		return "out of range";
+#endif
+	if (stop != end)
+		return string("unexpected '") + *stop + "' at character " + to_string(stop - begin + 1);
+	if (!isfinite(value))
+		return "NaN and infinity are not accepted";
+	return "";
+}
+
+//PreCondition: NA
+//PostCondition: returns "" with value set if all of text is an int; otherwise the reason it is not
+inline string parseInteger(const string& text, int& value)
+{
+	size_t i = 0;
+	bool negative = false;
+	if (i < text.size() && (text[i] == '+' || text[i] == '-'))
+		negative = text[i++] == '-';
+	if (i == text.size() || !isdigit((unsigned char)text[i]))
+		return "not a whole number";
+	long long v = 0;
+	for (; i < text.size() && isdigit((unsigned char)text[i]); i++)
+	{
+		v = v * 10 + (text[i] - '0');
+		if (v > (long long)INT_MAX + 1)
+			return "out of range for an integer";
+	}
+	if (i != text.size())
+		return string("unexpected '") + text[i] + "' at character " + to_string(i + 1);
+	if (negative)
+		v = -v;
+	if (v > INT_MAX || v < INT_MIN)
+		return "out of range for an integer";
+	value = (int)v;
+	return "";
+}
+
+//PreCondition: NA
+//PostCondition: prompts until an int is entered (blank lines are skipped); the rest of its line is discarded
+inline int readInteger(const string& prompt)
+{
+	int value = 0;
+	do
+	{
+		cout << prompt;
+		string token = inputToken();
+		string why = parseInteger(token, value);
+		inputSkipLine();
+		if (why.empty())
+			return value;
+		cout << "ERROR: Invalid input '" << token << "': " << why << ". Must be an integer type.\n";
+	} while (true);
+}
+
+//PreCondition: NA
+//PostCondition: prompts until a finite double is entered (blank lines are skipped); the rest of its line is discarded
+inline double readDouble(const string& prompt)
+{
+	double value = 0.0;
+	do
+	{
+		cout << prompt;
+		string token = inputToken();
+		string why = parseDouble(token, value);
+		inputSkipLine();
+		if (why.empty())
+			return value;
+		cout << "ERROR: Invalid input '" << token << "': " << why << ". Must be a double type.\n";
+	} while (true);
+}
+
+//PreCondition: NA
+//PostCondition: prompts until a single character is entered; the rest of its line is discarded
+inline char readChar(const string& prompt)
+{
+	do
+	{
+		cout << prompt;
+		string token = inputToken();
+		inputSkipLine();
+		if (token.size() == 1)
+			return token[0];
+		cout << "ERROR: Invalid input '" << token << "'. Must be a single character.\n";
+	} while (true);
+}
+
+//PreCondition: NA
+//PostCondition: prompts until a non-blank line is entered, then takes every number on it
+//               (separated by spaces or commas) and on the lines pasted right after it
+//               that start with a number; values gets the numbers, rejected each other
+//               token with the reason
+void inputDoubles(string prompt, vector<double>& values, vector<pair<string, string>>& rejected)
+{
+	static const char* const separators = " \t,";
+	InputReader& in = InputReader::instance();
+	string line;
+	cout << prompt;
+	do
+	{
+		if (!in.line(line))
+			inputEnded();
+	} while (line.find_first_not_of(separators) == string::npos);
+	while (true)
+	{
+		size_t i = line.find_first_not_of(separators);
+		while (i != string::npos)
+		{
+			size_t end = min(line.find_first_of(separators, i), line.size());
+			string token = line.substr(i, end - i);
+			double v;
+			string why = parseDouble(token, v);
+			if (why.empty())
+				values.push_back(v);
+			else
+				rejected.push_back(make_pair(token, why));
+			i = line.find_first_not_of(separators, end);
+		}
+		// a pasted block goes on while the next line is already here and starts
+		// with a number; a blank line or a menu answer ends it
+		if (!in.lineReady())
+			break;
+		in.peekLine(line);
+		size_t first = line.find_first_not_of(separators);
+		double v;
+		if (first == string::npos || !parseDouble(line.substr(first, min(line.find_first_of(separators, first), line.size()) - first), v).empty())
+			break;
+		in.line(line);
+	}
+}
+
 //PreCondition: spaces (boolean true or false)
-//PostCondition: returns a string including space character(s) or without space character 
+//PostCondition: returns a string including space character(s) or without space character
 string inputString(string prompt, bool spaces)
 {
 	string input = "";
 
 	cout << prompt;
 	if (spaces)
-		getline(cin, input);
-	else
-	{
-		cin >> input;
-		cin.clear();
-		cin.ignore(999, '\n');
-	}
+		InputReader::instance().line(input);
+	else if (InputReader::instance().token(input))
+		inputSkipLine();
 	return input;
 }
 
@@ -30,57 +405,33 @@ char inputChar(string prompt, string options)
 	char input;
 	do
 	{
-		cout << prompt;
-		if (!(cin >> input))
-		{
-			cout << "ERROR: Invalid input. Must be a character type.\n";
-			cin.clear();
-			cin.ignore(999, '\n');
-		}
-		else
-		{
-			bool found = false;
-			for (int i = 0; i < options.length(); i++)
-				if ((toupper(options.at(i))) == toupper(input))
-				{
-					found = true;
-					break;
-				}
-			if (found)
+		input = readChar(prompt);
+		bool found = false;
+		for (size_t i = 0; i < options.length(); i++)
+			if ((toupper(options.at(i))) == toupper(input))
 			{
-				cin.clear();
-				cin.ignore(999, '\n');
+				found = true;
 				break;
 			}
-			else
-				cout << "ERROR: Invalid input. Must be one of '" << options << "' character.\n";
-		}
+		if (found)
+			break;
+		cout << "ERROR: Invalid input. Must be one of '" << options << "' character.\n";
 	} while (true);
 	return toupper(input);
 }
 
 //PreCondition: valid yes (char) or no (char)
-//PostCondition: returns an uppercase  yes (char) or no (char) 
+//PostCondition: returns an uppercase  yes (char) or no (char)
 char inputChar(string prompt, char yes, char no)
 {
 	char input;
 	do
 	{
-		cout << prompt;
-		if (!(cin >> input))
-		{
-			cout << "ERROR: Invalid input. Must be a character type.\n";
-			cin.clear();
-			cin.ignore(999, '\n');
-		}
-		else if (tolower(input) != tolower(yes) && tolower(input) != tolower(no))
+		input = readChar(prompt);
+		if (tolower(input) != tolower(yes) && tolower(input) != tolower(no))
 			cout << "ERROR: Invalid input. Must be a '" << static_cast<char>(toupper(yes)) << "' or '" << static_cast<char>(toupper(no)) << "' character.\n";
 		else
-		{
-			cin.clear();
-			cin.ignore(999, '\n');
 			break;
-		}
 	} while (true);
 	return toupper(input);
 }
@@ -92,23 +443,13 @@ char inputChar(string prompt, bool alphaOrDigit)
 	char input;
 	do
 	{
-		cout << prompt;
-		if (!(cin >> input))
-		{
-			cout << "ERROR: Invalid input. Must be a character type.\n";
-			cin.clear();
-			cin.ignore(999, '\n');
-		}
-		else if (alphaOrDigit && !isalpha(input))
+		input = readChar(prompt);
+		if (alphaOrDigit && !isalpha((unsigned char)input))
 			cout << "ERROR: Invalid input. Must be an alphabet character.\n";
-		else if (!alphaOrDigit && !isdigit(input))
+		else if (!alphaOrDigit && !isdigit((unsigned char)input))
 			cout << "ERROR: Invalid input. Must be a digit character.\n";
 		else
-		{
-			cin.clear();
-			cin.ignore(999, '\n');
 			break;
-		}
 	} while (true);
 	return input;
 }
@@ -117,44 +458,14 @@ char inputChar(string prompt, bool alphaOrDigit)
 //PostCondition: returns any character
 char inputChar(string prompt)
 {
-	char input;
-	do
-	{
-		cout << prompt;
-		if (!(cin >> input))
-		{
-			cout << "ERROR: Invalid input. Must be a character type.\n";
-			cin.clear();
-			cin.ignore(999, '\n');
-		}
-		else
-			break;
-	} while (true);
-	cin.clear();
-	cin.ignore(999, '\n');
-	return toupper(input);
+	return toupper(readChar(prompt));
 }
 
 //PreCondition: NA
 //PostCondition: returns any integer value
 int inputInteger(string prompt)
 {
-	int input;
-	do
-	{
-		cout << prompt;
-		if (!(cin >> input))
-		{
-			cout << "ERROR: Invalid input. Must be an integer type.\n";
-			cin.clear();
-			cin.ignore(999, '\n');
-		}
-		else
-			break;
-	} while (true);
-	cin.clear();
-	cin.ignore(999, '\n');
-	return input;
+	return readInteger(prompt);
 }
 
 //PreCondition: posNeg (boolean true or false)
@@ -164,22 +475,14 @@ int inputInteger(string prompt, bool posNeg)
 	int input;
 	do
 	{
-		cout << prompt;
-		if (!(cin >> input))
-		{
-			cout << "ERROR: Invalid input. Must be an integer type.\n";
-			cin.clear();
-			cin.ignore(999, '\n');
-		}
-		else if (posNeg && input <= 0)
+		input = readInteger(prompt);
+		if (posNeg && input <= 0)
 			cout << "ERROR: Invalid input. Must be a positive number.\n";
 		else if (!posNeg && input >= 0)
 			cout << "ERROR: Invalid input. Must be a negative number.\n";
 		else
 			break;
 	} while (true);
-	cin.clear();
-	cin.ignore(999, '\n');
 	return input;
 }
 
@@ -190,22 +493,14 @@ int inputInteger(string prompt, int start, bool greater)
 	int input;
 	do
 	{
-		cout << prompt;
-		if (!(cin >> input))
-		{
-			cout << "ERROR: Invalid input. Must be an integer type.\n";
-			cin.clear();
-			cin.ignore(999, '\n');
-		}
-		else if (greater && input < start)
+		input = readInteger(prompt);
+		if (greater && input < start)
 			cout << "ERROR: Invalid input. Must be a greater than or equal to " << start << ".\n";
 		else if (!greater && input > start)
 			cout << "ERROR: Invalid input. Must be a lesser than or equal to " << start << ".\n";
 		else
 			break;
 	} while (true);
-	cin.clear();
-	cin.ignore(999, '\n');
 	return input;
 }
 
@@ -216,20 +511,12 @@ int inputInteger(string prompt, int startRange, int endRange)
 	int input;
 	do
 	{
-		cout << prompt;
-		if (!(cin >> input))
-		{
-			cout << "ERROR: Invalid input. Must be an integer type.\n";
-			cin.clear();
-			cin.ignore(999, '\n');
-		}
-		else if (!(input >= min(startRange, endRange) && input <= max(startRange, endRange)))
+		input = readInteger(prompt);
+		if (!(input >= min(startRange, endRange) && input <= max(startRange, endRange)))
 			cout << "ERROR: Invalid input. Must be from " << startRange << ".." << endRange << ".\n";
 		else
 			break;
 	} while (true);
-	cin.clear();
-	cin.ignore(999, '\n');
 	return input;
 }
 
@@ -237,22 +524,7 @@ int inputInteger(string prompt, int startRange, int endRange)
 //PostCondition: returns any double value
 double inputDouble(string prompt)
 {
-	double input;
-	do
-	{
-		cout << prompt;
-		if (!(cin >> input))
-		{
-			cout << "ERROR: Invalid input. Must be a double type.\n";
-			cin.clear();
-			cin.ignore(999, '\n');
-		}
-		else
-			break;
-	} while (true);
-	cin.clear();
-	cin.ignore(999, '\n');
-	return input;
+	return readDouble(prompt);
 }
 
 //PreCondition: posNeg (boolean true or false)
@@ -262,22 +534,14 @@ double inputDouble(string prompt, bool posNeg)
 	double input;
 	do
 	{
-		cout << prompt;
-		if (!(cin >> input))
-		{
-			cout << "ERROR: Invalid input. Must be a double type.\n";
-			cin.clear();
-			cin.ignore(999, '\n');
-		}
-		else if (posNeg && input <= 0.0)
+		input = readDouble(prompt);
+		if (posNeg && input <= 0.0)
 			cout << "ERROR: Invalid input. Must be a positive number.\n";
 		else if (!posNeg && input >= 0.0)
 			cout << "ERROR: Invalid input. Must be a negative number.\n";
 		else
 			break;
 	} while (true);
-	cin.clear();
-	cin.ignore(999, '\n');
 	return input;
 }
 
@@ -288,22 +552,14 @@ double inputDouble(string prompt, double start, bool posNeg)
 	double input;
 	do
 	{
-		cout << prompt;
-		if (!(cin >> input))
-		{
-			cout << "ERROR: Invalid input. Must be a double type.\n";
-			cin.clear();
-			cin.ignore(999, '\n');
-		}
-		else if (posNeg && input <= start)
+		input = readDouble(prompt);
+		if (posNeg && input <= start)
 			cout << "ERROR: Invalid input. Must be greater than or equal to " << start << ".\n";
 		else if (!posNeg && input >= start)
 			cout << "ERROR: Invalid input. Must be lesser than or equal to " << start << ".\n";
 		else
 			break;
 	} while (true);
-	cin.clear();
-	cin.ignore(999, '\n');
 	return input;
 }
 
@@ -314,19 +570,11 @@ double inputDouble(string prompt, double startRange, double endRange)
 	double input;
 	do
 	{
-		cout << prompt;
-		if (!(cin >> input))
-		{
-			cout << "ERROR: Invalid input. Must be a double type.\n";
-			cin.clear();
-			cin.ignore(999, '\n');
-		}
-		else if (!(input >= min(startRange, endRange) && input <= max(startRange, endRange)))
+		input = readDouble(prompt);
+		if (!(input >= min(startRange, endRange) && input <= max(startRange, endRange)))
 			cout << "ERROR: Invalid input. Must be from " << startRange << ".." << endRange << ".\n";
 		else
 			break;
 	} while (true);
-	cin.clear();
-	cin.ignore(999, '\n');
 	return input;
 }
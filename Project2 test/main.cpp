@@ -21,25 +21,133 @@
 #include <cstdint>
 #include <tuple>
 #include <exception>
+#include <cctype>
+#include <csignal>
+#include <chrono>
+#include <mutex>
+#include <cstdio>    // fileno
+#include <cstring>   // strlen
+#ifdef _WIN32
+#include <io.h>      // _isatty
+#else
+#include <unistd.h>  // isatty
+#endif
 #include "StatsArray.h"
+#include "Interchange.h"
+#include "SharedDataset.h"
+#include "StatsServer.h"
+#include "MetricsEndpoint.h"
+#include "SessionScript.h"
+#include "Snapshot.h"
+#include "FieldScanner.h"
+#include "FileFollower.h"
+#include "AsyncReader.h"
+#include "MultiFileLoader.h"
+#include "ResultCache.h"
 #include "input.h"
 
 using namespace std;
 
 // Pre : none
-// Post: app starts as Sample with an empty StatsArray
+// Post: app starts as Sample with an empty StatsArray; file loads skip NaN/Inf;
+//       nothing is published to shared memory until option 5 is used;
+//       actions are written to a script only under --record;
+//       lock guards arr/type against the auto-save and follow threads (held
+//       only around dataset reads and changes, never across a prompt), dirty marks
+//       changes not yet in the snapshot (snapshotPath empty = no snapshot);
+//       follow merges a growing file's new numbers in the background;
+//       fields picks what text loads take per line (default: every number);
+//       io sets how text files are read (queue depth, O_DIRECT);
+//       cachedInput names the one text file the dataset holds exactly
+//       (empty once anything else changes it), cached its result cache
 enum class DataSetType { SAMPLE, POPULATION };
 struct App {
-    DataSetType type = DataSetType::SAMPLE;
-    StatsArray  arr;
+    DataSetType         type = DataSetType::SAMPLE;
+    StatsArray          arr;
+    IngestPolicy        policy = IngestPolicy::SKIP;
+    SharedDatasetWriter shared;
+    SessionRecorder     recorder;
+    string              snapshotPath;
+    bool                dirty = false;
+    mutex               lock;
+    size_t              followed = 0, followSkipped = 0;
+    FieldSpec           fields;
+    ReadOptions         io;
+    string              cachedInput;
+    CachedResult        cached;
+    FollowThread        follow;    // last: stopped before the rest is destroyed
 };
 
+/*
+  Pre : none
+  Post: returns the menu label of p.
+*/
+static const char* policyName(IngestPolicy p) {
+    switch (p) {
+    case IngestPolicy::REJECT: return "reject file";
+    case IngestPolicy::CLAMP:  return "clamp Inf, skip NaN";
+    default:                   return "skip";
+    }
+}
+
+/*
+  Pre : r from insertBulk
+  Post: prints how many NaN/+Inf/-Inf values were found and what became of them.
+*/
+static void printIngestReport(const IngestReport& r) {
+    if (!r.invalid()) return;
+    cout << "Non-finite values: " << r.nan << " NaN, " << r.posInf << " +Inf, " << r.negInf << " -Inf";
+    if (r.rejected) cout << " (file rejected, nothing inserted)\n";
+    else if (r.clamped) cout << " (" << r.clamped << " clamped, " << (r.invalid() - r.clamped) << " skipped)\n";
+    else cout << " (skipped)\n";
+}
+
+/*
+  Pre : none
+  Post: returns the lower-case extension of path including the dot ("" if none).
+*/
+static string fileExtension(const string& path) {
+    size_t dot = path.find_last_of('.'), slash = path.find_last_of("/\\");
+    if (dot == string::npos || (slash != string::npos && dot < slash)) return string();
+    string ext = path.substr(dot);
+    for (char& c : ext) c = (char)tolower((unsigned char)c);
+    return ext;
+}
+
+/*
+  Pre : none
+  Post: returns true unless stdout is redirected to a file or pipe.
+*/
+static bool stdoutIsTerminal() {
+#ifdef _WIN32
+    return _isatty(_fileno(stdout)) != 0;
+#else
+    return isatty(STDOUT_FILENO) != 0;
+#endif
+}
+
+/*
+  Pre : none
+  Post: returns n as "512 B", "1.5 KB", "23.4 MB", ...
+*/
+static string formatBytes(uint64_t n) {
+    const char* units[] = { "B", "KB", "MB", "GB", "TB" };
+    double v = (double)n; size_t u = 0;
+    while (v >= 1024.0 && u + 1 < sizeof units / sizeof units[0]) { v /= 1024.0; ++u; }
+    ostringstream os;
+    if (u == 0) os << n << ' ' << units[0];
+    else os << fixed << setprecision(1) << v << ' ' << units[u];
+    return os.str();
+}
+
 /*
   Pre : console available
   Post: clears the terminal screen buffer (platform-dependent best effort).
 */
 static void clearScreen() {
     cout.flush();
+    // redirected output (scripted runs) skips the shell round trip
+    if (!stdoutIsTerminal()) return;
 #ifdef _WIN32
     system("cls");
 #else
@@ -49,12 +157,11 @@ static void clearScreen() {
 
 /*
   Pre : none
-  Post: prints msg, then waits for a line; input buffer is cleared.
+  Post: prints msg, then waits for a line (returns at end of input).
 */
 static void pauseEnter(const string& msg = "Press any key to continue . . . ") {
     cout << '\n' << msg;
-    cin.clear();
-    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    inputSkipLine();
 }
 
 /*
@@ -69,16 +176,29 @@ static string formatPtr(const void* p) {
     return oss.str();
 }
 
+/*
+  Pre : none
+  Post: prints the values on one line; large datasets show only both sorted ends.
+*/
 static void printValuesInline(const StatsArray& a) {
+    const size_t edge = 10;           // values shown at each end of a large dataset
     if (a.size() == 0) {
         cout << "\n";     // no data: just keep it blank like your screenshot
         return;
     }
-    for (size_t i = 0; i < a.size(); ++i) {
-        if (i) cout << "  ";          // double-space between numbers (matches look)
-        cout << a.at(i);              // default stream formatting -> 13 51 98
+    if (a.size() <= 2 * edge) {
+        bool first = true;
+        for (double v : a.bottomK(a.size())) {
+            if (!first) cout << "  ";     // double-space between numbers (matches look)
+            cout << v; first = false;     // default stream formatting -> 13 51 98
+        }
+        cout << '\n';
+        return;
     }
-    cout << '\n';
+    for (double v : a.bottomK(edge)) cout << v << "  ";
+    cout << "...";
+    for (double v : a.topK(edge)) cout << "  " << v;
+    cout << "  (" << a.size() << " values)\n";
 }
 
 /*
@@ -87,11 +207,18 @@ static void printValuesInline(const StatsArray& a) {
 */
 static void drawMain(const App& app) {
 
-    srand(static_cast<unsigned>(time(0)));
-
     cout << "Descriptive Statistics Calculator Main Menu\n";
     cout << "Address of Dynamic array: " << formatPtr(app.arr.dataAddress()) << "\n";
-    cout << "Dataset: (" << (app.type == DataSetType::SAMPLE ? "Sample" : "Population") << ")\n\n";
+    cout << "Dataset: (" << (app.type == DataSetType::SAMPLE ? "Sample" : "Population") << ")\n";
+    if (!app.snapshotPath.empty()) cout << "Snapshot: " << app.snapshotPath << (app.dirty ? " (unsaved changes)" : "") << "\n";
+    if (app.follow.running()) {
+        cout << "Following: " << app.follow.path() << " (" << app.followed << " value(s) appended";
+        if (app.followSkipped && app.follow.fields().active())
+            cout << ", " << app.followSkipped << " line(s) without " << app.follow.fields().describe();
+        else if (app.followSkipped) cout << ", " << app.followSkipped << " non-numeric token(s) skipped";
+        cout << ")\n";
+    }
+    cout << "\n";
     printValuesInline(app.arr);
     cout << "\n";
     cout << "____________________________________________________________________\n\n";
@@ -99,6 +226,10 @@ static void drawMain(const App& app) {
     cout << "1. Configure Dataset to Sample or Polulation\n";
     cout << "2. Insert sort value(s) to the Dataset\n";
     cout << "3. Delete value(s) from the Dataset\n";
+    cout << "4. Export dataset (.npy / .arrow)\n";
+    cout << "5. Publish dataset to shared memory";
+    if (app.shared.isOpen()) cout << " (now: " << app.shared.name() << ", generation " << app.shared.generation() << ")";
+    cout << "\n";
     cout << "--------------------------------------------------------------------\n";
     cout << "A. Find Minimum                N. Find Outliers\n";
     cout << "B. Find Maximum                O. Find Sum of Squares\n";
@@ -117,9 +248,195 @@ static void drawMain(const App& app) {
 
 }
 
+/*
+  Pre : none
+  Post: returns v as text that reads back as exactly v.
+*/
+static string exactText(double v) {
+    char buf[32];
+    snprintf(buf, sizeof buf, "%.17g", v);
+    return buf;
+}
+
+/*
+  Pre : text holds numbers separated by spaces or commas
+  Post: returns true with the numbers appended to out; otherwise false
+        with the first bad token and the reason in error.
+*/
+static bool parseValueList(const string& text, vector<double>& out, string& error) {
+    const char* const separators = " \t,";
+    for (size_t i = text.find_first_not_of(separators); i != string::npos; ) {
+        size_t end = min(text.find_first_of(separators, i), text.size());
+        const string token = text.substr(i, end - i);
+        double v;
+        string why = parseDouble(token, v);
+        if (!why.empty()) { error = "'" + token + "': " + why; return false; }
+        out.push_back(v);
+        i = text.find_first_not_of(separators, end);
+    }
+    return true;
+}
+
+/*
+  Pre : count >= 0
+  Post: count random integers 0..100 appended to out.
+*/
+static void appendRandom(vector<double>& out, int count) {
+    for (int i = 0; i < count; i++) out.push_back(static_cast<double>(rand() % 101));
+}
+
+/*
+  Pre : pattern is a file, directory or wildcard pattern
+  Post: the matching files parsed in parallel (text per app.fields) and
+        merged into the dataset under app.policy, with progress in bytes on
+        a terminal; prints the
+        outcome and returns false if nothing could be read.
+*/
+static bool loadMany(App& app, const string& pattern) {
+    const vector<string> files = expandInputs(pattern);
+    if (files.empty()) { cout << "\nERROR: No files match: " << pattern << '\n'; return false; }
+    // one file into an empty dataset: its result cache, if current, replaces parsing
+    const bool single = files.size() == 1 && app.arr.size() == 0;
+    CachedResult cache;
+    cache.fields = app.fields.text();
+    cache.policy = (uint32_t)app.policy;
+    app.cachedInput.clear();
+    if (single) {
+        if (loadCachedResult(files[0], cache.fields, cache.policy, app.io, app.arr, app.cached)) {
+            cout << "\nCONFIRMATION: Inserted " << app.arr.size() << " value(s) from file (unchanged; read from its result cache).\n";
+            app.cachedInput = files[0];
+            return true;
+        }
+        resultcache::inputStamp(files[0], cache.inputBytes, cache.inputTime);   // before reading: a later change must miss
+    }
+    if (files.size() > 1) cout << "\nLoading " << files.size() << " file(s)...\n";
+    const bool tty = stdoutIsTerminal() && files.size() > 1;
+    MultiFileLoad r = loadFiles(files, app.arr, app.policy, 0, [&](uint64_t done, uint64_t total) {
+        if (!tty) return;
+        cout << '\r' << formatBytes(done) << " of " << formatBytes(total);
+        if (total) cout << " (" << (int)(100.0 * (double)done / (double)total) << "%)";
+        cout << "    " << flush;
+    }, app.fields, app.io);
+    if (tty) cout << '\n';
+    if (r.files == 1 && !r.failed) cout << "\nCONFIRMATION: Inserted " << r.ingest.inserted << " value(s) from file.\n";
+    else if (r.files > 1) cout << "\nCONFIRMATION: Inserted " << r.ingest.inserted << " value(s) from " << (r.files - r.failed - r.rejected)
+         << " of " << r.files << " file(s); " << formatBytes(r.bytes) << " read.\n";
+    if (r.skipped && app.fields.active()) cout << "Lines without " << app.fields.describe() << ": " << r.skipped << '\n';
+    else if (r.skipped) cout << "Non-numeric tokens skipped: " << r.skipped << '\n';
+    if (r.rejected && r.files > 1) cout << "Files rejected for NaN/Inf: " << r.rejected << '\n';
+    IngestReport shown = r.ingest;
+    shown.rejected = r.rejected && r.rejected == r.files - r.failed;   // nothing inserted
+    if (!r.rejected || shown.rejected) printIngestReport(shown);          // else the count above says it
+    for (const string& e : r.errors) cout << "ERROR: " << e << '\n';
+    if (r.failed > r.errors.size()) cout << "... and " << (r.failed - r.errors.size()) << " more file(s) failed\n";
+    if (single && !r.failed && !r.rejected) {
+        cache.hash = r.hash;
+        app.cached = cache;
+        app.cachedInput = files[0];
+    }
+    return r.failed < r.files;
+}
+
+/*
+  Pre : none
+  Post: inserts the numbers of the file at path (text, .npy or .arrow)
+        under app.policy and prints the outcome; returns false if the file
+        could not be read. Text files, directories and wildcard patterns go
+        to loadMany().
+*/
+static bool loadFile(App& app, const string& path) {
+    if (multifile::hasWildcard(path) || multifile::isDirectory(path)) return loadMany(app, path);
+    const string ext = fileExtension(path);
+    if (ext == ".npy" || ext == ".arrow" || ext == ".feather" || ext == ".ipc") {
+        // binary column: mapped, no text parsing
+        app.cachedInput.clear();
+        ColumnLoad r = ext == ".npy" ? loadNpy(path, app.arr, app.policy) : loadArrow(path, app.arr, app.policy);
+        if (!r.ok()) { cout << "\nERROR: " << r.error << '\n'; return false; }
+        cout << "\nCONFIRMATION: Inserted " << r.ingest.inserted << " value(s) from file"
+             << (r.zeroCopy ? " (mapped in place)" : "") << ".\n";
+        if (r.nulls) cout << "Null entries skipped: " << r.nulls << '\n';
+        printIngestReport(r.ingest);
+        return true;
+    }
+    if (!multifile::isRegularFile(path)) { cout << "\nERROR: Could not open file: " << path << '\n'; return false; }
+    return loadMany(app, path);   // same scanner and merge as many files
+}
+
+/*
+  Pre : none
+  Post: writes the dataset to path (.npy or .arrow) and prints the outcome;
+        returns true on success.
+*/
+static bool exportDataset(const App& app, const string& path) {
+    const string ext = fileExtension(path);
+    bool ok;
+    if (ext == ".npy") ok = saveNpy(path, app.arr);
+    else if (ext == ".arrow" || ext == ".feather" || ext == ".ipc") ok = saveArrow(path, app.arr);
+    else { cout << "\nERROR: Use a .npy or .arrow file name.\n"; return false; }
+    if (ok) cout << "\nCONFIRMATION: Wrote " << app.arr.size() << " value(s) to " << path << ".\n";
+    else cout << "\nERROR: Could not write file: " << path << '\n';
+    return ok;
+}
+
+/*
+  Pre : none
+  Post: publishes the dataset to shared memory segment name (a leading '/'
+        is added if missing) and prints the outcome; returns true on success.
+*/
+static bool publishDataset(App& app, string name) {
+    if (name.empty() || name[0] != '/') name = "/" + name;
+    if (app.shared.isOpen() && app.shared.name() != name) app.shared.unlink();
+    if ((!app.shared.isOpen() && !app.shared.create(name)) || !app.shared.publish(app.arr)) {
+        cout << "\nERROR: Could not publish to shared memory segment " << name << ".\n";
+        return false;
+    }
+    cout << "\nCONFIRMATION: Published " << app.arr.size() << " value(s) to " << name << ".\n";
+    return true;
+}
+
+/*
+  Pre : app.lock held; a menu action just changed the dataset's values
+  Post: the change is marked for the next snapshot and republished to
+        shared memory if the dataset is published there.
+*/
+static void noteChange(App& app) {
+    app.dirty = true;
+    if (app.shared.isOpen()) app.shared.publish(app.arr);
+}
+
+/*
+  Pre : called on the follow thread
+  Post: returns false (values kept for the next wake) while a menu action
+        holds app.lock; otherwise merges them under app.policy and returns true.
+*/
+static bool mergeFollowed(App& app, vector<double>& values, const FollowReport& r) {
+    unique_lock<mutex> hold(app.lock, try_to_lock);
+    if (!hold) return false;
+    IngestReport ingest = app.arr.insertBulk(values.data(), values.size(), app.policy);
+    app.followed += ingest.inserted;
+    app.followSkipped += r.skipped;
+    if (ingest.inserted) {
+        app.dirty = true;
+        app.cachedInput.clear();
+        if (app.shared.isOpen()) app.shared.publish(app.arr);
+    }
+    return true;
+}
+
+/*
+  Pre : app.lock may be held by the caller
+  Post: any previous follow stopped; path followed from its start in the
+        background, taking app.fields; returns false if it cannot be opened.
+*/
+static bool startFollowing(App& app, const string& path) {
+    app.follow.stop();
+    app.followed = app.followSkipped = 0;
+    return app.follow.start(path, [&app](vector<double>& values, const FollowReport& r) { return mergeFollowed(app, values, r); }, app.fields);
+}
+
 /*
   Pre : app is valid
-  Post: allows user to insert one value, many randoms, or file numbers; returns to caller.
+  Post: allows user to insert typed/pasted values, many randoms, or file numbers; returns to caller.
 */
 static void screenInsertMenu(App& app) {
 
@@ -129,23 +446,44 @@ static void screenInsertMenu(App& app) {
             R"(Insert (sort) Dataset Menu
 ____________________________________________________________________
 
-    A. insert a value
+    A. insert value(s) (type or paste many)
     B. insert a specified number of random values
-    C. read data from file and insert values
+    C. read data from file(s) and insert values
+    E. extract a field from log lines (key or column)
+    F. follow a growing file (like tail -f)
+    P. policy for NaN/Inf in files
 ____________________________________________________________________
 
     R. return
 ____________________________________________________________________
 )";
-        char opt = inputChar("Option: ", string("ABCR"));
+        cout << "    Current NaN/Inf policy: " << policyName(app.policy) << "\n";
+        cout << "    Current field: " << app.fields.describe() << "\n\n";
+        char opt = inputChar("Option: ", string("ABCEFPR"));
         if (opt == 'R') return;
 
         if (opt == 'A') {
             clearScreen();
-            cout << "Insert (single) value\n\n";
-            double v = inputDouble("Enter a number: ");
-            app.arr.insert(v);
-            cout << "\nCONFIRMATION: Inserted " << v << " into the Dataset.\n";
+            cout << "Insert value(s)\n\n"
+                 << "Separate numbers with spaces or commas; a pasted block of lines is read in one go.\n\n";
+            vector<double> values; vector<pair<string, string>> rejected;
+            inputDoubles("Enter number(s): ", values, rejected);
+            IngestReport r;
+            {
+                // one validated merge for the whole paste
+                lock_guard<mutex> hold(app.lock);
+                r = app.arr.insertBulk(values.data(), values.size(), IngestPolicy::SKIP);
+                if (r.inserted) { app.cachedInput.clear(); noteChange(app); }
+            }
+            cout << "\nCONFIRMATION: Inserted " << r.inserted << " value(s) into the Dataset; rejected " << rejected.size() << ".\n";
+            const size_t shown = min(rejected.size(), (size_t)5);
+            for (size_t i = 0; i < shown; ++i) cout << "    '" << rejected[i].first << "': " << rejected[i].second << '\n';
+            if (rejected.size() > shown) cout << "    ... and " << (rejected.size() - shown) << " more\n";
+            if (!values.empty()) {
+                string text;
+                for (double v : values) { if (!text.empty()) text += ' '; text += exactText(v); }
+                app.recorder.record("2A", text);
+            }
             pauseEnter();
         }
         else if (opt == 'B') {
@@ -153,27 +491,77 @@ ____________________________________________________________________
             cout << "Insert (random) values\n\n";
             int count = inputInteger("How many random values? ", true);
 
-            for (int i = 0; i < count; i++) {
-                int r = rand() % 101;                 
-                app.arr.insert(static_cast<double>(r));
+            vector<double> values;
+            appendRandom(values, count);
+            {
+                lock_guard<mutex> hold(app.lock);
+                app.arr.insertBulk(values.data(), values.size());
+                if (count > 0) { app.cachedInput.clear(); noteChange(app); }
             }
 
             cout << "\nCONFIRMATION: Inserted " << count << " random values.\n";
+            app.recorder.record("2B", to_string(count));
             pauseEnter();
         }
         else if (opt == 'C') {
             clearScreen();
             cout << "Read data from file and insert values\n\n";
-            string path = inputString("Enter file path (whitespace-separated numbers): ", true);
-            ifstream fin(path);
-            if (!fin) { cout << "\nERROR: Could not open file: " << path << '\n'; pauseEnter(); continue; }
-            size_t inserted = 0; string token;
-            while (fin >> token) {
-                char* endp = nullptr; const char* cstr = token.c_str(); errno = 0;
-                double v = strtod(cstr, &endp);
-                if (endp != cstr && errno == 0) { app.arr.insert(v); ++inserted; }
+            string path = inputString("Enter file, directory or pattern like data/*.txt (text, .npy / .arrow): ", true);
+            bool loaded;
+            {
+                lock_guard<mutex> hold(app.lock);
+                const size_t before = app.arr.size();
+                loaded = loadFile(app, path);
+                if (loaded && app.arr.size() != before) noteChange(app);
+            }
+            if (loaded) app.recorder.record("2C", path);
+            pauseEnter();
+        }
+        else if (opt == 'E') {
+            clearScreen();
+            cout << "Extract a field from log lines\n\n"
+                 << "Text files (C) and followed files (F) then yield one value per line:\n"
+                 << "    latency_ms   the value of latency_ms=12.7 (quotes allowed)\n"
+                 << "    3            the 3rd column, split on spaces and tabs\n"
+                 << "    3,  3;  3|   the 3rd column of comma, semicolon or bar separated lines\n"
+                 << "    3t           the 3rd column of tab separated lines\n"
+                 << "    -            every number in the text (the default)\n\n";
+            string text = inputString("Enter field: ", true), error;
+            FieldSpec spec;
+            if (!parseFieldSpec(text, spec, error)) cout << "\nERROR: " << error << ".\n";
+            else {
+                app.fields = spec;
+                cout << "\nCONFIRMATION: Taking " << app.fields.describe() << ".\n";
+                app.recorder.record("2E", app.fields.text());
             }
-            cout << "\nCONFIRMATION: Inserted " << inserted << " value(s) from file.\n";
+            pauseEnter();
+        }
+        else if (opt == 'F') {
+            clearScreen();
+            cout << "Follow a growing file\n\n"
+                 << "Numbers in the file are inserted, then numbers appended to it are merged\n"
+                 << "in the background as they arrive, across log rotation.\n";
+            if (app.follow.running()) cout << "Now following: " << app.follow.path() << " (enter - to stop)\n";
+            cout << '\n';
+            string path = inputString("Enter file path: ", true);
+            if (path == "-") { app.follow.stop(); cout << "\nCONFIRMATION: Stopped following.\n"; }
+            else if (startFollowing(app, path)) cout << "\nCONFIRMATION: Following " << path << ".\n";
+            else cout << "\nERROR: Could not open file: " << path << '\n';
+            pauseEnter();
+        }
+        else if (opt == 'P') {
+            clearScreen();
+            cout << "Policy for NaN/Inf values in files\n\n"
+                 << "    1. reject the whole file\n"
+                 << "    2. skip them and count\n"
+                 << "    3. clamp +/-Inf to the largest finite value, skip NaN\n\n";
+            char p = inputChar("Option: ", string("123"));
+            {
+                lock_guard<mutex> hold(app.lock);   // follow merges read it
+                app.policy = p == '1' ? IngestPolicy::REJECT : p == '3' ? IngestPolicy::CLAMP : IngestPolicy::SKIP;
+            }
+            cout << "\nCONFIRMATION: Policy set to " << policyName(app.policy) << ".\n";
+            app.recorder.record("2P", string(1, p));
             pauseEnter();
         }
     }
@@ -181,7 +569,7 @@ ____________________________________________________________________
 
 /*
   Pre : callable fn representing a stats action that may throw
-  Post: runs fn; on exception prints "Exception Error: ..." and always pauses.
+  Post: runs fn; on exception prints "Exception Error: ...".
 */
 template <typename Fn>
 static void runStat(Fn fn) {
@@ -200,36 +588,344 @@ static void runStat(Fn fn) {
     catch (...) {
         cout << "Exception Error: Unknown error.\n";
     }
-    pauseEnter();
+}
+
+/*
+  Pre : r from a non-throwing statistic (tryMin(), ...)
+  Post: prints "label = value", or "Exception Error: ..." on error.
+*/
+static void showStat(const string& label, const StatsResult& r) {
+    if (r.ok()) cout << label << " = " << r.value << '\n';
+    else cout << "Exception Error: " << r.message() << "\n";
+}
+
+/*
+  Pre : none
+  Post: text holds the full report (option Y) for app.type; returns false
+        after printing why if there is none. While the dataset is exactly
+        app.cachedInput the report comes from, or is stored in, that
+        file's result cache.
+*/
+static bool fullReport(App& app, string& text) {
+    const bool sample = (app.type == DataSetType::SAMPLE);
+    string& cached = app.cached.report[sample ? 0 : 1];
+    if (!app.cachedInput.empty() && !cached.empty()) { text = cached; return true; }
+    bool ok = false;
+    runStat([&] { ostringstream os; app.arr.printAll(os, sample); text = os.str(); ok = true; });
+    if (ok && !app.cachedInput.empty()) {
+        cached = text;
+        saveCachedResult(app.cachedInput, app.cached, app.arr);
+    }
+    return ok;
+}
+
+/*
+  Pre : key is a statistic key 'A'..'Y'
+  Post: prints that statistic of the dataset (sample or population forms per
+        app.type); errors are printed, never thrown.
+*/
+static void printStatistic(App& app, char key) {
+    const bool sample = (app.type == DataSetType::SAMPLE);
+
+    switch (key) {
+    // --- A..Y stats (non-throwing results; exception wrapper for the rest) ---
+    case 'A': { showStat("Minimum", app.arr.tryMin()); break; }
+    case 'B': { showStat("Maximum", app.arr.tryMax()); break; }
+    case 'C': { showStat("Range", app.arr.tryRange()); break; }
+    case 'D': { cout << "Size = " << app.arr.size() << '\n'; break; }
+    case 'E': { showStat("Sum", app.arr.trySum()); break; }
+    case 'F': { showStat("Mean", app.arr.tryMean()); break; }
+    case 'G': { showStat("Median", app.arr.tryMedian()); break; }
+    case 'H': { runStat([&] { auto md = app.arr.modes(); cout << "Mode(s): "; if (md.empty()) cout << "(none)\n"; else { for (size_t i = 0;i < md.size();++i) { if (i) cout << ' '; cout << md[i]; } cout << '\n'; } }); break; }
+    case 'I': { showStat(string("Standard Deviation (") + (sample ? "sample" : "population") + ")", app.arr.tryStdev(sample)); break; }
+    case 'J': { showStat(string("Variance (") + (sample ? "sample" : "population") + ")", app.arr.tryVariance(sample)); break; }
+    case 'K': { showStat("Midrange", app.arr.tryMidrange()); break; }
+    case 'L': { runStat([&] { double q1, q2, q3; tie(q1, q2, q3) = app.arr.quartiles(); cout << "Quartiles:\nQ1 = " << q1 << "\nQ2 (Median) = " << q2 << "\nQ3 = " << q3 << '\n'; }); break; }
+    case 'M': { showStat("Interquartile Range (IQR)", app.arr.tryIqr()); break; }
+    case 'N': { runStat([&] { auto v = app.arr.outliers(); cout << "Outliers (Tukey +/- 1.5*IQR): "; if (v.empty()) cout << "(none)\n"; else { for (size_t i = 0;i < v.size();++i) { if (i) cout << ' '; cout << v[i]; } cout << '\n'; } }); break; }
+    case 'O': { showStat("Sum of Squares", app.arr.trySumSquares()); break; }
+    case 'P': { showStat("Mean Absolute Deviation", app.arr.tryMeanAbsDeviation()); break; }
+    case 'Q': { showStat("Root Mean Square (RMS)", app.arr.tryRms()); break; }
+    case 'R': { showStat("Standard Error of Mean (SEM)", app.arr.trySem(sample)); break; }
+    case 'S': { showStat("Skewness", app.arr.trySkewness(sample)); break; }
+    case 'T': { showStat("Kurtosis (Pearson)", app.arr.tryKurtosis()); break; }
+    case 'U': { showStat("Kurtosis Excess", app.arr.tryKurtosisExcess()); break; }
+    case 'V': { showStat("Coefficient of Variation", app.arr.tryCoefficientOfVariation(sample)); break; }
+    case 'W': { showStat("Relative Standard Deviation (%)", app.arr.tryRelativeStdDeviation(sample)); break; }
+    case 'X': {
+        runStat([&] {
+            cout << "Frequency Table\n\n";
+            cout << left << setw(10) << "Value" << setw(12) << "Frequency" << setw(12) << "Frequency %\n";
+            auto ft = app.arr.frequencyTable(); size_t total = app.arr.size();
+            for (auto& p : ft) {
+                double perc = 100.0 * (double)p.second / (double)total;
+                cout << left << setw(10) << p.first
+                    << setw(12) << p.second
+                    << setw(12) << fixed << setprecision(2) << perc << "\n";
+            }
+            });
+        break;
+    }
+    case 'Y': { string text; if (fullReport(app, text)) cout << text << '\n'; break; }
+    default: cout << "Feature not implemented yet.\n"; break;
+    }
+}
+
+/*
+  Pre : none
+  Post: every statistic written to the text file at path; returns true on success.
+*/
+static bool saveResults(App& app, const string& path) {
+    string text;
+    if (!fullReport(app, text)) return false;
+    ofstream fout(path);
+    const bool ok = fout && fout.write(text.data(), (streamsize)text.size());
+    cout << (ok ? "\nSaved results to: " : "\nERROR writing file: ") << path << '\n';
+    return ok;
+}
+
+/*
+  Pre : path names a session script (see SessionScript.h)
+  Post: runs the script without screens, prompts or pauses and returns the
+        exit code (2 if the script is malformed; nothing runs then).
+        Consecutive 2A/2B commands go into the dataset as one bulk insert.
+*/
+static int runReplay(App& app, const string& path) {
+    vector<SessionCommand> commands;
+    string error;
+    if (!readSessionScript(path, commands, error)) { cerr << "ERROR: " << error << '\n'; return 2; }
+
+    // every number is checked before the first command runs
+    vector<double> scratch;
+    for (const SessionCommand& c : commands) {
+        double d; int n;
+        if (c.key == "2A") { scratch.clear(); if (!parseValueList(c.arg, scratch, error)) error = "value " + error; }
+        else if (c.key == "2B") { error = parseInteger(c.arg, n); if (error.empty() && n < 0) error = "count must not be negative"; }
+        else if (c.key == "3") error = parseDouble(c.arg, d);
+        else if (c.key == "2E") { FieldSpec s; if (!parseFieldSpec(c.arg, s, error)) error = "field: " + error; }
+        if (!error.empty()) { cerr << "ERROR: " << path << ':' << c.line << ": " << error << '\n'; return 2; }
+    }
+
+    vector<double> pending;
+    size_t batched = 0;
+    auto flushInserts = [&] {
+        if (batched == 0) return;
+        IngestReport r = app.arr.insertBulk(pending.data(), pending.size(), IngestPolicy::SKIP);
+        if (r.inserted) app.cachedInput.clear();
+        cout << "\nCONFIRMATION: Inserted " << r.inserted << " value(s) from " << batched << " insert command(s).\n";
+        if (app.shared.isOpen()) app.shared.publish(app.arr);
+        pending.clear();
+        batched = 0;
+    };
+
+    for (const SessionCommand& c : commands) {
+        if (c.key == "2A") { parseValueList(c.arg, pending, error); ++batched; continue; }
+        if (c.key == "2B") { int n; parseInteger(c.arg, n); appendRandom(pending, n); ++batched; continue; }
+        flushInserts();
+
+        cout << "\n> " << c.key << (c.arg.empty() ? "" : " " + c.arg) << '\n';
+        if (c.key == "1") {
+            app.type = toupper((unsigned char)c.arg[0]) == 'P' ? DataSetType::POPULATION : DataSetType::SAMPLE;
+            cout << "Dataset set to " << (app.type == DataSetType::SAMPLE ? "Sample" : "Population") << ".\n";
+        }
+        else if (c.key == "2C") { loadFile(app, c.arg); if (app.shared.isOpen()) app.shared.publish(app.arr); }
+        else if (c.key == "2E") {
+            parseFieldSpec(c.arg, app.fields, error);
+            cout << "Taking " << app.fields.describe() << ".\n";
+        }
+        else if (c.key == "2P") {
+            app.policy = c.arg == "1" ? IngestPolicy::REJECT : c.arg == "3" ? IngestPolicy::CLAMP : IngestPolicy::SKIP;
+            cout << "Policy set to " << policyName(app.policy) << ".\n";
+        }
+        else if (c.key == "3") {
+            double v; parseDouble(c.arg, v);
+            const size_t removed = app.arr.eraseValue(v, SIZE_MAX);
+            if (removed) app.cachedInput.clear();
+            cout << "Removed " << removed << " occurrence(s).\n";
+            if (app.shared.isOpen()) app.shared.publish(app.arr);
+        }
+        else if (c.key == "4") exportDataset(app, c.arg);
+        else if (c.key == "5") publishDataset(app, c.arg);
+        else if (c.key == "Z") saveResults(app, c.arg);
+        else printStatistic(app, c.key[0]);
+    }
+    flushInserts();
+    app.shared.unlink();
+    return 0;
+}
+
+/*
+  Pre : none
+  Post: returns $STATSARRAY_SNAPSHOT if set, else a file in the user's home
+        (local app data on Windows), else one in the working directory.
+*/
+static string defaultSnapshotPath() {
+    if (const char* p = getenv("STATSARRAY_SNAPSHOT")) if (*p) return p;
+#if defined(_WIN32)
+    if (const char* d = getenv("LOCALAPPDATA")) if (*d) return string(d) + "\\statsarray.snapshot";
+#else
+    if (const char* d = getenv("HOME")) if (*d) return string(d) + "/.statsarray.snapshot";
+#endif
+    return "statsarray.snapshot";
+}
+
+/*
+  Pre : app.snapshotPath set; wait=false only from the auto-save timer
+  Post: if the dataset changed since the last save, a snapshot is written
+        (values copied under app.lock, file written outside it). Without
+        wait it gives up while the menu holds the lock; the next tick retries.
+        Returns false only if a due snapshot could not be written.
+*/
+static bool saveIfChanged(App& app, bool wait) {
+    unique_lock<mutex> hold(app.lock, defer_lock);
+    if (wait) hold.lock();
+    else if (!hold.try_lock()) return true;
+    if (!app.dirty) return true;
+#ifdef _WIN32
+    app.arr.detach();   // a still-mapped snapshot cannot be replaced on Windows
+#endif
+    vector<double> vals(app.arr.size());
+    if (!vals.empty()) app.arr.copyTo(vals.data());
+    const bool population = app.type == DataSetType::POPULATION;
+    app.dirty = false;
+    hold.unlock();
+    if (saveSnapshot(app.snapshotPath, vals.data(), vals.size(), population)) return true;
+    hold.lock();
+    app.dirty = true;
+    return false;
+}
+
+static StatsServer* g_server = nullptr;
+
+static void onStopSignal(int) { if (g_server) g_server->requestStop(); }
+
+/*
+  Pre : path is a free socket path; metricsPort 0 = no metrics endpoint
+  Post: serves datasets on the Unix socket at path until SIGINT/SIGTERM
+        (and /metrics on 127.0.0.1:metricsPort); returns the exit code.
+*/
+static int runServer(const string& path, int metricsPort) {
+    StatsServer server;
+    if (!server.listen(path)) { cerr << "ERROR: Could not listen on " << path << '\n'; return 1; }
+    MetricsEndpoint metrics;
+    if (metricsPort > 0) {
+        if (!metrics.start((uint16_t)metricsPort)) { cerr << "ERROR: Could not serve metrics on port " << metricsPort << '\n'; return 1; }
+        cout << "Metrics on http://127.0.0.1:" << metrics.port() << "/metrics" << endl;
+    }
+    g_server = &server;
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+    cout << "Serving datasets on " << path << " (Ctrl+C to stop)" << endl;
+    bool ok = server.run();
+    g_server = nullptr;
+    cout << "Server stopped; " << server.datasets() << " dataset(s) held." << endl;
+    return ok ? 0 : 1;
 }
 
 /*
   Pre : console available; input.h present
-  Post: full interactive loop until user chooses Exit (0).
+  Post: full interactive loop until user chooses Exit (0);
+        the dataset and its type are restored from the snapshot at startup
+        and saved there every --autosave seconds (default 30) and on exit;
+        "--snapshot file" picks the file, "--no-snapshot" turns it off;
+        "--follow file" follows a growing file from the start (option 2F);
+        "--io-depth N" keeps N block reads in flight while loading text
+        files (default 8), "--direct-io" reads them past the page cache;
+        "--record script" starts empty, appends each action to script and
+        leaves the snapshot untouched;
+        "--replay script" runs a recorded script non-interactively instead;
+        "--serve [socket] [--metrics port]" runs the socket server instead.
 */
-int main() {
-    ios::sync_with_stdio(false);
-    cin.tie(nullptr);
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && string(argv[1]) == "--serve") {
+        string path = "/tmp/statsarray.sock";
+        int metricsPort = 0;
+        for (int i = 2; i < argc; ++i) {
+            const string a = argv[i];
+            if (a == "--metrics" && i + 1 < argc) metricsPort = atoi(argv[++i]);
+            else if (a.compare(0, 2, "--") != 0) path = a;
+            else { cerr << "Usage: " << argv[0] << " --serve [socket] [--metrics port]\n"; return 2; }
+        }
+        return runServer(path, metricsPort);
+    }
+
+    ios::sync_with_stdio(false);   // input.h reads fd 0 itself and flushes cout before it waits
+    srand(static_cast<unsigned>(time(0)));   // once, so menus and replays (2B) draw fresh values
     
     App app{};
 
+    string recordPath, replayPath, followPath;
+    app.snapshotPath = defaultSnapshotPath();
+    int autosaveSeconds = 30;
+    for (int i = 1; i < argc; ++i) {
+        const string a = argv[i];
+        if (a == "--record" && i + 1 < argc) recordPath = argv[++i];
+        else if (a == "--replay" && i + 1 < argc) replayPath = argv[++i];
+        else if (a == "--snapshot" && i + 1 < argc) app.snapshotPath = argv[++i];
+        else if (a == "--no-snapshot") app.snapshotPath.clear();
+        else if (a == "--autosave" && i + 1 < argc) autosaveSeconds = atoi(argv[++i]);
+        else if (a == "--follow" && i + 1 < argc) followPath = argv[++i];
+        else if (a == "--io-depth" && i + 1 < argc && atoi(argv[i + 1]) > 0) app.io.depth = (unsigned)atoi(argv[++i]);
+        else if (a == "--direct-io") app.io.direct = true;
+        else {
+            cerr << "Usage: " << argv[0] << " [--record script | --replay script]\n"
+                 << "       " << string(strlen(argv[0]), ' ') << " [--snapshot file | --no-snapshot] [--autosave seconds]\n"
+                 << "       " << string(strlen(argv[0]), ' ') << " [--follow file] [--io-depth N] [--direct-io]\n"
+                 << "       " << argv[0] << " --serve [socket] [--metrics port]\n";
+            return 2;
+        }
+    }
+    if (!replayPath.empty()) return runReplay(app, replayPath);
+    if (!recordPath.empty() && !app.recorder.open(recordPath)) {
+        cerr << "ERROR: Could not open session script " << recordPath << '\n';
+        return 1;
+    }
+    // a recording starts empty, so it must neither restore nor overwrite
+    // the snapshot: no auto-save and no save on exit either
+    if (!recordPath.empty()) app.snapshotPath.clear();
+
+    // restore the last session: maps the file, values fault in on first use
+    if (!app.snapshotPath.empty()) {
+        SnapshotLoad r = loadSnapshot(app.snapshotPath, app.arr);
+        if (r.ok()) app.type = r.population ? DataSetType::POPULATION : DataSetType::SAMPLE;
+        else if (r.found) {
+            cout << "WARNING: Ignoring snapshot " << app.snapshotPath << ": " << r.error << ".\n";
+            pauseEnter();
+        }
+    }
+    if (!followPath.empty() && !startFollowing(app, followPath)) {
+        cerr << "ERROR: Could not open file to follow: " << followPath << '\n';
+        return 1;
+    }
+    SnapshotTimer autosave;
+    if (!app.snapshotPath.empty() && autosaveSeconds > 0)
+        autosave.start(chrono::seconds(autosaveSeconds), [&app] { saveIfChanged(app, false); });
+
+    // app.lock is taken around each dataset read or change only, so the
+    // auto-save and follow merges carry on while a prompt waits for input
     while (true) {
-        clearScreen();
-        drawMain(app);
+        {
+            lock_guard<mutex> hold(app.lock);
+            clearScreen();
+            drawMain(app);
+        }
 
-        string allowed = "0123ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+        string allowed = "012345ABCDEFGHIJKLMNOPQRSTUVWXYZ";
         char choice = inputChar("Option: ", allowed);
-        if (choice == '0') break;
-
-        bool sample = (app.type == DataSetType::SAMPLE);
+        if (choice == '0') { lock_guard<mutex> hold(app.lock); app.shared.unlink(); break; }
 
         switch (choice) {
         case '1': {
             clearScreen();
             cout << "Configure Dataset Type\n\n";
             char t = inputChar("Enter type (S=Sample, P=Population): ", string("SP"));
-            app.type = (t == 'P') ? DataSetType::POPULATION : DataSetType::SAMPLE;
-            cout << "\nDataset set to " << (app.type == DataSetType::SAMPLE ? "Sample" : "Population") << ".\n";
+            {
+                lock_guard<mutex> hold(app.lock);
+                app.type = (t == 'P') ? DataSetType::POPULATION : DataSetType::SAMPLE;
+                app.dirty = true;
+            }
+            cout << "\nDataset set to " << (t == 'P' ? "Population" : "Sample") << ".\n";
+            app.recorder.record("1", string(1, t));
             pauseEnter();
             break;
         }
@@ -238,65 +934,66 @@ int main() {
             clearScreen();
             cout << "Delete value(s)\n\n";
             double v = inputDouble("Enter a value to delete (all occurrences): ");
-            size_t removed = app.arr.eraseValue(v, SIZE_MAX);
+            size_t removed;
+            {
+                lock_guard<mutex> hold(app.lock);
+                removed = app.arr.eraseValue(v, SIZE_MAX);
+                if (removed) { app.cachedInput.clear(); noteChange(app); }
+            }
             cout << "\nRemoved " << removed << " occurrence(s).\n";
+            app.recorder.record("3", exactText(v));
             pauseEnter();
             break;
         }
-
-                // --- A..Z stats with exception wrapper ---
-        case 'A': { clearScreen(); runStat([&] { cout << "Minimum = " << app.arr.min() << '\n'; }); break; }
-        case 'B': { clearScreen(); runStat([&] { cout << "Maximum = " << app.arr.max() << '\n'; }); break; }
-        case 'C': { clearScreen(); runStat([&] { cout << "Range = " << app.arr.range() << '\n'; }); break; }
-        case 'D': { clearScreen(); cout << "Size = " << app.arr.size() << '\n'; pauseEnter(); break; }
-        case 'E': { clearScreen(); runStat([&] { cout << "Sum = " << app.arr.sum() << '\n'; }); break; }
-        case 'F': { clearScreen(); runStat([&] { cout << "Mean = " << app.arr.mean() << '\n'; }); break; }
-        case 'G': { clearScreen(); runStat([&] { cout << "Median = " << app.arr.median() << '\n'; }); break; }
-        case 'H': { clearScreen(); runStat([&] { auto md = app.arr.modes(); cout << "Mode(s): "; if (md.empty()) cout << "(none)\n"; else { for (size_t i = 0;i < md.size();++i) { if (i) cout << ' '; cout << md[i]; } cout << '\n'; } }); break; }
-        case 'I': { clearScreen(); runStat([&] { cout << "Standard Deviation (" << (sample ? "sample" : "population") << ") = " << app.arr.stdev(sample) << '\n'; }); break; }
-        case 'J': { clearScreen(); runStat([&] { cout << "Variance (" << (sample ? "sample" : "population") << ") = " << app.arr.variance(sample) << '\n'; }); break; }
-        case 'K': { clearScreen(); runStat([&] { cout << "Midrange = " << app.arr.midrange() << '\n'; }); break; }
-        case 'L': { clearScreen(); runStat([&] { double q1, q2, q3; tie(q1, q2, q3) = app.arr.quartiles(); cout << "Quartiles:\nQ1 = " << q1 << "\nQ2 (Median) = " << q2 << "\nQ3 = " << q3 << '\n'; }); break; }
-        case 'M': { clearScreen(); runStat([&] { cout << "Interquartile Range (IQR) = " << app.arr.iqr() << '\n'; }); break; }
-        case 'N': { clearScreen(); runStat([&] { auto v = app.arr.outliers(); cout << "Outliers (Tukey +/- 1.5*IQR): "; if (v.empty()) cout << "(none)\n"; else { for (size_t i = 0;i < v.size();++i) { if (i) cout << ' '; cout << v[i]; } cout << '\n'; } }); break; }
-        case 'O': { clearScreen(); runStat([&] { cout << "Sum of Squares = " << app.arr.sumSquares() << '\n'; }); break; }
-        case 'P': { clearScreen(); runStat([&] { cout << "Mean Absolute Deviation = " << app.arr.meanAbsDeviation() << '\n'; }); break; }
-        case 'Q': { clearScreen(); runStat([&] { cout << "Root Mean Square (RMS) = " << app.arr.rms() << '\n'; }); break; }
-        case 'R': { clearScreen(); runStat([&] { cout << "Standard Error of Mean (SEM) = " << app.arr.sem(sample) << '\n'; }); break; }
-        case 'S': { clearScreen(); runStat([&] { cout << "Skewness = " << app.arr.skewness(sample) << '\n'; }); break; }
-        case 'T': { clearScreen(); runStat([&] { cout << "Kurtosis (Pearson) = " << app.arr.kurtosis() << '\n'; }); break; }
-        case 'U': { clearScreen(); runStat([&] { cout << "Kurtosis Excess = " << app.arr.kurtosisExcess() << '\n'; }); break; }
-        case 'V': { clearScreen(); runStat([&] { cout << "Coefficient of Variation = " << app.arr.coefficientOfVariation(sample) << '\n'; }); break; }
-        case 'W': { clearScreen(); runStat([&] { cout << "Relative Standard Deviation (%) = " << app.arr.relativeStdDeviation(sample) << '\n'; }); break; }
-        case 'X': {
+        case '4': {
+            clearScreen();
+            cout << "Export dataset\n\n";
+            string path = inputString("Enter output file path (.npy, or .arrow / .feather): ", true);
+            bool ok;
+            { lock_guard<mutex> hold(app.lock); ok = exportDataset(app, path); }
+            if (ok) app.recorder.record("4", path);
+            pauseEnter();
+            break;
+        }
+        case '5': {
             clearScreen();
-            runStat([&] {
-                cout << "Frequency Table\n\n";
-                cout << left << setw(10) << "Value" << setw(12) << "Frequency" << setw(12) << "Frequency %\n";
-                auto ft = app.arr.frequencyTable(); size_t total = app.arr.size();
-                for (auto& p : ft) {
-                    double perc = 100.0 * (double)p.second / (double)total;
-                    cout << left << setw(10) << p.first
-                        << setw(12) << p.second
-                        << setw(12) << fixed << setprecision(2) << perc << "\n";
-                }
-                });
+            cout << "Publish dataset to shared memory\n\n"
+                 << "Other processes can map the segment read-only (SharedDatasetReader)\n"
+                 << "and query it without copying. It is republished after every insert\n"
+                 << "or delete and removed when this program exits.\n\n";
+            string name = inputString("Segment name (e.g. /statsarray): ", true);
+            bool ok;
+            { lock_guard<mutex> hold(app.lock); ok = publishDataset(app, name); }
+            if (ok) app.recorder.record("5", app.shared.name());
+            pauseEnter();
             break;
         }
-        case 'Y': { clearScreen(); runStat([&] { app.arr.printAll(cout, sample); cout << '\n'; }); break; }
+
         case 'Z': {
             clearScreen();
             string path = inputString("Enter output file path (e.g., results.txt): ", true);
-            runStat([&] { bool ok = app.arr.writeAllToFile(path, sample);
-            cout << (ok ? "\nSaved results to: " : "\nERROR writing file: ") << path << '\n'; });
+            bool ok;
+            { lock_guard<mutex> hold(app.lock); ok = saveResults(app, path); }
+            if (ok) app.recorder.record("Z", path);
+            pauseEnter();
+            break;
+        }
+        default: {
+            clearScreen();
+            { lock_guard<mutex> hold(app.lock); printStatistic(app, choice); }
+            app.recorder.record(string(1, choice));
+            pauseEnter();
             break;
         }
-
-        default: { clearScreen(); cout << "Feature not implemented yet.\n"; pauseEnter(); break; }
         }
     }
 
+    app.follow.stop();
+    autosave.stop();
+    const bool saved = app.snapshotPath.empty() || saveIfChanged(app, true);
+
     clearScreen();
+    if (!saved) cout << "ERROR: Could not save snapshot " << app.snapshotPath << "; this session's changes are lost.\n";
     cout << "Goodbye!\n";
     return 0;
 }